@@ -1,7 +1,11 @@
 ﻿// Include Standardheader, steht bei jedem C/C++-Programm am Anfang
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <vector>
+#include <algorithm>
+#include <thread>
+#include <chrono>
 
 // Include GLEW, GLEW ist ein notwendiges Übel. Der Hintergrund ist, dass OpenGL von Microsoft
 // zwar unterstützt wird, aber nur in einer Uralt-Version. Deshalb beinhaltet die Header-Datei,
@@ -42,6 +46,16 @@ using namespace glm;
 
 #include "Obj3D.hpp"
 
+#include "benchmark.hpp"
+#include "assetloader.hpp"
+#include "headless.hpp"
+#include "profiler.hpp"
+#include "simulation.hpp"
+#include "indirect.hpp"
+#include "streamring.hpp"
+#include "transform.hpp"
+#include "transformtree.hpp"
+
 
 // die Rotation der View
 float winkelX = 0;
@@ -49,10 +63,8 @@ float winkelY = 0;
 float winkelZ = 0;
 
 
-//position der Armeise
-float antPosX = 0;
-float antPosY = 0;
-float antRotation = 0;
+//die Armeise und die Food Drops leben in der Simulation (eigener Thread, siehe simulation.hpp)
+Simulation* world = NULL;
 
 //Rotationswinkel, je einzelner Tastendruck/impuls
 float keySensi = 2;
@@ -76,22 +88,11 @@ void error_callback(int error, const char* description)
 	fputs(description, stderr);
 }
 
-// für Berechnung von Richtungs-bewegung der Armeise
-float PI = 3.14159265358979323846;
-
-void move(int direction) {
-
-
-	if (direction > 0) {
-
-		antPosX += cos(antRotation * (PI / 180)) * 0.1 * direction;
-		antPosY += sin(antRotation * (PI / 180)) * 0.1 * direction;
-
-	}
-	else if (direction < 0) {
-		antPosX -= cos(antRotation * (PI / 180)) * 0.02 * -direction;
-		antPosY -= sin(antRotation * (PI / 180)) * 0.02 * -direction;
-	}
+// Pfeiltasten gehen als Druecken/Loslassen an die Simulation, die Wiederholungen des OS braucht sie nicht
+void simulationKey(SimInput input, int action)
+{
+	if (world && action != GLFW_REPEAT)
+		world->input(input, action == GLFW_PRESS);
 }
 
 
@@ -110,10 +111,6 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 // abfangen. Mouse-Events z. B. erhalten wir nicht, da wir keinen Callback an GLFW übergeben.
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-	//printf("%f\n", antRotation);
-	//printf("%f\n", antPosX);
-	//printf("%f\n", antPosY);
-
 	switch (key)
 	{
 		// Mit rechte Mousetaste -> gehe zu Deklaration finden Sie andere Konstanten für Tasten.
@@ -145,16 +142,21 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 		break;
 
 	case GLFW_KEY_UP:
-		move(1);
+		simulationKey(SIM_FORWARD, action);
 		break;
 	case GLFW_KEY_DOWN:
-		move(-1);
+		simulationKey(SIM_BACKWARD, action);
 		break;
 	case GLFW_KEY_RIGHT:
-		antRotation += keySensi * 3;
+		simulationKey(SIM_TURN_RIGHT, action);
 		break;
 	case GLFW_KEY_LEFT:
-		antRotation -= keySensi * 3;
+		simulationKey(SIM_TURN_LEFT, action);
+		break;
+	case GLFW_KEY_P:
+		// Die letzten Frames als Chrome-Trace speichern (chrome://tracing)
+		if (action == GLFW_PRESS)
+			profiler().writeTrace("ant_trace.json");
 		break;
 	default:
 		break;
@@ -169,86 +171,125 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 glm::mat4 Projection;
 glm::mat4 View;
 glm::mat4 Model;
-GLuint programID; // OpenGL unterstützt unterschiedliche Shaderprogramme, zwischen denen man
-				  // wechseln kann. Unser Programm wird mit der unsigned-integer-Variable programID
-				  // referenziert.
-
-// Ich habe Ihnen hier eine Hilfsfunktion definiert, die wir verwenden, um die Transformationsmatrizen
-// zwischen dem OpenGL-Programm auf der CPU und den Shaderprogrammen in den GPUs zu synchronisieren.
-// (Muss immer aufgerufen werden, bevor wir Geometriedaten in die Pipeline einspeisen.)
-void sendMVP()
+ShaderProgram program; // OpenGL unterstützt unterschiedliche Shaderprogramme, zwischen denen man
+					   // wechseln kann. Unser Programm wird mit dem Objekt program referenziert,
+					   // program.id() ist die unsigned-integer-Nummer bei OpenGL.
+ShaderProgram instancedProgram; // Liest die Model-Matrix pro Instanz aus einem Buffer statt aus "M"
+
+// V, P und das Licht aendern sich nur einmal pro Frame und sind fuer beide Programme gleich.
+// Sie liegen deshalb im Uniform-Block "PerFrame" (std140: vec3 wird wie vec4 ausgerichtet).
+struct PerFrameUniforms
 {
-	// Zunächst können wir die drei Matrizen einfach kombinieren, da unser einfachster Shader
-	// wirklich nur eine Transformationsmatrix benötigt, wie in der Vorlesung erklärt.
-	// Später werden wir hier auch die Teilmatrizen an den Shader übermitteln müssen.
-	// Interessant ist hier, dass man in C++ (wie auch in C#) den "*"-Operator überladen kann, so dass
-	// man Klassenobjekte miteinander multiplizieren kann (hier Matrizen bzw. "mat4"), 
-	// das ginge in JAVA so natürlich nicht. 
-	glm::mat4 MVP = Projection * View * Model;
-
-	// "glGetUniformLocation" liefert uns eine Referenz auf eine Variable, die im Shaderprogramm
-	// definiert ist, in diesem Fall heisst die Variable "MVP".
-	// "glUniformMatrix4fv" überträgt Daten, genauer 4x4-Matrizen, aus dem Adressraum unserer CPU
-	// (vierter Parameter beim Funktionsaufruf, wir generieren mit "&" hier einen Pointer auf das erste 
-	//  Element, und damit auf das gesamte Feld bzw den Speicherbereich) 
-	// in den Adressraum der GPUs. Beim ersten Parameter 
-	// muss eine Referenz auf eine Variable im Adressraum der GPU angegeben werden.
-	glUniformMatrix4fv(glGetUniformLocation(programID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
-
-
-	//Originale lichtquelle im Raum
-	//glm::vec3 lightPos = glm::vec3(4, 4, -4);
-	//glUniform3f(glGetUniformLocation(programID, "LightPosition_worldspace"), lightPos.x, lightPos.y, lightPos.z);
+	glm::mat4 V;
+	glm::mat4 P;
+	glm::vec4 LightPosition_worldspace;
+};
+const GLuint perFrameBinding = 0;
+UniformBuffer perFrameBuffer;
+
+// Sammelt alle Zeichnungen eines Frames und zeichnet sie sortiert und zusammengefasst
+RenderQueue renderQueue;
+
+// Ab GL 4.3: Meshes aus der gemeinsamen Arena verwirft die GPU, gezeichnet wird mit einem
+// Multi-Draw-Indirect pro Textur
+IndirectRenderer indirectRenderer;
+
+// Die Szene als Hierarchie: Boden, Achsen, Futter und Ameise haengen an der gedrehten Szene,
+// der Ball an der Ameise. Einmal in buildScene angelegt, danach aendern sich nur die lokalen
+// Matrizen, und neu gerechnet wird nur, was darunter haengt.
+TransformTree sceneTree;
+int sceneNode;
+int groundNode;
+int axisNodes[3];
+int foodNode;
+int antNode;
+int ballNode;
+
+// Schickt V, P und das Licht einmal pro Frame fuer alle Programme an die Grafikkarte
+void sendPerFrame(const glm::vec3& lightPosition)
+{
+	PerFrameUniforms perFrame;
+	perFrame.V = View;
+	perFrame.P = Projection;
+	perFrame.LightPosition_worldspace = glm::vec4(lightPosition, 1.0f);
+	perFrameBuffer.update(&perFrame);
 }
 
 
 //####################################################################################################################################
 //##################################################--teil3--#########################################################################
 
-void drawCS() {
-	double longSide = 2.0;
-	double shortSide = 0.02;
-
-	glm::mat4 Save = Model;
-	Model = glm::scale(Model, glm::vec3(longSide, shortSide, shortSide));
-	sendMVP();
-	shaderHelper();
-	drawSphere(10, 10);
-
-	Model = Save;
-	Model = glm::scale(Model, glm::vec3(shortSide, shortSide, longSide));
-	sendMVP();
-	shaderHelper();
-	drawSphere(10, 10);
-
-	Model = Save;
-	Model = glm::translate(Model, glm::vec3(0, 1, 0));
-	Model = glm::scale(Model, glm::vec3(shortSide, longSide / 2, shortSide));
-	sendMVP();
-	shaderHelper();
-	drawSphere(10, 10);
-
-	Model = Save;
+// Zeichnet drawable mit der Weltmatrix des Knotens
+void submitNode(int node, Drawable* drawable, GLuint texture)
+{
+	renderQueue.submit(drawable, &instancedProgram, texture, sceneTree.world(node));
+}
+
+// Die drei Achsen als Knoten unter parent, sie aendern sich nie
+void createCS(int parent) {
+	float longSide = 2.0f;
+	float shortSide = 0.02f;
+
+	axisNodes[0] = sceneTree.add(parent, glm::scale(glm::mat4(1.0f), glm::vec3(longSide, shortSide, shortSide)));
+	axisNodes[1] = sceneTree.add(parent, glm::scale(glm::mat4(1.0f), glm::vec3(shortSide, shortSide, longSide)));
+	axisNodes[2] = sceneTree.add(parent,
+		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0, 1, 0)), glm::vec3(shortSide, longSide / 2, shortSide)));
 }
 
-void drawSeg(float h)
+// Die drei Achsen, die Render-Queue fasst sie zu einem Draw-Aufruf zusammen
+void drawCS(GLuint texture) {
+	for (int i = 0; i < 3; i++)
+		submitNode(axisNodes[i], sphereDrawable(10, 10), texture);
+}
+
+// Weltmatrix einer Ameise an (x, y) auf dem Boden, rotation in Grad
+glm::mat4 antTransform(const glm::mat4& world, float x, float y, float rotation)
 {
+	glm::mat4 antModel = glm::translate(world, glm::vec3(x, 0.0, y));
+	antModel = glm::rotate(antModel, 90.0f, glm::vec3(-1, 0, 0));
+	antModel = glm::rotate(antModel, 180.0f, glm::vec3(0, 0, 1));
+	antModel = glm::rotate(antModel, rotation, glm::vec3(0, 0, -1));
+	antModel = glm::scale(antModel, glm::vec3(1.0 / 100, 1.0 / 100, 1.0 / 100));
+	return antModel;
+}
+
+// Solange ant.obj noch laedt, steht eine Kugel an ihrer Stelle
+void submitAnt(Obj3D* ant, GLuint texture, const glm::mat4& antModel)
+{
+	if (ant)
+		renderQueue.submit(ant, &instancedProgram, texture, antModel);
+	else
+		renderQueue.submit(sphereDrawable(10, 10), &instancedProgram, texture,
+			glm::scale(glm::translate(antModel, glm::vec3(0.0, 0.0, 30.0)), glm::vec3(30.0f)));
+}
 
-	glm::mat4 Save = Model;
-	Model = glm::translate(Model, glm::vec3(0, h, 0));
-	Model = glm::scale(Model, glm::vec3(h * 0.4, h, h * 0.4));
-	sendMVP();
-	shaderHelper();
-	drawSphere(10, 10);
-	Model = Save;
+// Der Ball vor der Ameise, Abstand und Groesse mit dem Mausrad, im Modellmassstab der Ameise
+glm::mat4 ballTransform(float wheel)
+{
+	glm::mat4 ballModel = glm::translate(glm::mat4(1.0f), glm::vec3(50 + (100.0 * wheel / 100), 0.0, 0.0));
+	ballModel = glm::scale(ballModel, glm::vec3(20 + wheel, 20 + wheel, 20 + wheel));
+	return glm::translate(ballModel, glm::vec3(0.0, 0.0, 1.0));
 }
 
-//FOOD DROPS
-//random seed
+// Legt alle Knoten an, Eltern vor Kindern. Was sich jeden Frame bewegt (Ameise, Ball), steht
+// hinten, damit update() den statischen Teil davor gar nicht erst ansieht.
+void buildScene(float groundHalfSize)
+{
+	sceneTree.clear();
+	sceneNode = sceneTree.add(-1);
+
+	// Der Boden mit den Duftspuren, knapp unter den Ameisen
+	glm::mat4 groundModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.005f, 0.0f));
+	groundNode = sceneTree.add(sceneNode, glm::scale(groundModel, glm::vec3(groundHalfSize, 1.0f, groundHalfSize)));
 
-int foodNumber = 0;
-float randomFoodX[10]{};
-float randomFoodY[10]{};
+	createCS(sceneNode);
+
+	// Futter liegt im Massstab 0.2, jedes Stueck wird nur noch verschoben
+	foodNode = sceneTree.add(sceneNode, glm::scale(glm::mat4(1.0f), glm::vec3(0.2f)));
+
+	antNode = sceneTree.add(sceneNode);
+	ballNode = sceneTree.add(antNode, ballTransform(mouseWheel));
+}
 
 
 
@@ -259,62 +300,97 @@ float randomFoodY[10]{};
 
 
 // Einstiegspunkt für C- und C++-Programme (Funktion), Konsolenprogramme könnte hier auch Parameter erwarten
-int main(void)
+int main(int argc, char* argv[])
 {
+	// "--bench <name>" startet einen Benchmark statt des Spiels (siehe benchmark.hpp)
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		return runBenchmark(argc, argv);
 
-
-	// Initialisierung der GLFW-Bibliothek
-	if (!glfwInit())
-	{
-		fprintf(stderr, "Failed to initialize GLFW\n");
-		exit(EXIT_FAILURE);
-	}
-
-	// Fehler werden auf stderr ausgegeben, s. o.
-	glfwSetErrorCallback(error_callback);
-
+	// "--headless" zeichnet ohne Fenster eine feste Szene (siehe headless.hpp)
+	HeadlessOptions headless;
+	if (!parseHeadlessOptions(argc, argv, headless))
+		return EXIT_FAILURE;
+	HeadlessContext offscreen;
+	GLFWwindow* window = NULL;
 
 	int window_width = 1280;
 	int window_height = 720;
-	// Öffnen eines Fensters für OpenGL, die letzten beiden Parameter sind hier unwichtig
-	// Diese Funktion darf erst aufgerufen werden, nachdem GLFW initialisiert wurde.
-	// (Ggf. glfwWindowHint vorher aufrufen, um erforderliche Resourcen festzulegen -> MacOSX)
-	GLFWwindow* window = glfwCreateWindow(window_width, // Breite
-		720,  // Hoehe
-		"Ant Game", // Ueberschrift
-		NULL,  // windowed mode
-		NULL); // shared window
-
-	if (!window)
+	if (headless.enabled)
 	{
-		glfwTerminate();
-		exit(EXIT_FAILURE);
+		window_width = headless.width;
+		window_height = headless.height;
+		if (!offscreen.create(window_width, window_height))
+			exit(EXIT_FAILURE);
 	}
+	else
+	{
+		// Initialisierung der GLFW-Bibliothek
+		if (!glfwInit())
+		{
+			fprintf(stderr, "Failed to initialize GLFW\n");
+			exit(EXIT_FAILURE);
+		}
 
-	// Wir könnten uns mit glfwCreateWindow auch mehrere Fenster aufmachen...
-	// Spätestens dann wäre klar, dass wir den OpenGL-Befehlen mitteilen müssen, in
-	// welches Fenster sie "malen" sollen. Wir müssen das aber zwingend auch machen,
-	// wenn es nur ein Fenster gibt.
+		// Fehler werden auf stderr ausgegeben, s. o.
+		glfwSetErrorCallback(error_callback);
 
-	// Bis auf weiteres sollen OpenGL-Befehle in "window" malen.
-	// Ein "Graphic Context" (GC) speichert alle Informationen zur Darstellung, z. B.
-	// die Linienfarbe, die Hintergrundfarbe. Dieses Konzept hat den Vorteil, dass
-	// die Malbefehle selbst weniger Parameter benötigen.
-	// Erst danach darf man dann OpenGL-Befehle aufrufen !
-	glfwMakeContextCurrent(window);
+		// Öffnen eines Fensters für OpenGL, die letzten beiden Parameter sind hier unwichtig
+		// Diese Funktion darf erst aufgerufen werden, nachdem GLFW initialisiert wurde.
+		// (Ggf. glfwWindowHint vorher aufrufen, um erforderliche Resourcen festzulegen -> MacOSX)
+		window = glfwCreateWindow(window_width, // Breite
+			720,  // Hoehe
+			"Ant Game", // Ueberschrift
+			NULL,  // windowed mode
+			NULL); // shared window
+
+		if (!window)
+		{
+			glfwTerminate();
+			exit(EXIT_FAILURE);
+		}
+
+		// Wir könnten uns mit glfwCreateWindow auch mehrere Fenster aufmachen...
+		// Spätestens dann wäre klar, dass wir den OpenGL-Befehlen mitteilen müssen, in
+		// welches Fenster sie "malen" sollen. Wir müssen das aber zwingend auch machen,
+		// wenn es nur ein Fenster gibt.
+
+		// Bis auf weiteres sollen OpenGL-Befehle in "window" malen.
+		// Ein "Graphic Context" (GC) speichert alle Informationen zur Darstellung, z. B.
+		// die Linienfarbe, die Hintergrundfarbe. Dieses Konzept hat den Vorteil, dass
+		// die Malbefehle selbst weniger Parameter benötigen.
+		// Erst danach darf man dann OpenGL-Befehle aufrufen !
+		glfwMakeContextCurrent(window);
+	}
 
 	// Initialisiere GLEW
 	// (GLEW ermöglicht Zugriff auf OpenGL-API > 1.1)
 	glewExperimental = true; // Diese Zeile ist leider notwendig.
 
-	if (glewInit() != GLEW_OK)
+	GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// GLEW 2.x unter Linux sucht ein GLX-Display, die Funktionen des EGL-Kontexts sind trotzdem geladen
+	if (headless.enabled && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY)
+		glewStatus = GLEW_OK;
+#endif
+	if (glewStatus != GLEW_OK)
 	{
 		fprintf(stderr, "Failed to initialize GLEW\n");
 		return -1;
 	}
 
-	// Auf Keyboard-Events reagieren (s. o.)
-	glfwSetKeyCallback(window, key_callback);
+	if (headless.enabled)
+	{
+		if (!offscreen.createFramebuffer())
+			return -1;
+	}
+	else
+	{
+		// Auf Keyboard-Events reagieren (s. o.)
+		glfwSetKeyCallback(window, key_callback);
+	}
+
+	// Zeitmessung der Frame-Abschnitte, vor dem AssetLoader, damit dessen Threads als Worker zaehlen
+	profiler().create();
 
 	// Setzen von Dunkelblau als Hintergrundfarbe (erster OpenGL-Befehl in diesem Programm).
 	// Beim späteren Löschen gibt man die Farbe dann nicht mehr an, sondern liest sie aus dem GC
@@ -326,77 +402,161 @@ int main(void)
 
 	// Kreieren von Shadern aus den angegebenen Dateien, kompilieren und linken und in
 	// die Grafikkarte übertragen.  
-	programID = LoadShaders("StandardShading.vertexshader", "StandardShading.fragmentshader");
+	program.load("StandardShading.vertexshader", "StandardShading.fragmentshader");
 
 	// Diesen Shader aktivieren ! (Man kann zwischen Shadern wechseln.) 
-	glUseProgram(programID);
-
-	// Load the texture
-	GLuint Texture = loadBMP_custom("mandrill.bmp");
-
-	// Bind our texture in Texture Unit 0
+	program.use();
+
+	// Derselbe Shader, aber mit einer Model-Matrix pro Instanz (fuer Food Drops und Achsen)
+	instancedProgram.load("StandardShadingInstanced.vertexshader", "StandardShading.fragmentshader");
+	instancedProgram.use();
+	instancedProgram.set(instancedProgram.uniform("myTextureSampler"), 0);
+	program.use();
+
+	// Ein Buffer fuer V, P und das Licht, an dem beide Programme haengen
+	perFrameBuffer.create(perFrameBinding, sizeof(PerFrameUniforms));
+	program.bindUniformBlock("PerFrame", perFrameBinding);
+	instancedProgram.bindUniformBlock("PerFrame", perFrameBinding);
+
+	// Alles, was sich jeden Frame aendert (V/P, Instanz-Matrizen, Objekte fuer den IndirectRenderer),
+	// geht ab GL 4.4 durch einen dauerhaft gemappten Ring mit drei Bereichen zu je 4 MB
+	streamRing().create(4 * 1024 * 1024, 3);
+
+	// Vor dem Laden, damit jedes Mesh auch in die Arena kommt. Headless "--no-mdi" zum Vergleich.
+	if ((!headless.enabled || headless.multiDrawIndirect) && indirectRenderer.create(perFrameBinding))
+		renderQueue.setIndirect(&indirectRenderer, &instancedProgram);
+	program.use();
+
+	// Textur und Meshes werden im Hintergrund geladen, das Fenster zeichnet schon vorher.
+	// Mit "--sequential-load" wird wie frueher alles vor dem ersten Frame geladen (zum Vergleich).
+	bool sequentialLoad = argc > 1 && strcmp(argv[1], "--sequential-load") == 0;
+	unsigned int loaderThreads = sequentialLoad ? 0 : std::max(1u, std::thread::hardware_concurrency());
+	// Ohne Fenster gibt es kein glfwGetTime, dort zaehlt die Uhr der Standardbibliothek
+	std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+	auto wallClock = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count(); };
+	double loadStart = headless.enabled ? 0.0 : glfwGetTime();
+
+	AssetLoader assets(loaderThreads);
+	int mandrill = assets.loadTexture("mandrill.bmp");
+	assets.loadMesh("cube.obj");
+	assets.loadMesh("teapot.obj");
+	int antAsset = assets.loadMesh("ant.obj", true); // kompaktes Vertex-Layout, halber Speicher
+	//assets.loadMesh("anthill.obj");
+
+	// Graue Platzhalter-Textur, bis mandrill.bmp da ist
+	ImageData grey;
+	grey.width = grey.height = 1;
+	grey.pixels.assign(3, 128);
+	GLuint placeholderTexture = createTexture(grey);
+
+	// Our texture is in Texture Unit 0
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, Texture);
 
 	// Set our "myTextureSampler" sampler to user Texture Unit 0
-	glUniform1i(glGetUniformLocation(programID, "myTextureSampler"), 0);
-
-
-	Obj3D cube("cube.obj");
-	Obj3D teapot("teapot.obj");
-	Obj3D ant("ant.obj");
-	//Obj3D anthill("anthill.obj");
-
-		//FOOD DROPS brauchen Random float für Position
-	srand(72);
-	float min = -10.0f;
-	float max = 10.0f;
-
+	program.set(program.uniform("myTextureSampler"), 0);
+
+	// Texturen werden in Streifen hochgeladen, hoechstens so viele Bytes pro Frame
+	// (eine 4K-Textur mit 48 MB braucht damit 12 Frames, aber keiner davon ruckelt)
+	const size_t textureUploadBudget = 4 * 1024 * 1024;
+
+	// Zeitmessung fuer das Laden
+	double firstFrameTime = -1.0;
+	bool loadReported = false;
+	bool streamReported = false;
+
+	// Die Welt tickt 60 mal pro Sekunde, alle 5 Sekunden ein Food Drop bis 10 (seed wie frueher 72).
+	// Headless: die Szene soll in jedem Lauf gleich aussehen, also alle Food Drops sofort
+	// und Schritte ohne Thread, genau bis zur festen Zeit des Frames
+	// Die Kolonie: 100 Ameisen neben der eigenen, headless "--ants" insgesamt
+	int foodDrops = headless.enabled ? headless.foodDrops : 10;
+	size_t colonySize = headless.enabled ? headless.ants - 1 : 100;
+	Simulation simulation(60.0, foodDrops, headless.enabled ? foodDrops : 0, colonySize, 72);
+	SimView sim;
+	PheromoneField& pheromones = simulation.pheromoneField();
+	pheromones.createTexture();
+	buildScene(pheromones.worldHalfSize());
+	world = &simulation;
+	// Alles Weitere sollte ohne neuen Speicher fuer Food Drops und Ameisen auskommen
+	unsigned int poolAllocations = simulation.poolAllocations();
+
+	// Headless "--no-lod": alle Kugeln so fein wie angefordert, zum Vergleich der Dreiecke
+	renderQueue.setLevelOfDetail(!headless.enabled || headless.levelOfDetail);
+
+	std::vector<double> frameTimes;
+	std::vector<glm::mat4> colonyModels; // Weltmatrizen der Kolonie, jeden Frame neu
+	unsigned int transformUpdates = 0;   // neu gerechnete Knoten der Szene, headless
+	if (headless.enabled)
+	{
+		while (!assets.allReady() || !assets.textureStreamer().idle())
+		{
+			assets.uploadFinished(textureUploadBudget);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		printf("Headless: %d assets ready after %.1f ms\n", assets.count(), wallClock() * 1000.0);
+		loadReported = streamReported = true;
+		frameTimes.reserve(headless.frames);
 
+		// Die Ameise laeuft von selbst im Kreis
+		simulation.input(SIM_FORWARD, true);
+		simulation.input(SIM_TURN_RIGHT, true);
+	}
+	else
+		simulation.startThread();
 
 	//Time in seconds
-	double t = glfwGetTime();
+	double t = headless.enabled ? 0.0 : glfwGetTime();
 	double lastTFPS = t;
-	double lastT = t;
 
 	//frames
 	int nbFrames = 0;
+	int frame = 0;
 
 
 
 	// Alles ist vorbereitet, jetzt kann die Eventloop laufen...
-	while (!glfwWindowShouldClose(window))
+	while (headless.enabled ? frame < headless.frames : !glfwWindowShouldClose(window))
 	{
+		double frameStart = wallClock();
+		profiler().begin("frame");
+		streamRing().beginFrame();
 
 		float FoV = initialFoV;// -5 * mouseWheel;
-		//let Food objects appear after time
 
-		//compute timing
-		t = glfwGetTime();
-		double deltaT = t - lastT;
+		// Im Hintergrund fertig gewordene Assets hochladen, solange Platzhalter verwenden
+		profiler().begin("upload", true);
+		assets.uploadFinished(textureUploadBudget);
+		pheromones.uploadDirtyTiles();
+		profiler().end();
+		GLuint Texture = assets.texture(mandrill);
+		if (!Texture)
+			Texture = placeholderTexture;
+		Obj3D* ant = assets.mesh(antAsset);
+
+		profiler().begin("simulation");
+
+		//compute timing, headless in festen Schritten statt nach der Uhr
+		t = headless.enabled ? frame * headless.timeStep : glfwGetTime();
+
+		// Zustand der Welt fuer diesen Frame, zwischen den letzten beiden Schritten interpoliert
+		if (headless.enabled)
+			simulation.advance(t);
+		simulation.snapshot(headless.enabled ? t : simulation.clock(), sim);
 
 		//get framePerSec
 		nbFrames++;
-		if (t - lastTFPS >= 1.0) {
+		if (!headless.enabled && t - lastTFPS >= 1.0) {
 			// printf and reset timer
-			printf("%f ms/frame\n", 1000.0 / double(nbFrames));
+			const RenderStats& stats = renderQueue.stats();
+			const StreamStats& streamed = streamRing().frameStats();
+			printf("%f ms/frame, %u objects drawn, %u culled, %u draw calls, %u triangles, %.1f KB streamed, %u fence waits, "
+				"%u ants nearby\n",
+				1000.0 / double(nbFrames), stats.submitted - stats.culled, stats.culled, stats.issued, stats.triangles,
+				streamed.bytes / 1024.0, streamed.fenceWaits, sim.antsNearby);
+			profiler().printStats();
 			nbFrames = 0;
 			lastTFPS += 1.0;
 		}
-
-
-		//nach x Sekunden und bei weniger als y Food Drops auf dem Feld
-		if (deltaT > 5 && foodNumber < 10) {
-			//der Teiler von Rand_Max bestimmt die maximale Zahl (von Null bis max 10 z.B)
-			float randomX = min + rand() / (float(RAND_MAX / (max - min)));
-			float randomY = min + rand() / (float(RAND_MAX / (max - min)));
-
-			//Anzzahl der Food Drops erhöhen
-			foodNumber++;
-			randomFoodX[foodNumber - 1] = randomX;
-			randomFoodY[foodNumber - 1] = randomY;
-			lastT = t;
-		}
+		profiler().end();
 
 
 		// Löschen des Bildschirms (COLOR_BUFFER), man kann auch andere Speicher zusätzlich löschen, 
@@ -404,12 +564,15 @@ int main(void)
 		// Per Konvention sollte man jedes Bild mit dem Löschen des Bildschirms beginnen, muss man aber nicht...
 		//glClear(GL_COLOR_BUFFER_BIT);	
 		//z Buffer für tiefe aktivieren, um engstes Pixel am Betrachter dran zu zeigen
+		profiler().begin("clear", true);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		profiler().end();
 		//OpenGL soll z-Test aktivieren
 		glEnable(GL_DEPTH_TEST);
 		//pixel mit kleineren z-Werten akzeptieren (eigentlich default), statt größeren! 
 		glDepthFunc(GL_LESS);
 
+		profiler().begin("matrices");
 		// Einstellen der Geometrischen Transformationen
 		// Wir verwenden dazu die Funktionen aus glm.h
 		// Projektionsmatrix mit 45Grad horizontalem Öffnungswinkel, 4:3 Seitenverhältnis, 
@@ -435,59 +598,65 @@ int main(void)
 		Model = glm::rotate(Model, winkelY, glm::vec3(0, 1, 0));
 		Model = glm::rotate(Model, winkelZ, glm::vec3(0, 0, 1));
 
-		// Diese Informationen (Projection, View, Model) müssen geeignet der Grafikkarte übermittelt werden,
-		// damit sie beim Zeichnen von Objekten berücksichtigt werden können.
-		//sendMVP();
-		//Unser neuer Shader
-		//	kommt nicht mehr mit der zusammengefassten MVP‐Matrix alleine klar, sondern für die Beleuchtung
-		//	benötigt er die Einzelmatrizen.Deshalb müssen wir Sie ihm immer schicken, wenn wir unseren
-		//	Zustand im Adressraum mit seinem synchronisieren. Diese drei Zeilen gehören also nach „sendMVP“.
-		//shaderHelper();
+		// Nur was sich wirklich geaendert hat, wird im Baum markiert; die Szene dreht sich
+		// nur auf Tastendruck, Boden und Achsen bleiben dann wie im letzten Frame
+		sceneTree.setLocal(sceneNode, Model);
+		sceneTree.setLocal(antNode, antTransform(glm::mat4(1.0f), sim.antX, sim.antY, sim.antRotation));
+		sceneTree.setLocal(ballNode, ballTransform(mouseWheel));
+		transformUpdates += sceneTree.update();
 
+		//Lichtpunkt ueber der Ameise, zusammen mit V und P einmal fuer den ganzen Frame
+		glm::vec4 lightPos = sceneTree.world(sceneNode) * glm::vec4(sim.antX, 1.5f, sim.antY, 1);
+		sendPerFrame(glm::vec3(lightPos));
+		profiler().end();
 
-		//edit the Model, but before store the initial Model
-		glm::mat4 Save = Model;
-		drawCS();
-
-		//the Ant
-		Model = glm::translate(Model, glm::vec3(antPosX, 0.0, antPosY));
-		//Lichtpunkt
-		glm::vec4 lightPos = Model * glm::vec4(0, 1.5f, 0, 1);
-		glUniform3f(glGetUniformLocation(programID, "LightPosition_worldspace"), lightPos.x, lightPos.y,
-			lightPos.z);
+		// Statt direkt zu zeichnen, sammeln wir alles in der Render-Queue. Jedes Objekt bekommt
+		// seine eigene Weltmatrix, Model bleibt die Drehung der ganzen Szene.
+		renderQueue.begin(View, Projection, 100.0f, window_height);
 
-		Model = glm::rotate(Model, 90.0f, glm::vec3(-1, 0, 0));
-		Model = glm::rotate(Model, 180.0f, glm::vec3(0, 0, 1));
-		Model = glm::rotate(Model, antRotation, glm::vec3(0, 0, -1));
-		Model = glm::scale(Model, glm::vec3(1.0 / 100, 1.0 / 100, 1.0 / 100));
+		// Der Boden mit den Duftspuren, knapp unter den Ameisen
+		submitNode(groundNode, quadDrawable(), pheromones.texture());
 
-		sendMVP();
-		shaderHelper();
-		ant.display();
-		
+		profiler().begin("submit axes");
+		drawCS(Texture);
+		profiler().end();
 
-		//the ball
-
-		Model = glm::translate(Model, glm::vec3(50+(100.0 * mouseWheel/100), 0.0, 0.0));
-		Model = glm::scale(Model, glm::vec3(20+ mouseWheel, 20+ mouseWheel, 20+ mouseWheel));
-		Model = glm::translate(Model, glm::vec3(0.0, 0.0, 1.0));
-		sendMVP();
-		shaderHelper();
-		drawSphere(10, 10);
-		Model = Save;
+		//the Ant
+		profiler().begin("submit ants");
+		submitAnt(ant, Texture, sceneTree.world(antNode));
 
+		// Die Kolonie, Richtung wie bei der eigenen Ameise (x += cos, y += sin), nur in Bogenmass.
+		// Alle Matrizen auf einmal mit dem SIMD-Kernel, antTransform ohne Position und Drehung
+		// ist fuer alle gleich.
+		if (!sim.colonyX.empty())
+		{
+			TransformArrays colony = { &sim.colonyX[0], NULL, &sim.colonyY[0], &sim.colonyHeading[0], NULL };
+			colonyModels.resize(sim.colonyX.size());
+			computeTransforms(sceneTree.world(sceneNode), antTransform(glm::mat4(1.0f), 0.0f, 0.0f, 0.0f), colony, colonyModels.size(), &colonyModels[0]);
+			for (size_t i = 0; i < colonyModels.size(); i++)
+				submitAnt(ant, Texture, colonyModels[i]);
+		}
 
+		//the ball, haengt an der Ameise
+		submitNode(ballNode, sphereDrawable(10, 10), Texture);
+		profiler().end();
 
-		//draw the FoodDrops
-		for (size_t i = 0; i < foodNumber; i++)
+		//the FoodDrops, landen mit Achsen und Ball in einem Draw-Aufruf
+		profiler().begin("submit food");
+		const glm::mat4& foodWorld = sceneTree.world(foodNode);
+		for (size_t i = 0; i < sim.foodX->size(); i++)
 		{
-			Model = Save;
-			Model = glm::scale(Model, glm::vec3(0.2, 0.2, 0.2));
-			Model = glm::translate(Model, glm::vec3(randomFoodX[i], 0.0, randomFoodY[i]));
-			sendMVP();
-			shaderHelper();
-			drawSphere(10, 10);
+			glm::mat4 foodModel = glm::translate(foodWorld, glm::vec3((*sim.foodX)[i], 0.0, (*sim.foodY)[i]));
+			renderQueue.submit(sphereDrawable(10, 10), &instancedProgram, Texture, foodModel);
 		}
+		profiler().end();
+
+		// Unsichtbares verwerfen, sortieren (Programm, VAO, Textur, von vorne nach hinten) und zeichnen
+		profiler().begin("flush");
+		renderQueue.flush();
+		program.use();
+		profiler().end();
+		streamRing().endFrame();
 
 
 		// Bildende. 
@@ -499,39 +668,99 @@ int main(void)
 		// Dieses Problem vermeidet man, wenn man zwei Bildspeicher benutzt, wobei in einen gerade
 		// gemalt wird, bzw. dort ein neues Bild entsteht, und der andere auf dem Bildschirm ausgegeben wird.
 		// Ist man mit dem Erstellen eines Bildes fertig, tauscht man diese beiden Speicher einfach aus ("swap").
+		if (headless.enabled)
+		{
+			// Kein Swap: auf die GPU warten, damit die Zeit den ganzen Frame enthaelt
+			profiler().begin("finish", true);
+			glFinish();
+			profiler().end();
+			profiler().end(); // frame
+			profiler().endFrame();
+			frameTimes.push_back(wallClock() - frameStart);
+			frame++;
+			continue;
+		}
+		profiler().begin("swap", true);
 		glfwSwapBuffers(window);
+		profiler().end();
+
+		if (firstFrameTime < 0.0)
+			firstFrameTime = glfwGetTime() - loadStart;
+		if (!loadReported && assets.allReady())
+		{
+			printf("Assets (%s, %u threads): first frame after %.1f ms, all %d assets ready after %.1f ms\n",
+				sequentialLoad ? "sequential" : "parallel", assets.threadCount(), firstFrameTime * 1000.0,
+				assets.count(), (glfwGetTime() - loadStart) * 1000.0);
+			loadReported = true;
+		}
+		// DDS-Texturen sind schon vorher benutzbar, die vollen Mipmaps kommen erst danach
+		if (loadReported && !streamReported && assets.textureStreamer().idle())
+		{
+			printf("All textures at full resolution after %.1f ms\n", (glfwGetTime() - loadStart) * 1000.0);
+			assets.textureStreamer().printStats();
+			streamReported = true;
+		}
 
 		// Hier fordern wir glfw auf, Ereignisse zu behandeln. GLFW könnte hier z. B. feststellen,
 		// das die Mouse bewegt wurde und eine Taste betätigt wurde.
 		// Da wir zurzeit nur einen "key_callback" installiert haben, wird dann nur genau diese Funktion
 		// aus "glfwPollEvents" heraus aufgerufen.
+		profiler().begin("poll");
 		glfwPollEvents();
+		profiler().end();
 
 		glfwSetScrollCallback(window, scroll_callback);
+		profiler().end(); // frame
+		profiler().endFrame();
 	}
 
-	//textur loeschen
-	glDeleteTextures(1, &Texture);
+	// Headless endet mit 1, wenn eine GPU-Zeit nicht stimmen kann
+	int exitCode = 0;
+	if (headless.enabled)
+	{
+		printFrameTimes(frameTimes);
+		profiler().printStats();
+		if (!profiler().checkGpuTimes("frame"))
+			exitCode = 1;
+		printf("Entity pool allocations during the run: %u\n", simulation.poolAllocations() - poolAllocations);
+		printf("Colony ants near the ant: %u\n", sim.antsNearby);
+		streamRing().printStats();
+		printf("Scene tree: %u nodes, %.1f world matrices recomputed per frame\n", (unsigned int)sceneTree.size(),
+			frameTimes.empty() ? 0.0 : (double)transformUpdates / frameTimes.size());
+		printf("Last frame: %u objects drawn, %u draw calls, %u triangles (sphere LOD %s, multi-draw indirect %s)\n",
+			renderQueue.stats().submitted - renderQueue.stats().culled, renderQueue.stats().issued,
+			renderQueue.stats().triangles, headless.levelOfDetail ? "on" : "off",
+			meshArena().created() ? "on" : "off");
+		if (headless.tracePath)
+			profiler().writeTrace(headless.tracePath);
+		if (headless.checksum)
+			printf("Framebuffer checksum: %016llx\n", offscreen.checksum());
+	}
+
+	simulation.stopThread();
+	world = NULL;
+	pheromones.destroyTexture();
+
+	//texturen und meshes loeschen
+	assets.destroy();
+	glDeleteTextures(1, &placeholderTexture);
+	renderQueue.setIndirect(NULL, NULL);
+	indirectRenderer.destroy();
 
 	// Wenn der Benutzer, das Schliesskreuz oder die Escape-Taste betätigt hat, endet die Schleife und
 	// wir kommen an diese Stelle. Hier können wir aufräumen, und z. B. das Shaderprogramm in der
 	// Grafikkarte löschen. (Das macht zurnot das OS aber auch automatisch.)
-	glDeleteProgram(programID);
+	perFrameBuffer.destroy();
+	streamRing().destroy();
+	profiler().destroy();
+	program.destroy();
+	instancedProgram.destroy();
 
 	// Schießen des OpenGL-Fensters und beenden von GLFW.
-	glfwTerminate();
+	if (headless.enabled)
+		offscreen.destroy();
+	else
+		glfwTerminate();
 
-	return 0; // Integer zurückgeben, weil main so definiert ist
+	return exitCode; // Integer zurückgeben, weil main so definiert ist
 }
-
-//Unser neuer Shader
-//	kommt nicht mehr mit der zusammengefassten MVP‐Matrix alleine klar, sondern für die Beleuchtung
-//	benötigt er die Einzelmatrizen.Deshalb müssen wir Sie ihm immer schicken, wenn wir unseren
-//	Zustand im Adressraum mit seinem synchronisieren.Diese drei Zeilen gehören also nach „sendMVP“.
-void shaderHelper()
-{
-	glUniformMatrix4fv(glGetUniformLocation(programID, "M"), 1, GL_FALSE, &Model[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(programID, "V"), 1, GL_FALSE, &View[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(programID, "P"), 1, GL_FALSE, &Projection[0][0]);
-}
-
@@ -1,9 +1,94 @@
-﻿#include "Obj3D.hpp"
+﻿#include <stddef.h>
+#include <math.h>
+
+#include "Obj3D.hpp"
 #include "objloader.hpp"
+#include "meshcache.hpp"
+#include "objects.hpp"
+#include "shader.hpp"
+#include "indirect.hpp"
+
+// Ein Eckpunkt im kompakten Layout (16 Bytes)
+struct CompactVertex
+{
+	unsigned int positionXY; // 2 x 16 Bit unorm, relativ zur Bounding-Box
+	unsigned int positionZ;  // 16 Bit unorm, obere Haelfte ungenutzt
+	unsigned int normal;     // GL_INT_2_10_10_10_REV
+	unsigned int uv;         // 2 x half float
+};
+
+// Vorzeichenbehaftet normalisiert auf 10 Bit: -1..1 -> -511..511
+static unsigned int packSnorm10(float v)
+{
+	int value = (int)floor(glm::clamp(v, -1.0f, 1.0f) * 511.0f + 0.5f);
+	return (unsigned int)value & 0x3FF;
+}
+
+static unsigned int packNormal(const glm::vec3& normal)
+{
+	return packSnorm10(normal.x) | (packSnorm10(normal.y) << 10) | (packSnorm10(normal.z) << 20);
+}
+
+bool MeshData::load(const char* fn)
+{
+	// Beim ersten Laden wird die OBJ-Datei geparst und als .antmesh gespeichert, danach
+	// wird nur noch der Cache gemappt und direkt aus dem Mapping hochgeladen.
+	if (openMeshCache(fn, cache, streams))
+		return true;
+
+	// Gleiche Eckpunkte werden nur einmal gespeichert und ueber Indizes referenziert
+	bool res = loadOBJ(fn, indices, vertices, uvs, normals);
+
+	streams.positions = vertices.empty() ? NULL : &vertices[0];
+	streams.uvs = uvs.empty() ? NULL : &uvs[0];
+	streams.normals = normals.empty() ? NULL : &normals[0];
+	streams.vertexCount = (unsigned int)vertices.size();
+	streams.indexCount = (unsigned int)indices.size();
+	streams.indices = NULL;
+	streams.indexSize = 0;
+	streams.boundsMin = streams.boundsMax = glm::vec3(0.0f);
+	streams.boundsRadius = 0.0f;
+
+	// 16-Bit-Indizes reichen fuer kleine Meshes und sparen die Haelfte
+	if (vertices.size() <= 65536 && !indices.empty())
+	{
+		shortIndices.assign(indices.begin(), indices.end());
+		streams.indices = &shortIndices[0];
+		streams.indexSize = sizeof(unsigned short);
+	}
+	else if (!indices.empty())
+	{
+		streams.indices = &indices[0];
+		streams.indexSize = sizeof(unsigned int);
+	}
 
-Obj3D::Obj3D(const char* fn)
+	if (res)
+		writeMeshCache(fn, streams);
+	return res;
+}
+
+Obj3D::Obj3D(const char* fn, bool compact)
+	: normalbuffer(0), uvbuffer(0), arenaMeshID(-1), compactVertices(compact), positionScale(1.0f), positionOffset(0.0f)
+{
+	MeshData data;
+	data.load(fn);
+	create(data.streams);
+}
+
+Obj3D::Obj3D(const MeshData& data, bool compact)
+	: normalbuffer(0), uvbuffer(0), arenaMeshID(-1), compactVertices(compact), positionScale(1.0f), positionOffset(0.0f)
+{
+	create(data.streams);
+}
+
+void Obj3D::create(const MeshStreams& streams)
 {
-	bool res = loadOBJ(fn, vertices, uvs, normals);
+	vertexCount = streams.vertexCount;
+	indexCount = streams.indexCount;
+	indexType = streams.indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	boundsMin = streams.boundsMin;
+	boundsMax = streams.boundsMax;
+	boundsRadius = streams.boundsRadius;
 
 	// Jedes Objekt eigenem VAO zuordnen, damit mehrere Objekte moeglich sind
 	// VAOs sind Container fuer mehrere Buffer, die zusammen gesetzt werden sollen.
@@ -11,10 +96,31 @@ Obj3D::Obj3D(const char* fn)
 	glBindVertexArray(VertexArrayID);
 
 
+	if (compactVertices)
+		createCompactBuffer(streams);
+	else
+		createFloatBuffers(streams);
+
+	// Der Indexbuffer gehoert mit zum Zustand des VAO
+	glGenBuffers(1, &elementbuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * streams.indexSize, streams.indices, GL_STATIC_DRAW);
+
+	instancebuffer = createInstanceBuffer();
+
+	// Fuer den IndirectRenderer zusaetzlich in die gemeinsamen Buffer, dort immer ungepackt.
+	// Die eigenen Buffer bleiben fuer display() und falls die Arena voll ist.
+	if (meshArena().created() && streams.positions && streams.normals)
+		arenaMeshID = meshArena().add(streams.positions, streams.uvs, streams.normals, vertexCount,
+			streams.indices, streams.indexSize, indexCount, boundingSphere());
+}
+
+void Obj3D::createFloatBuffers(const MeshStreams& streams)
+{
 	glGenBuffers(1, &vertexbuffer); // Kennung erhalten
 	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer); // Daten zur Kennung definieren
 												 // Buffer zugreifbar f�r die Shader machen
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(glm::vec3), streams.positions, GL_STATIC_DRAW);
 
 	// Erst nach glEnableVertexAttribArray kann DrawArrays auf die Daten zugreifen...
 	glEnableVertexAttribArray(0); // siehe layout im vertex shader: location = 0 
@@ -27,22 +133,136 @@ Obj3D::Obj3D(const char* fn)
 
 	glGenBuffers(1, &normalbuffer);
 	glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(glm::vec3), streams.normals, GL_STATIC_DRAW);
 	glEnableVertexAttribArray(2); // siehe layout im vertex shader 
 	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
 	glGenBuffers(1, &uvbuffer);
 	glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-	glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(glm::vec2), streams.uvs, GL_STATIC_DRAW);
 	glEnableVertexAttribArray(1); // siehe layout im vertex shader 
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+}
+
+void Obj3D::createCompactBuffer(const MeshStreams& streams)
+{
+	// Quantisierung auf die Bounding-Box, eine flache Achse bekommt Scale 0
+	positionOffset = boundsMin;
+	positionScale = boundsMax - boundsMin;
+	glm::vec3 invScale;
+	for (int i = 0; i < 3; i++)
+		invScale[i] = positionScale[i] > 0.0f ? 1.0f / positionScale[i] : 0.0f;
+
+	std::vector<CompactVertex> packed(vertexCount);
+	for (GLsizei i = 0; i < vertexCount; i++)
+	{
+		glm::vec3 unit = (streams.positions[i] - positionOffset) * invScale;
+		packed[i].positionXY = glm::packUnorm2x16(glm::vec2(unit.x, unit.y));
+		packed[i].positionZ  = glm::packUnorm2x16(glm::vec2(unit.z, 0.0f));
+		packed[i].normal     = packNormal(streams.normals[i]);
+		packed[i].uv         = glm::packHalf2x16(streams.uvs[i]);
+	}
 
+	glGenBuffers(1, &vertexbuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(CompactVertex), packed.empty() ? NULL : &packed[0], GL_STATIC_DRAW);
+
+	// Alle drei Attribute liegen verschraenkt im selben Buffer (stride = 16 Bytes)
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, positionXY));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, uv));
+
+	size_t floatBytes = vertexCount * (2 * sizeof(glm::vec3) + sizeof(glm::vec2));
+	size_t compactBytes = vertexCount * sizeof(CompactVertex);
+	printf("Compact vertex layout: %d vertices, %u -> %u bytes/vertex, %.1f KB -> %.1f KB\n",
+		(int)vertexCount, (unsigned int)(2 * sizeof(glm::vec3) + sizeof(glm::vec2)), (unsigned int)sizeof(CompactVertex),
+		floatBytes / 1024.0, compactBytes / 1024.0);
 }
 
 void Obj3D::display()
 {
+	displayWith(0);
+}
+
+void Obj3D::displayInstanced(const glm::mat4* models, GLsizei count)
+{
+	if (count <= 0)
+		return;
+
+	glBindVertexArray(VertexArrayID);
+	uploadInstanceMatrices(instancebuffer, models, count);
+	displayWith(count);
+}
+
+// Handles von PositionScale und PositionOffset, einmal pro Programm nachgeschlagen
+struct PositionHandles
+{
+	const ShaderProgram* program;
+	GLuint id; // neu nachschlagen, wenn das Programm neu geladen wurde
+	int scale;
+	int offset;
+};
+
+static PositionHandles positionHandles(ShaderProgram* program)
+{
+	static std::vector<PositionHandles> known;
+	for (size_t i = 0; i < known.size(); i++)
+	{
+		if (known[i].program != program)
+			continue;
+		if (known[i].id != program->id())
+		{
+			known[i].id = program->id();
+			known[i].scale = program->uniform("PositionScale");
+			known[i].offset = program->uniform("PositionOffset");
+		}
+		return known[i];
+	}
+
+	PositionHandles handles = { program, program->id(), program->uniform("PositionScale"),
+		program->uniform("PositionOffset") };
+	known.push_back(handles);
+	return handles;
+}
+
+void Obj3D::displayWith(GLsizei instances)
+{
+	// Die Dequantisierung gilt nur fuer dieses Objekt, alle anderen zeichnen mit Scale 1 und Offset 0
+	ShaderProgram* program = compactVertices ? ShaderProgram::current() : NULL;
+	PositionHandles handles = { NULL, 0, -1, -1 };
+	if (program)
+	{
+		handles = positionHandles(program);
+		program->set(handles.scale, positionScale);
+		program->set(handles.offset, positionOffset);
+	}
+
 	glBindVertexArray(VertexArrayID);
-	glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+	if (instances == 0)
+		glDrawElements(GL_TRIANGLES, indexCount, indexType, (void*)0);
+	else
+		glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, (void*)0, instances);
+
+	if (program)
+	{
+		program->set(handles.scale, glm::vec3(1.0f));
+		program->set(handles.offset, glm::vec3(0.0f));
+	}
+}
+
+BoundingBox Obj3D::boundingBox()
+{
+	BoundingBox box = { boundsMin, boundsMax };
+	return box;
+}
+
+BoundingSphere Obj3D::boundingSphere()
+{
+	BoundingSphere sphere = { (boundsMin + boundsMax) * 0.5f, boundsRadius };
+	return sphere;
 }
 
 Obj3D::~Obj3D()
@@ -50,4 +270,6 @@ Obj3D::~Obj3D()
 	glDeleteBuffers(1, &vertexbuffer);
 	glDeleteBuffers(1, &normalbuffer);
 	glDeleteBuffers(1, &uvbuffer);
+	glDeleteBuffers(1, &elementbuffer);
+	glDeleteBuffers(1, &instancebuffer);
 }
\ No newline at end of file
@@ -16,21 +16,68 @@
 #include <glm/gtc/matrix_transform.hpp>
 using namespace glm;
 
-class Obj3D
-{
-	// Memberdaten
-	GLuint VertexArrayID;
+#include "renderqueue.hpp"
+#include "meshcache.hpp"
 
+// CPU-Seite eines Meshes: der gemappte Cache oder frisch geparste Daten, auf die streams zeigt.
+// Braucht kein OpenGL und kann deshalb in einem Worker-Thread geladen werden (AssetLoader).
+struct MeshData
+{
+	MappedFile cache;
+	MeshStreams streams;
+	std::vector<unsigned int> indices;
+	std::vector<unsigned short> shortIndices;
 	std::vector<glm::vec3> vertices;
 	std::vector<glm::vec2> uvs;
 	std::vector<glm::vec3> normals;
 
+	bool load(const char* fn);
+};
+
+class Obj3D : public Drawable
+{
+	// Memberdaten
+	GLuint VertexArrayID;
+
+	GLsizei vertexCount;
+	GLsizei indexCount;
+	GLenum indexType;    // GL_UNSIGNED_SHORT oder GL_UNSIGNED_INT
+	glm::vec3 boundsMin; // Bounding-Box in Modellkoordinaten
+	glm::vec3 boundsMax;
+	float boundsRadius;  // umschliessende Kugel um die Mitte der Box
+
 	GLuint vertexbuffer;
 	GLuint normalbuffer;
 	GLuint uvbuffer;
+	GLuint elementbuffer;
+	GLuint instancebuffer; // Model-Matrizen fuer displayInstanced
+	int arenaMeshID;       // Kopie in der MeshArena (ungepackt) oder -1
+
+	// Kompaktes Layout: ein verschraenkter Buffer mit 16 statt 32 Bytes je Eckpunkt.
+	// Die Positionen sind auf die Bounding-Box quantisiert, der Shader rechnet sie mit
+	// PositionScale und PositionOffset zurueck.
+	bool compactVertices;
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+
+	void create(const MeshStreams& streams);
+	void createFloatBuffers(const MeshStreams& streams);
+	void createCompactBuffer(const MeshStreams& streams);
+	void displayWith(GLsizei instances); // 0: nicht instanziert
 
 public:
-	Obj3D(const char* fn); // Konstruktor
+	Obj3D(const char* fn, bool compact = false); // Konstruktor
+	Obj3D(const MeshData& data, bool compact = false); // nur hochladen, data wurde schon geladen
 	void display();
+	// Zeichnet das Objekt count mal in einem Aufruf, mit StandardShadingInstanced.vertexshader
+	void displayInstanced(const glm::mat4* models, GLsizei count);
+
+	// Drawable, fuer die Render-Queue
+	GLuint vertexArray() { return VertexArrayID; }
+	void drawInstanced(const glm::mat4* models, GLsizei count) { displayInstanced(models, count); }
+	BoundingBox boundingBox();
+	BoundingSphere boundingSphere();
+	unsigned int triangleCount() { return (unsigned int)indexCount / 3; }
+	int arenaMesh() { return arenaMeshID; }
 	~Obj3D(); // Destruktor
 };
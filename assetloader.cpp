@@ -0,0 +1,238 @@
+#include <stdio.h>
+
+#include <GL/glew.h>
+
+#include "assetloader.hpp"
+#include "Obj3D.hpp"
+#include "texture.hpp"
+#include "texturecooker.hpp"
+#include "profiler.hpp"
+
+AssetLoader::AssetLoader(unsigned int threads)
+	: stopping(false), readyCount(0)
+{
+	useCooked = GLEW_EXT_texture_compression_s3tc != 0;
+	streamer.create(1024 * 1024, 3);
+
+	for (unsigned int i = 0; i < threads; i++)
+		workers.push_back(std::thread(&AssetLoader::workerLoop, this));
+}
+
+AssetLoader::~AssetLoader()
+{
+	stopWorkers();
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		delete assets[i]->meshData;
+		delete assets[i]->image;
+		delete assets[i]->compressed;
+		delete assets[i];
+	}
+}
+
+void AssetLoader::stopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeWorkers.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+}
+
+int AssetLoader::loadMesh(const char* path, bool compact)
+{
+	Asset* asset = new Asset();
+	asset->path = path;
+	asset->isMesh = true;
+	asset->compact = compact;
+	return add(asset);
+}
+
+int AssetLoader::loadTexture(const char* path)
+{
+	Asset* asset = new Asset();
+	asset->path = path;
+	asset->isMesh = false;
+	asset->compact = false;
+	return add(asset);
+}
+
+int AssetLoader::add(Asset* asset)
+{
+	asset->failed = false;
+	asset->meshData = NULL;
+	asset->image = NULL;
+	asset->compressed = NULL;
+	asset->mesh = NULL;
+	asset->texture = 0;
+	asset->ready = false;
+
+	int handle;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		handle = (int)assets.size();
+		assets.push_back(asset);
+	}
+
+	if (workers.empty())
+	{
+		// Sequentiell: sofort laden, hochgeladen wird trotzdem erst in uploadFinished
+		loadAsset(*asset);
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.push_back(handle);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.push_back(handle);
+		}
+		wakeWorkers.notify_one();
+	}
+	return handle;
+}
+
+void AssetLoader::workerLoop()
+{
+	for (;;)
+	{
+		int handle;
+		Asset* asset;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (pending.empty() && !stopping)
+				wakeWorkers.wait(lock);
+			if (pending.empty())
+				return;
+
+			handle = pending.front();
+			pending.pop_front();
+			asset = assets[handle];
+		}
+
+		loadAsset(*asset);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.push_back(handle);
+	}
+}
+
+void AssetLoader::loadAsset(Asset& asset)
+{
+	ProfileScope scope(asset.isMesh ? "load mesh" : "load texture");
+	if (asset.isMesh)
+	{
+		asset.meshData = new MeshData();
+		asset.failed = !asset.meshData->load(asset.path.c_str());
+	}
+	else
+	{
+		if (useCooked)
+		{
+			CookStats stats;
+			bool fresh = cookedTextureFresh(asset.path.c_str());
+			profiler().begin("cook texture");
+			bool cooked = !fresh && cookTexture(asset.path.c_str(), &stats);
+			profiler().end();
+			if (cooked)
+			{
+				printCookStats(asset.path.c_str(), stats);
+				fresh = true;
+			}
+
+			asset.compressed = new MappedDDS();
+			if (fresh && mapDDS(cookedTexturePath(asset.path.c_str()).c_str(), *asset.compressed, true))
+				return;
+			delete asset.compressed;
+			asset.compressed = NULL;
+		}
+
+		// Nur mappen und die Seiten einlesen, kopiert wird beim Streamen
+		asset.image = new MappedBMP();
+		asset.failed = !mapBMP(asset.path.c_str(), *asset.image, true);
+		if (!asset.failed)
+			buildMipmaps(*asset.image);
+	}
+}
+
+int AssetLoader::uploadFinished(size_t textureBudget)
+{
+	std::vector<int> loaded;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		loaded.swap(finished);
+	}
+
+	int newlyReady = 0;
+	for (size_t i = 0; i < loaded.size(); i++)
+	{
+		Asset& asset = *assets[loaded[i]];
+		if (asset.isMesh)
+		{
+			// Wie bisher wird auch ein fehlgeschlagenes Mesh (leer) angelegt
+			asset.mesh = new Obj3D(*asset.meshData, asset.compact);
+			delete asset.meshData;
+			asset.meshData = NULL;
+		}
+		else if (asset.compressed)
+		{
+			// Sofort benutzbar (kleine Level), der Rest kommt ueber das Budget in update()
+			asset.texture = streamer.stream(asset.compressed);
+			asset.compressed = NULL;
+		}
+		else if (!asset.failed)
+		{
+			// Der Streamer uebernimmt das Mapping, fertig ist die Textur erst nach dem letzten Streifen
+			asset.texture = streamer.stream(asset.image);
+			asset.image = NULL;
+			streaming.push_back(loaded[i]);
+			continue;
+		}
+		asset.ready = true;
+		readyCount++;
+		newlyReady++;
+	}
+
+	streamer.update(textureBudget);
+	for (size_t i = 0; i < streaming.size(); )
+	{
+		Asset& asset = *assets[streaming[i]];
+		if (streamer.isStreaming(asset.texture))
+		{
+			i++;
+			continue;
+		}
+		asset.ready = true;
+		readyCount++;
+		newlyReady++;
+		streaming.erase(streaming.begin() + i);
+	}
+	return newlyReady;
+}
+
+Obj3D* AssetLoader::mesh(int handle) const
+{
+	return assets[handle]->ready ? assets[handle]->mesh : NULL;
+}
+
+GLuint AssetLoader::texture(int handle) const
+{
+	return assets[handle]->ready ? assets[handle]->texture : 0;
+}
+
+void AssetLoader::destroy()
+{
+	stopWorkers();
+	streamer.destroy(); // auch noch nicht fertige Texturen
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		delete assets[i]->mesh;
+		assets[i]->mesh = NULL;
+		if (assets[i]->ready && assets[i]->texture)
+			glDeleteTextures(1, &assets[i]->texture);
+		assets[i]->texture = 0;
+	}
+}
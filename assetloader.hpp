@@ -0,0 +1,92 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "texturestream.hpp"
+
+class Obj3D;
+struct MeshData;
+struct MappedBMP;
+struct MappedDDS;
+
+// Laedt Meshes und Bilder in einem Thread-Pool, waehrend das Fenster schon zeichnet.
+// Die Worker parsen bzw. dekodieren nur (kein OpenGL). Fertige Daten landen in einer
+// Warteschlange, die der GL-Thread in jedem Frame mit uploadFinished() abarbeitet.
+// Bilder werden nur gemappt und dann ueber mehrere Frames gestreamt (TextureStreamer).
+// Kann der Treiber S3TC, komprimiert der Worker sie vorher einmal nach BC1 (texturecooker.hpp)
+// und mappt die .dds-Datei. Deren kleine Level sind sofort da, die Textur gilt damit als fertig,
+// die grossen kommen in den naechsten Frames dazu.
+// Bis dahin liefern mesh() und texture() NULL bzw. 0, die Szene zeichnet Platzhalter.
+// Mit 0 Threads wird alles sofort im aufrufenden Thread geladen (sequentiell, zum Vergleich).
+class AssetLoader
+{
+	struct Asset
+	{
+		std::string path;
+		bool isMesh;
+		bool compact;
+		bool failed;
+
+		// Ergebnis des Workers, wird nach dem Hochladen freigegeben
+		MeshData* meshData;
+		MappedBMP* image;
+		MappedDDS* compressed;
+
+		// Nach dem Hochladen
+		Obj3D* mesh;
+		GLuint texture;
+		bool ready;
+	};
+
+	std::vector<Asset*> assets; // Handle = Index
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wakeWorkers;
+	std::deque<int> pending;  // noch nicht angefangen
+	std::vector<int> finished; // geladen, warten auf den GL-Thread
+	std::vector<int> streaming; // Texturen, die gerade hochgeladen werden
+	TextureStreamer streamer;
+	bool stopping;
+	bool useCooked; // S3TC vorhanden
+	int readyCount;
+
+	int add(Asset* asset);
+	void workerLoop();
+	void loadAsset(Asset& asset);
+	void stopWorkers();
+
+	AssetLoader(const AssetLoader&);            // nicht kopierbar
+	AssetLoader& operator=(const AssetLoader&);
+
+public:
+	explicit AssetLoader(unsigned int threads); // im GL-Thread anlegen (Ring fuer den Streamer)
+	~AssetLoader(); // wartet auf die Worker, gibt aber keine OpenGL-Objekte frei (siehe destroy)
+
+	// Reiht ein Asset ein und gibt sein Handle zurueck
+	int loadMesh(const char* path, bool compact = false);
+	int loadTexture(const char* path);
+
+	// Nur im GL-Thread, einmal pro Frame: legt alle inzwischen fertigen Assets an und
+	// streamt hoechstens textureBudget Bytes Texturdaten. Rueckgabe ist die Anzahl neu fertiger Assets.
+	int uploadFinished(size_t textureBudget);
+
+	Obj3D* mesh(int handle) const;    // NULL, solange nicht hochgeladen
+	GLuint texture(int handle) const; // 0, solange nicht hochgeladen oder fehlgeschlagen
+	bool allReady() const { return readyCount == (int)assets.size(); }
+	int count() const { return (int)assets.size(); }
+	unsigned int threadCount() const { return (unsigned int)workers.size(); }
+
+	// Gibt Meshes und Texturen frei, solange der OpenGL-Kontext noch existiert
+	void destroy();
+
+	const TextureStreamer& textureStreamer() const { return streamer; }
+};
+
+#endif
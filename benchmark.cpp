@@ -0,0 +1,639 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "objloader.hpp"
+#include "mappedfile.hpp"
+#include "texturecooker.hpp"
+#include "colony.hpp"
+#include "pheromone.hpp"
+#include "spatialgrid.hpp"
+#include "entitypool.hpp"
+#include "transform.hpp"
+#include "benchmark.hpp"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename T>
+static bool sameContents(const std::vector<T>& a, const std::vector<T>& b)
+{
+	return a.size() == b.size() && (a.empty() || memcmp(&a[0], &b[0], a.size() * sizeof(T)) == 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    OBJ-Loader: fscanf-Referenz gegen parallelen Parser
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef bool (*ObjLoaderFunc)(const char*, std::vector<glm::vec3>&, std::vector<glm::vec2>&, std::vector<glm::vec3>&);
+
+// Bestes Ergebnis aus mehreren Durchlaeufen, damit der Plattencache nicht mitgemessen wird
+static double timeObjLoader(ObjLoaderFunc loader, const char* path, int repeats,
+	std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs, std::vector<glm::vec3>& normals)
+{
+	double best = 1e30;
+	for (int i = 0; i < repeats; i++)
+	{
+		vertices.clear();
+		uvs.clear();
+		normals.clear();
+
+		Clock::time_point start = Clock::now();
+		if (!loader(path, vertices, uvs, normals))
+			return -1.0;
+		double seconds = secondsSince(start);
+		if (seconds < best)
+			best = seconds;
+	}
+	return best;
+}
+
+static int benchObjLoader(int argc, char* argv[])
+{
+	if (argc < 1)
+		return -1;
+
+	const char* path = argv[0];
+	int repeats = argc > 1 ? atoi(argv[1]) : 3;
+	if (repeats < 1)
+		repeats = 1;
+
+	MappedFile file;
+	if (!file.open(path))
+	{
+		printf("%s could not be opened\n", path);
+		return EXIT_FAILURE;
+	}
+	double megabytes = file.size() / (1024.0 * 1024.0);
+	file.close();
+
+	std::vector<glm::vec3> refVertices, vertices;
+	std::vector<glm::vec2> refUvs, uvs;
+	std::vector<glm::vec3> refNormals, normals;
+
+	double refSeconds = timeObjLoader(loadOBJReference, path, repeats, refVertices, refUvs, refNormals);
+	double seconds = timeObjLoader(loadOBJ, path, repeats, vertices, uvs, normals);
+	if (refSeconds < 0 || seconds < 0)
+		return EXIT_FAILURE;
+
+	bool identical = sameContents(refVertices, vertices) && sameContents(refUvs, uvs) && sameContents(refNormals, normals);
+
+	printf("\n%s: %.1f MB, %u Eckpunkte, bestes von %d\n", path, megabytes, (unsigned int)vertices.size(), repeats);
+	printf("  loadOBJReference (fscanf) %10.1f ms %10.1f MB/s\n", refSeconds * 1000.0, megabytes / refSeconds);
+	printf("  loadOBJ (mmap, parallel)  %10.1f ms %10.1f MB/s  (x%.1f)\n", seconds * 1000.0, megabytes / seconds, refSeconds / seconds);
+	printf("  Ergebnis %s\n", identical ? "identisch" : "NICHT identisch");
+
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Texture-Cooker: skalarer gegen SSE2-Blockencoder
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double timeCompressImage(const std::vector<unsigned char>& rgba, unsigned int width, unsigned int height,
+	bool alpha, bool simd, int repeats, CompressedImage& image)
+{
+	double best = 1e30;
+	for (int i = 0; i < repeats; i++)
+	{
+		Clock::time_point start = Clock::now();
+		compressImage(&rgba[0], width, height, alpha, image, simd);
+		double seconds = secondsSince(start);
+		if (seconds < best)
+			best = seconds;
+	}
+	return best;
+}
+
+static int benchTextureCooker(int argc, char* argv[])
+{
+	if (argc < 1 || (argc > 1 && strcmp(argv[1], "bc1") != 0 && strcmp(argv[1], "bc3") != 0))
+		return -1;
+
+	const char* path = argv[0];
+	bool alpha = argc > 1 && strcmp(argv[1], "bc3") == 0;
+	int repeats = argc > 2 ? atoi(argv[2]) : 3;
+	if (repeats < 1)
+		repeats = 1;
+
+	std::vector<unsigned char> rgba;
+	unsigned int width, height;
+	if (!loadImageRGBA(path, rgba, width, height) || width == 0 || height == 0)
+		return EXIT_FAILURE;
+
+	CompressedImage scalarImage, image;
+	double scalarSeconds = timeCompressImage(rgba, width, height, alpha, false, repeats, scalarImage);
+	double seconds = timeCompressImage(rgba, width, height, alpha, true, repeats, image);
+
+	bool identical = scalarImage.levels.size() == image.levels.size();
+	unsigned long long texels = 0, compressedBytes = 0;
+	for (size_t i = 0; i < image.levels.size(); i++)
+	{
+		unsigned long long levelWidth = width >> i ? width >> i : 1;
+		unsigned long long levelHeight = height >> i ? height >> i : 1;
+		texels += levelWidth * levelHeight;
+		compressedBytes += image.levels[i].size();
+		identical = identical && sameContents(scalarImage.levels[i], image.levels[i]);
+	}
+
+	printf("\n%s: %ux%u, %s, %u Level, bestes von %d\n", path, width, height, alpha ? "BC3" : "BC1",
+		(unsigned int)image.levels.size(), repeats);
+	printf("  skalar  %10.1f ms %10.1f MPix/s\n", scalarSeconds * 1000.0, texels / scalarSeconds / 1e6);
+	printf("  SSE2    %10.1f ms %10.1f MPix/s  (x%.1f)\n", seconds * 1000.0, texels / seconds / 1e6, scalarSeconds / seconds);
+	printf("  PSNR Level 0 %.2f dB, VRAM %llu KB -> %llu KB\n", computePSNR(&rgba[0], image),
+		texels * 4 / 1024, compressedBytes / 1024);
+	printf("  Ergebnis %s\n", identical ? "identisch" : "NICHT identisch");
+
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Kolonie: skalarer gegen AVX2-Kernel, ein Kern
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Schritte mit 60 Hz, bestes Ergebnis aus mehreren Durchlaeufen, in Ameisen pro Sekunde
+static double timeColonyUpdate(Colony& colony, int steps, bool simd, int repeats)
+{
+	double best = 1e30;
+	for (int i = 0; i < repeats; i++)
+	{
+		Clock::time_point start = Clock::now();
+		for (int s = 0; s < steps; s++)
+			colony.update(1.0f / 60.0f, simd);
+		double seconds = secondsSince(start);
+		if (seconds < best)
+			best = seconds;
+	}
+	return (double)colony.size() * steps / best;
+}
+
+static int benchColony(int argc, char* argv[])
+{
+	int repeats = argc > 0 ? atoi(argv[0]) : 3;
+	if (repeats < 1)
+		repeats = 1;
+
+	printf("\nKolonie-Update (Richtung, Bewegung, Rand), ein Kern, AVX2 %s\n",
+		Colony::hasAVX2() ? "vorhanden" : "NICHT vorhanden, beide Zeilen skalar");
+	printf("  %9s %16s %16s\n", "Ameisen", "skalar Mio/s", "AVX2 Mio/s");
+
+	bool identical = true;
+	const size_t counts[] = { 10000, 100000, 1000000 };
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		// Etwa 20 Mio. Ameisen-Schritte pro Messung
+		int steps = (int)(20000000 / counts[c]);
+
+		Colony scalar(2.0f, 3.0f), simd(2.0f, 3.0f);
+		scalar.spawn(counts[c], 0.0f, 0.0f, 0.3f, 72);
+		simd.spawn(counts[c], 0.0f, 0.0f, 0.3f, 72);
+		double scalarRate = timeColonyUpdate(scalar, steps, false, repeats);
+		double simdRate = timeColonyUpdate(simd, steps, true, repeats);
+
+		identical = identical && sameContents(scalar.x, simd.x) && sameContents(scalar.y, simd.y) &&
+			sameContents(scalar.heading, simd.heading) && sameContents(scalar.random, simd.random);
+		printf("  %9u %16.1f %16.1f  (x%.1f)\n", (unsigned int)counts[c], scalarRate / 1e6, simdRate / 1e6,
+			simdRate / scalarRate);
+	}
+	printf("  Ergebnis %s\n", identical ? "identisch" : "NICHT identisch");
+
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Duftspuren: Zerfliessen und Verdunsten, skalar gegen SSE2, alle Kerne
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Zellen pro Sekunde (beide Kanaele je Zelle), bestes Ergebnis aus mehreren Durchlaeufen
+static double timePheromoneUpdate(PheromoneField& field, int steps, bool simd, int repeats)
+{
+	double best = 1e30;
+	for (int i = 0; i < repeats; i++)
+	{
+		Clock::time_point start = Clock::now();
+		for (int s = 0; s < steps; s++)
+			field.update(1.0f / 60.0f, simd);
+		double seconds = secondsSince(start);
+		if (seconds < best)
+			best = seconds;
+	}
+	double cells = (double)field.cellsPerSide() * field.cellsPerSide();
+	return cells * steps / best;
+}
+
+static int benchPheromone(int argc, char* argv[])
+{
+	int repeats = argc > 0 ? atoi(argv[0]) : 3;
+	if (repeats < 1)
+		repeats = 1;
+
+	unsigned int threads = std::thread::hardware_concurrency();
+	if (!threads)
+		threads = 1;
+	printf("\nDuftspuren-Update (2 Kanaele, 5-Punkte-Stencil, Kacheln %dx%d), %u Threads, alle Zellen belegt\n",
+		(int)PheromoneField::TILE, (int)PheromoneField::TILE, threads);
+	printf("  %9s %18s %18s\n", "Gitter", "skalar MZellen/s", "SSE2 MZellen/s");
+
+	bool identical = true;
+	const int sizes[] = { 1024, 4096 };
+	for (size_t c = 0; c < sizeof(sizes) / sizeof(sizes[0]); c++)
+	{
+		int size = sizes[c];
+		int steps = std::max(2, (int)(200000000.0 / ((double)size * size)));
+
+		// Zufaellige Werte ueber der Schwelle, damit keine Kachel uebersprungen wird
+		std::vector<float> values((size_t)size * size);
+		unsigned int r = 72;
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			r = r * 1664525u + 1013904223u;
+			values[i] = 100.0f + (r >> 8) * (1.0f / 16777216.0f);
+		}
+
+		PheromoneField scalar(size, 2.0f, 1.0f, 0.3f), simd(size, 2.0f, 1.0f, 0.3f);
+		scalar.setThreadCount(threads);
+		simd.setThreadCount(threads);
+		for (int ch = 0; ch < PHEROMONE_CHANNELS; ch++)
+		{
+			scalar.fill((PheromoneChannel)ch, values);
+			simd.fill((PheromoneChannel)ch, values);
+		}
+		double scalarRate = timePheromoneUpdate(scalar, steps, false, repeats);
+		double simdRate = timePheromoneUpdate(simd, steps, true, repeats);
+
+		for (int ch = 0; ch < PHEROMONE_CHANNELS; ch++)
+			identical = identical && memcmp(scalar.channel((PheromoneChannel)ch), simd.channel((PheromoneChannel)ch),
+				values.size() * sizeof(float)) == 0;
+		printf("  %4d^2    %18.1f %18.1f  (x%.1f)\n", size, scalarRate / 1e6, simdRate / 1e6, simdRate / scalarRate);
+	}
+	printf("  Ergebnis %s\n", identical ? "identisch" : "NICHT identisch");
+
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Gitter fuer Nachbarn: alle Eintraege durchsuchen gegen SpatialGrid, ein Kern
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void bruteRadius(const std::vector<float>& x, const std::vector<float>& y, float qx, float qy, float radius,
+	std::vector<unsigned int>& result)
+{
+	float radius2 = radius * radius;
+	for (size_t i = 0; i < x.size(); i++)
+	{
+		float dx = x[i] - qx, dy = y[i] - qy;
+		if (dx * dx + dy * dy <= radius2)
+			result.push_back((unsigned int)i);
+	}
+}
+
+// Die k kleinsten Abstaende^2, aufsteigend
+static void bruteNearest(const std::vector<float>& x, const std::vector<float>& y, float qx, float qy, size_t k,
+	float* best2)
+{
+	size_t found = 0;
+	for (size_t i = 0; i < x.size(); i++)
+	{
+		float dx = x[i] - qx, dy = y[i] - qy;
+		float d2 = dx * dx + dy * dy;
+		if (found == k && d2 >= best2[k - 1])
+			continue;
+		size_t slot = found < k ? found++ : k - 1;
+		while (slot > 0 && best2[slot - 1] > d2)
+		{
+			best2[slot] = best2[slot - 1];
+			slot--;
+		}
+		best2[slot] = d2;
+	}
+}
+
+static int benchSpatialGrid(int argc, char* argv[])
+{
+	int repeats = argc > 0 ? atoi(argv[0]) : 3;
+	if (repeats < 1)
+		repeats = 1;
+
+	const size_t queryCount = 1000;
+	const size_t k = 8;
+	printf("\nNachbarsuche in [-2, 2]^2, %u Abfragen, Radius fuer etwa 16 Treffer, k = %u, ein Kern\n",
+		(unsigned int)queryCount, (unsigned int)k);
+	printf("  %9s %10s %22s %22s\n", "Eintraege", "Aufbau ms", "Radius us/Abfrage", "k naechste us/Abfrage");
+	printf("  %9s %10s %11s %10s %11s %10s\n", "", "", "alle", "Gitter", "alle", "Gitter");
+
+	bool identical = true;
+	const size_t counts[] = { 1000, 100000, 1000000 };
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		size_t count = counts[c];
+		std::vector<float> x(count), y(count), qx(queryCount), qy(queryCount);
+		unsigned int r = 72;
+		for (size_t i = 0; i < count; i++)
+		{
+			r = r * 1664525u + 1013904223u;
+			x[i] = -2.0f + (r >> 8) * (4.0f / 16777216.0f);
+			r = r * 1664525u + 1013904223u;
+			y[i] = -2.0f + (r >> 8) * (4.0f / 16777216.0f);
+		}
+		for (size_t i = 0; i < queryCount; i++)
+		{
+			r = r * 1664525u + 1013904223u;
+			qx[i] = -2.0f + (r >> 8) * (4.0f / 16777216.0f);
+			r = r * 1664525u + 1013904223u;
+			qy[i] = -2.0f + (r >> 8) * (4.0f / 16777216.0f);
+		}
+
+		// pi r^2 * Dichte = 16, Zellen so gross wie der Radius
+		float radius = sqrtf(16.0f * 16.0f / (3.14159265f * count));
+		SpatialGrid grid(2.0f, radius);
+		grid.setThreadCount(1);
+
+		double build = 1e30, bruteRadiusTime = 1e30, gridRadiusTime = 1e30, bruteNearestTime = 1e30, gridNearestTime = 1e30;
+		std::vector<unsigned int> bruteHits, gridHits;
+		std::vector<float> bruteBest(queryCount * k), gridBest(queryCount * k);
+		std::vector<unsigned int> gridIndices(k);
+		for (int rep = 0; rep < repeats; rep++)
+		{
+			Clock::time_point start = Clock::now();
+			grid.build(&x[0], &y[0], count);
+			build = std::min(build, secondsSince(start));
+
+			start = Clock::now();
+			bruteHits.clear();
+			for (size_t q = 0; q < queryCount; q++)
+				bruteRadius(x, y, qx[q], qy[q], radius, bruteHits);
+			bruteRadiusTime = std::min(bruteRadiusTime, secondsSince(start));
+
+			start = Clock::now();
+			gridHits.clear();
+			for (size_t q = 0; q < queryCount; q++)
+				grid.queryRadius(qx[q], qy[q], radius, gridHits);
+			gridRadiusTime = std::min(gridRadiusTime, secondsSince(start));
+
+			start = Clock::now();
+			for (size_t q = 0; q < queryCount; q++)
+				bruteNearest(x, y, qx[q], qy[q], k, &bruteBest[q * k]);
+			bruteNearestTime = std::min(bruteNearestTime, secondsSince(start));
+
+			start = Clock::now();
+			for (size_t q = 0; q < queryCount; q++)
+				grid.nearest(qx[q], qy[q], k, 1e30f, &gridIndices[0], &gridBest[q * k]);
+			gridNearestTime = std::min(gridNearestTime, secondsSince(start));
+		}
+
+		// Gleiche Treffer (das Gitter liefert sie pro Abfrage in anderer Reihenfolge) und gleiche Abstaende
+		std::sort(bruteHits.begin(), bruteHits.end());
+		std::sort(gridHits.begin(), gridHits.end());
+		identical = identical && bruteHits == gridHits && sameContents(bruteBest, gridBest);
+
+		printf("  %9u %10.3f %11.2f %10.3f %11.2f %10.3f  (x%.0f, x%.0f)\n", (unsigned int)count, build * 1e3,
+			bruteRadiusTime * 1e6 / queryCount, gridRadiusTime * 1e6 / queryCount,
+			bruteNearestTime * 1e6 / queryCount, gridNearestTime * 1e6 / queryCount,
+			bruteRadiusTime / gridRadiusTime, bruteNearestTime / gridNearestTime);
+	}
+	printf("  Ergebnis %s\n", identical ? "identisch" : "NICHT identisch");
+
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Entity-Pool: spawn/despawn im Wechsel, Allokationen und alte Handles
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct BenchEntity
+{
+	float x, y, amount;
+};
+
+static int benchEntityPool(int argc, char* argv[])
+{
+	int repeats = argc > 0 ? atoi(argv[0]) : 3;
+	if (repeats < 1)
+		repeats = 1;
+
+	printf("\nEntity-Pool: je ein zufaelliges despawn und ein spawn, dann einmal dicht durchlaufen, ein Kern\n");
+	printf("  %9s %14s %16s %14s %12s\n", "Eintraege", "ns/(de)spawn", "ns/Eintrag lesen", "Allokationen", "alte Handles");
+
+	bool ok = true;
+	const size_t counts[] = { 1000, 100000, 1000000 };
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		size_t count = counts[c];
+		const size_t operations = 2000000;
+
+		EntityPool<BenchEntity> pool(count);
+		std::vector<EntityHandle> live(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			BenchEntity entity = { (float)i, 0.0f, 1.0f };
+			live[i] = pool.spawn(entity);
+		}
+		unsigned int allocationsBefore = pool.allocations();
+
+		double churn = 1e30, iterate = 1e30;
+		unsigned int staleFound = 0;
+		float sum = 0.0f;
+		unsigned int r = 72;
+		for (int rep = 0; rep < repeats; rep++)
+		{
+			Clock::time_point start = Clock::now();
+			for (size_t i = 0; i < operations; i++)
+			{
+				r = r * 1664525u + 1013904223u;
+				size_t victim = (r >> 8) % count;
+				EntityHandle old = live[victim];
+				pool.despawn(old);
+				BenchEntity entity = { (float)i, 1.0f, 1.0f };
+				live[victim] = pool.spawn(entity);
+				// Der Platz wird sofort wiederverwendet, der alte Handle darf trotzdem nichts finden
+				if (pool.get(old))
+					staleFound++;
+			}
+			churn = std::min(churn, secondsSince(start));
+
+			start = Clock::now();
+			for (size_t i = 0; i < pool.size(); i++)
+				sum += pool[i].x * pool[i].amount;
+			iterate = std::min(iterate, secondsSince(start));
+		}
+
+		unsigned int allocations = pool.allocations() - allocationsBefore;
+		ok = ok && allocations == 0 && staleFound == 0 && pool.size() == count && sum != 0.0f;
+		printf("  %9u %14.1f %16.2f %14u %12u\n", (unsigned int)count, churn * 1e9 / (2.0 * operations),
+			iterate * 1e9 / count, allocations, staleFound);
+	}
+	printf("  Ergebnis %s\n", ok ? "ohne Allokationen, alte Handles ungueltig" : "FEHLER");
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Transformationen: translate/rotate/scale pro Objekt gegen die SIMD-Kernel
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Groesster Unterschied zweier Matrizen, relativ zur Groesse des Elements (mindestens 1)
+static float matrixError(const glm::mat4& a, const glm::mat4& b)
+{
+	float error = 0.0f;
+	for (int j = 0; j < 4; j++)
+		for (int r = 0; r < 4; r++)
+			error = std::max(error, fabsf(a[j][r] - b[j][r]) / std::max(1.0f, fabsf(b[j][r])));
+	return error;
+}
+
+static int benchTransform(int argc, char* argv[])
+{
+	int repeats = argc > 0 ? atoi(argv[0]) : 3;
+	if (repeats < 1)
+		repeats = 1;
+
+	// Wie in Ant.cpp: Szene, Ausrichtung und Groesse des Ameisen-Meshes, Kamera
+	glm::mat4 parent = glm::rotate(glm::mat4(1.0f), 30.0f, glm::vec3(0, 1, 0));
+	glm::mat4 local = glm::rotate(glm::mat4(1.0f), 90.0f, glm::vec3(-1, 0, 0));
+	local = glm::rotate(local, 180.0f, glm::vec3(0, 0, 1));
+	local = glm::scale(local, glm::vec3(0.01f));
+	glm::mat4 viewProjection = glm::perspective(45.0f, 16.0f / 9.0f, 0.1f, 100.0f) *
+		glm::lookAt(glm::vec3(4, 3, -3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+
+	printf("\nTransformationen: Welt- und MVP-Matrix pro Objekt, ein Kern\n");
+	printf("  %9s %10s %10s %10s %10s %12s\n", "Objekte", "ns glm", "ns skalar", "ns SSE2", "ns AVX", "max. Fehler");
+
+	const TransformKernel kernels[] = { TRANSFORM_SCALAR, TRANSFORM_SSE2, TRANSFORM_AVX };
+	const size_t kernelCount = sizeof(kernels) / sizeof(kernels[0]);
+	bool ok = true;
+	const size_t counts[] = { 1000, 100000, 1000000 };
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		size_t count = counts[c];
+		std::vector<float> x(count), y(count), z(count), heading(count), scale(count);
+		unsigned int r = 24;
+		for (size_t i = 0; i < count; i++)
+		{
+			r = r * 1664525u + 1013904223u;
+			x[i] = (float)(r >> 8) / (1 << 24) * 20.0f - 10.0f;
+			r = r * 1664525u + 1013904223u;
+			z[i] = (float)(r >> 8) / (1 << 24) * 20.0f - 10.0f;
+			r = r * 1664525u + 1013904223u;
+			// Auch weit ausserhalb von [-pi, pi], die Kolonie dreht sich beliebig oft
+			heading[i] = (float)(r >> 8) / (1 << 24) * 200.0f - 100.0f;
+			y[i] = 0.1f * (float)(i % 7);
+			scale[i] = 0.5f + 0.1f * (float)(i % 11);
+		}
+		TransformArrays arrays = { &x[0], &y[0], &z[0], &heading[0], &scale[0] };
+
+		std::vector<glm::mat4> refWorld(count), refMvp(count), world(count), mvp(count);
+		double glmTime = 1e30;
+		for (int rep = 0; rep < repeats; rep++)
+		{
+			Clock::time_point start = Clock::now();
+			for (size_t i = 0; i < count; i++)
+			{
+				glm::mat4 model = glm::translate(parent, glm::vec3(x[i], y[i], z[i]));
+				model = glm::rotate(model, heading[i] * 57.2957795f, glm::vec3(0, -1, 0));
+				model = glm::scale(model, glm::vec3(scale[i]));
+				refWorld[i] = model * local;
+				refMvp[i] = viewProjection * refWorld[i];
+			}
+			glmTime = std::min(glmTime, secondsSince(start));
+		}
+
+		double times[kernelCount];
+		float error = 0.0f;
+		for (size_t k = 0; k < kernelCount; k++)
+		{
+			times[k] = -1.0;
+			if (!transformKernelAvailable(kernels[k]))
+				continue;
+			times[k] = 1e30;
+			for (int rep = 0; rep < repeats; rep++)
+			{
+				Clock::time_point start = Clock::now();
+				computeTransforms(parent, local, arrays, count, &world[0], &viewProjection, &mvp[0], kernels[k]);
+				times[k] = std::min(times[k], secondsSince(start));
+			}
+			for (size_t i = 0; i < count; i++)
+				error = std::max(error, std::max(matrixError(world[i], refWorld[i]), matrixError(mvp[i], refMvp[i])));
+		}
+
+		// float-Rundung und das sin/cos-Polynom, mehr darf es nicht sein
+		ok = ok && error < 1e-4f;
+		printf("  %9u %10.1f", (unsigned int)count, glmTime * 1e9 / count);
+		for (size_t k = 0; k < kernelCount; k++)
+		{
+			if (times[k] < 0.0)
+				printf(" %10s", "-");
+			else
+				printf(" %10.1f", times[k] * 1e9 / count);
+		}
+		printf(" %12.2g\n", error);
+	}
+	printf("  Ergebnis %s\n", ok ? "gleich bis auf Rundung" : "FEHLER, Kernel weichen ab");
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+struct Benchmark
+{
+	const char* name;
+	const char* arguments;
+	int (*run)(int argc, char* argv[]); // -1: falsche Parameter
+};
+
+static const Benchmark benchmarks[] = {
+	{ "objloader", "<datei.obj> [wiederholungen]", benchObjLoader },
+	{ "texcook", "<datei.bmp> [bc1|bc3] [wiederholungen]", benchTextureCooker },
+	{ "colony", "[wiederholungen]", benchColony },
+	{ "pheromone", "[wiederholungen]", benchPheromone },
+	{ "grid", "[wiederholungen]", benchSpatialGrid },
+	{ "pool", "[wiederholungen]", benchEntityPool },
+	{ "transform", "[wiederholungen]", benchTransform },
+};
+
+static void printUsage(const char* program)
+{
+	printf("Benchmarks:\n");
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+		printf("  %s --bench %s %s\n", program, benchmarks[i].name, benchmarks[i].arguments);
+}
+
+int runBenchmark(int argc, char* argv[])
+{
+	// argv[0] = Programm, argv[1] = "--bench", argv[2] = Name, danach die Parameter
+	if (argc < 3)
+	{
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+	{
+		if (strcmp(argv[2], benchmarks[i].name) == 0)
+		{
+			int result = benchmarks[i].run(argc - 3, argv + 3);
+			if (result == -1)
+			{
+				printUsage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			return result;
+		}
+	}
+
+	printf("Unknown benchmark %s\n", argv[2]);
+	printUsage(argv[0]);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,8 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+// Benchmarks, die ohne Fenster laufen. Aufruf: "Ant --bench <name> [parameter...]"
+// Ohne Namen werden die vorhandenen Benchmarks aufgelistet. Rueckgabe ist der Exit-Code.
+int runBenchmark(int argc, char* argv[]);
+
+#endif
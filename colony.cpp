@@ -0,0 +1,282 @@
+#include <math.h>
+#include <string.h>
+
+#include "colony.hpp"
+
+// AVX2 wird zur Laufzeit gewaehlt. MSVC uebersetzt die Intrinsics auch ohne /arch:AVX2,
+// GCC und Clang brauchen das target-Attribut an der Funktion.
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define COLONY_AVX2
+#define COLONY_AVX2_TARGET
+#include <intrin.h>
+#include <immintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#define COLONY_AVX2
+#define COLONY_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+static const float PI_F = 3.14159265f;
+static const float HALF_PI_F = 1.57079633f;
+static const float TWO_PI_F = 6.28318531f;
+static const float INV_TWO_PI_F = 0.159154943f;
+
+// Taylor bis h^11 auf [-pi/2, pi/2], Fehler unter 1e-7
+static const float SIN_C3 = -1.0f / 6.0f;
+static const float SIN_C5 = 1.0f / 120.0f;
+static const float SIN_C7 = -1.0f / 5040.0f;
+static const float SIN_C9 = 1.0f / 362880.0f;
+static const float SIN_C11 = -1.0f / 39916800.0f;
+
+Colony::Colony(float halfSize, float wander)
+	: halfSize(halfSize), wander(wander), allocationCount(0)
+{
+}
+
+void Colony::reserve(size_t capacity)
+{
+	handles.reserve(capacity);
+	if (capacity <= x.capacity())
+		return;
+	x.reserve(capacity);
+	y.reserve(capacity);
+	heading.reserve(capacity);
+	speed.reserve(capacity);
+	state.reserve(capacity);
+	carried.reserve(capacity);
+	random.reserve(capacity);
+	allocationCount++;
+}
+
+void Colony::clear()
+{
+	handles.clear();
+	x.clear();
+	y.clear();
+	heading.clear();
+	speed.clear();
+	state.clear();
+	carried.clear();
+	random.clear();
+}
+
+static unsigned int xorshift(unsigned int& r)
+{
+	r ^= r << 13;
+	r ^= r >> 17;
+	r ^= r << 5;
+	return r;
+}
+
+// [1, 2) aus den oberen 23 Bits
+static float unitFloat(unsigned int r)
+{
+	unsigned int bits = (r >> 9) | 0x3f800000u;
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+void Colony::spawn(size_t count, float nestX, float nestY, float baseSpeed, unsigned int seed)
+{
+	unsigned int r = seed ? seed : 1;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (handles.create() == NO_ENTITY)
+			break;
+		if (x.size() == x.capacity())
+			allocationCount++;
+		x.push_back(nestX);
+		y.push_back(nestY);
+		heading.push_back((unitFloat(xorshift(r)) - 1.5f) * TWO_PI_F);
+		speed.push_back(baseSpeed * (unitFloat(xorshift(r)) * 0.5f + 0.25f)); // 0.75 bis 1.25 mal
+		state.push_back(ANT_SEARCHING);
+		carried.push_back(0.0f);
+		unsigned int own = xorshift(r);
+		random.push_back(own ? own : 1);
+	}
+}
+
+template <typename T>
+static void swapRemove(std::vector<T>& values, size_t index)
+{
+	values[index] = values.back();
+	values.pop_back();
+}
+
+bool Colony::despawn(EntityHandle ant)
+{
+	size_t removed;
+	if (!handles.destroy(ant, removed))
+		return false;
+	swapRemove(x, removed);
+	swapRemove(y, removed);
+	swapRemove(heading, removed);
+	swapRemove(speed, removed);
+	swapRemove(state, removed);
+	swapRemove(carried, removed);
+	swapRemove(random, removed);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Skalarer Kernel
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// sin fuer a in [-pi, pi]: erst nach [-pi/2, pi/2] spiegeln, dann das Polynom
+static float sinReduced(float a)
+{
+	if (a > HALF_PI_F)
+		a = PI_F - a;
+	if (a < -HALF_PI_F)
+		a = -PI_F - a;
+	float a2 = a * a;
+	return a * (1.0f + a2 * (SIN_C3 + a2 * (SIN_C5 + a2 * (SIN_C7 + a2 * (SIN_C9 + a2 * SIN_C11)))));
+}
+
+static void updateScalar(Colony& colony, size_t first, size_t last, float dt, float wanderDt)
+{
+	float size = colony.worldHalfSize() * 2.0f;
+	float invSize = 1.0f / size;
+	float half = colony.worldHalfSize();
+
+	for (size_t i = first; i < last; i++)
+	{
+		// Richtung: zufaellig in [-wander, wander) * dt drehen, zurueck nach [-pi, pi)
+		float turn = (unitFloat(xorshift(colony.random[i])) * 2.0f - 3.0f) * wanderDt;
+		float h = colony.heading[i] + turn;
+		h = h - TWO_PI_F * floorf((h + PI_F) * INV_TWO_PI_F);
+		colony.heading[i] = h;
+
+		// Bewegung: cos(h) = sin(h + pi/2)
+		float c = h + HALF_PI_F;
+		if (c > PI_F)
+			c = c - TWO_PI_F;
+		float step = colony.speed[i] * dt;
+		float px = colony.x[i] + sinReduced(c) * step;
+		float py = colony.y[i] + sinReduced(h) * step;
+
+		// Rand: auf der anderen Seite wieder herein
+		colony.x[i] = px - size * floorf((px + half) * invSize);
+		colony.y[i] = py - size * floorf((py + half) * invSize);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////    AVX2-Kernel, 8 Ameisen pro Durchlauf
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef COLONY_AVX2
+
+COLONY_AVX2_TARGET static inline __m256 sinReduced8(__m256 a)
+{
+	const __m256 halfPi = _mm256_set1_ps(HALF_PI_F);
+	const __m256 pi = _mm256_set1_ps(PI_F);
+	a = _mm256_blendv_ps(a, _mm256_sub_ps(pi, a), _mm256_cmp_ps(a, halfPi, _CMP_GT_OQ));
+	a = _mm256_blendv_ps(a, _mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), pi), a),
+		_mm256_cmp_ps(a, _mm256_sub_ps(_mm256_setzero_ps(), halfPi), _CMP_LT_OQ));
+
+	__m256 a2 = _mm256_mul_ps(a, a);
+	__m256 p = _mm256_add_ps(_mm256_set1_ps(SIN_C9), _mm256_mul_ps(a2, _mm256_set1_ps(SIN_C11)));
+	p = _mm256_add_ps(_mm256_set1_ps(SIN_C7), _mm256_mul_ps(a2, p));
+	p = _mm256_add_ps(_mm256_set1_ps(SIN_C5), _mm256_mul_ps(a2, p));
+	p = _mm256_add_ps(_mm256_set1_ps(SIN_C3), _mm256_mul_ps(a2, p));
+	p = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(a2, p));
+	return _mm256_mul_ps(a, p);
+}
+
+// Verarbeitet [first, first + 8 * n) und gibt das Ende zurueck, den Rest macht der skalare Kernel
+COLONY_AVX2_TARGET static size_t updateAVX2(Colony& colony, size_t first, size_t last, float dt, float wanderDt)
+{
+	const __m256 pi = _mm256_set1_ps(PI_F);
+	const __m256 halfPi = _mm256_set1_ps(HALF_PI_F);
+	const __m256 twoPi = _mm256_set1_ps(TWO_PI_F);
+	const __m256 invTwoPi = _mm256_set1_ps(INV_TWO_PI_F);
+	const __m256 two = _mm256_set1_ps(2.0f);
+	const __m256 three = _mm256_set1_ps(3.0f);
+	const __m256 vWanderDt = _mm256_set1_ps(wanderDt);
+	const __m256 vDt = _mm256_set1_ps(dt);
+	const __m256 size = _mm256_set1_ps(colony.worldHalfSize() * 2.0f);
+	const __m256 invSize = _mm256_set1_ps(1.0f / (colony.worldHalfSize() * 2.0f));
+	const __m256 half = _mm256_set1_ps(colony.worldHalfSize());
+	const __m256i exponent = _mm256_set1_epi32(0x3f800000);
+
+	size_t i = first;
+	for (; i + 8 <= last; i += 8)
+	{
+		// xorshift32 in allen 8 Spuren
+		__m256i r = _mm256_loadu_si256((const __m256i*)&colony.random[i]);
+		r = _mm256_xor_si256(r, _mm256_slli_epi32(r, 13));
+		r = _mm256_xor_si256(r, _mm256_srli_epi32(r, 17));
+		r = _mm256_xor_si256(r, _mm256_slli_epi32(r, 5));
+		_mm256_storeu_si256((__m256i*)&colony.random[i], r);
+		__m256 u = _mm256_castsi256_ps(_mm256_or_si256(_mm256_srli_epi32(r, 9), exponent));
+
+		__m256 turn = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(u, two), three), vWanderDt);
+		__m256 h = _mm256_add_ps(_mm256_loadu_ps(&colony.heading[i]), turn);
+		h = _mm256_sub_ps(h, _mm256_mul_ps(twoPi, _mm256_floor_ps(_mm256_mul_ps(_mm256_add_ps(h, pi), invTwoPi))));
+		_mm256_storeu_ps(&colony.heading[i], h);
+
+		__m256 c = _mm256_add_ps(h, halfPi);
+		c = _mm256_blendv_ps(c, _mm256_sub_ps(c, twoPi), _mm256_cmp_ps(c, pi, _CMP_GT_OQ));
+		__m256 step = _mm256_mul_ps(_mm256_loadu_ps(&colony.speed[i]), vDt);
+		__m256 px = _mm256_add_ps(_mm256_loadu_ps(&colony.x[i]), _mm256_mul_ps(sinReduced8(c), step));
+		__m256 py = _mm256_add_ps(_mm256_loadu_ps(&colony.y[i]), _mm256_mul_ps(sinReduced8(h), step));
+
+		px = _mm256_sub_ps(px, _mm256_mul_ps(size, _mm256_floor_ps(_mm256_mul_ps(_mm256_add_ps(px, half), invSize))));
+		py = _mm256_sub_ps(py, _mm256_mul_ps(size, _mm256_floor_ps(_mm256_mul_ps(_mm256_add_ps(py, half), invSize))));
+		_mm256_storeu_ps(&colony.x[i], px);
+		_mm256_storeu_ps(&colony.y[i], py);
+	}
+	return i;
+}
+
+#endif
+
+bool Colony::hasAVX2()
+{
+#if defined(COLONY_AVX2) && defined(_MSC_VER)
+	static int cached = -1;
+	if (cached < 0)
+	{
+		int info[4];
+		__cpuid(info, 0);
+		bool avx2 = false;
+		if (info[0] >= 7)
+		{
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			// Das Betriebssystem muss die YMM-Register beim Threadwechsel sichern
+			if (osxsave && avx && (_xgetbv(0) & 6) == 6)
+			{
+				__cpuidex(info, 7, 0);
+				avx2 = (info[1] & (1 << 5)) != 0;
+			}
+		}
+		cached = avx2 ? 1 : 0;
+	}
+	return cached == 1;
+#elif defined(COLONY_AVX2)
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	return false;
+#endif
+}
+
+void Colony::update(float dt, bool simd)
+{
+	update(0, size(), dt, simd);
+}
+
+void Colony::update(size_t first, size_t last, float dt, bool simd)
+{
+	float wanderDt = wander * dt;
+#ifdef COLONY_AVX2
+	if (simd && hasAVX2())
+		first = updateAVX2(*this, first, last, dt, wanderDt);
+#else
+	(void)simd;
+#endif
+	updateScalar(*this, first, last, dt, wanderDt);
+}
@@ -0,0 +1,62 @@
+#ifndef COLONY_HPP
+#define COLONY_HPP
+
+#include <vector>
+
+#include "entitypool.hpp"
+
+enum AntState
+{
+	ANT_SEARCHING = 0,
+	ANT_RETURNING = 1 // traegt Futter zum Nest
+};
+
+// Alle Ameisen einer Kolonie, jede Eigenschaft in einem eigenen Feld (struct of arrays),
+// damit die Kernels 8 Ameisen auf einmal laden und rechnen koennen.
+// Ein Schritt (update) dreht jede Ameise ein Stueck zufaellig, bewegt sie entlang ihrer
+// Richtung und laesst sie am Rand der Welt auf der anderen Seite wieder herauskommen.
+// Der AVX2-Kernel wird zur Laufzeit gewaehlt und rechnet bitgenau wie der skalare
+// (gleiche Reihenfolge der Operationen, eigenes sin/cos-Polynom, kein FMA).
+// Jede Ameise hat einen Handle (siehe entitypool.hpp). despawn verschiebt die letzte Ameise
+// in die Luecke, die Felder bleiben also dicht, aber die Stellen aendern sich.
+class Colony
+{
+	float halfSize; // die Welt ist [-halfSize, halfSize]^2
+	float wander;   // maximale zufaellige Drehung, Bogenmass pro Sekunde
+	HandleTable handles;
+	unsigned int allocationCount;
+
+public:
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> heading; // Bogenmass in [-pi, pi)
+	std::vector<float> speed;   // Einheiten pro Sekunde
+	std::vector<unsigned char> state; // AntState
+	std::vector<float> carried; // getragenes Futter
+	std::vector<unsigned int> random; // xorshift32 pro Ameise, nie 0
+
+	Colony(float halfSize, float wander);
+
+	// Platz fuer capacity Ameisen, danach legen spawn und despawn nichts mehr an
+	void reserve(size_t capacity);
+	// count Ameisen am Nest mit zufaelliger Richtung und Geschwindigkeit um baseSpeed
+	void spawn(size_t count, float nestX, float nestY, float baseSpeed, unsigned int seed);
+	bool despawn(EntityHandle ant);
+	void clear();
+
+	size_t size() const { return x.size(); }
+	EntityHandle handle(size_t index) const { return handles.handleAt(index); }
+	int indexOf(EntityHandle ant) const { return handles.indexOf(ant); }
+	unsigned int allocations() const { return allocationCount + handles.allocations(); }
+	float worldHalfSize() const { return halfSize; }
+
+	// Ein Schritt fuer alle Ameisen. simd = false erzwingt den skalaren Kernel (Vergleich).
+	void update(float dt, bool simd = true);
+	// Nur die Ameisen [first, last), z. B. fuer parallelFor
+	void update(size_t first, size_t last, float dt, bool simd = true);
+
+	// CPU und Betriebssystem koennen AVX2
+	static bool hasAVX2();
+};
+
+#endif
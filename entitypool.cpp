@@ -0,0 +1,88 @@
+#include "entitypool.hpp"
+
+static const unsigned int INDEX_MASK = (1u << HandleTable::INDEX_BITS) - 1;
+static const unsigned int GENERATION_MASK = (1u << HandleTable::GENERATION_BITS) - 1;
+
+HandleTable::HandleTable()
+	: freeSlot(NO_SLOT), allocationCount(0)
+{
+}
+
+void HandleTable::reserve(size_t capacity)
+{
+	if (capacity > MAX_ENTITIES)
+		capacity = MAX_ENTITIES;
+	if (capacity > denseHandle.capacity())
+	{
+		slotGeneration.reserve(capacity);
+		slotDense.reserve(capacity);
+		denseHandle.reserve(capacity);
+		allocationCount++;
+	}
+}
+
+EntityHandle HandleTable::create()
+{
+	unsigned int slot;
+	if (freeSlot != NO_SLOT)
+	{
+		slot = freeSlot;
+		freeSlot = slotDense[slot];
+	}
+	else
+	{
+		if (slotGeneration.size() >= MAX_ENTITIES)
+			return NO_ENTITY;
+		slot = (unsigned int)slotGeneration.size();
+		append(slotGeneration, 1u); // Generation 0 gibt es nicht, damit kein Handle 0 ist
+		append(slotDense, 0u);
+	}
+
+	EntityHandle handle = (slotGeneration[slot] << INDEX_BITS) | slot;
+	slotDense[slot] = (unsigned int)denseHandle.size();
+	append(denseHandle, handle);
+	return handle;
+}
+
+bool HandleTable::destroy(EntityHandle handle, size_t& removed)
+{
+	int index = indexOf(handle);
+	if (index < 0)
+		return false;
+	unsigned int slot = handle & INDEX_MASK;
+
+	// Der letzte Eintrag zieht in die Luecke
+	EntityHandle last = denseHandle.back();
+	denseHandle[index] = last;
+	slotDense[last & INDEX_MASK] = (unsigned int)index;
+	denseHandle.pop_back();
+
+	// Neue Generation, nach der hoechsten wieder bei 1
+	unsigned int generation = (slotGeneration[slot] + 1) & GENERATION_MASK;
+	slotGeneration[slot] = generation ? generation : 1;
+	slotDense[slot] = freeSlot;
+	freeSlot = slot;
+
+	removed = (size_t)index;
+	return true;
+}
+
+void HandleTable::clear()
+{
+	size_t removed;
+	while (!denseHandle.empty())
+		destroy(denseHandle.back(), removed);
+}
+
+int HandleTable::indexOf(EntityHandle handle) const
+{
+	unsigned int slot = handle & INDEX_MASK;
+	if (slot >= slotGeneration.size() || slotGeneration[slot] != handle >> INDEX_BITS)
+		return -1;
+	return (int)slotDense[slot];
+}
+
+bool HandleTable::alive(EntityHandle handle) const
+{
+	return indexOf(handle) >= 0;
+}
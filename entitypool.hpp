@@ -0,0 +1,136 @@
+#ifndef ENTITYPOOL_HPP
+#define ENTITYPOOL_HPP
+
+#include <stddef.h>
+#include <vector>
+
+// 32 Bit: oben die Generation, unten der Platz. 0 ist nie ein gueltiger Handle.
+typedef unsigned int EntityHandle;
+static const EntityHandle NO_ENTITY = 0;
+
+// Vergibt Handles fuer dicht gepackte Felder. Jeder Platz merkt sich seine Generation und wo
+// sein Eintrag im dichten Feld steht; geloeschte Plaetze kommen in eine Freiliste. Wird ein
+// Eintrag geloescht, ruecken nicht alle nach, sondern der letzte zieht in die Luecke
+// (swap-remove), der Besitzer der Felder muss das genauso machen (siehe EntityPool, Colony).
+// Ein alter Handle passt danach nicht mehr, weil die Generation weitergezaehlt wurde.
+// Nach reserve() legen create und destroy nichts mehr an, beides ist O(1).
+class HandleTable
+{
+public:
+	enum
+	{
+		INDEX_BITS = 20,
+		GENERATION_BITS = 32 - INDEX_BITS,
+		MAX_ENTITIES = 1 << INDEX_BITS
+	};
+
+private:
+	enum { NO_SLOT = 0xffffffffu };
+
+	std::vector<unsigned int> slotGeneration;
+	std::vector<unsigned int> slotDense;   // Stelle im dichten Feld, bei freien Plaetzen der naechste freie
+	std::vector<EntityHandle> denseHandle; // zu jedem Eintrag sein Handle
+	unsigned int freeSlot;
+
+	unsigned int allocationCount; // wie oft eines der Felder wachsen musste
+
+	template <typename T>
+	void append(std::vector<T>& values, const T& value)
+	{
+		if (values.size() == values.capacity())
+			allocationCount++;
+		values.push_back(value);
+	}
+
+public:
+	HandleTable();
+
+	void reserve(size_t capacity);
+
+	// Neuer Eintrag am Ende des dichten Felds (Stelle size() - 1). NO_ENTITY, wenn alle Plaetze belegt sind.
+	EntityHandle create();
+	// Gibt in removed die frei gewordene Stelle zurueck. Der Besitzer verschiebt seinen letzten
+	// Eintrag dorthin und kuerzt um eins (ausser removed war schon der letzte).
+	bool destroy(EntityHandle handle, size_t& removed);
+	void clear();
+
+	bool alive(EntityHandle handle) const;
+	// Stelle im dichten Feld oder -1
+	int indexOf(EntityHandle handle) const;
+
+	size_t size() const { return denseHandle.size(); }
+	EntityHandle handleAt(size_t index) const { return denseHandle[index]; }
+
+	unsigned int allocations() const { return allocationCount; }
+};
+
+// Objekte vom Typ T, dicht gepackt fuer schnelles Durchlaufen, ueber Handles ansprechbar
+template <typename T>
+class EntityPool
+{
+	HandleTable handles;
+	std::vector<T> items;
+	unsigned int allocationCount;
+
+public:
+	explicit EntityPool(size_t capacity = 0) : allocationCount(0) { reserve(capacity); }
+
+	void reserve(size_t capacity)
+	{
+		handles.reserve(capacity);
+		if (capacity > items.capacity())
+		{
+			items.reserve(capacity);
+			allocationCount++;
+		}
+	}
+
+	EntityHandle spawn(const T& item)
+	{
+		EntityHandle handle = handles.create();
+		if (handle == NO_ENTITY)
+			return NO_ENTITY;
+		if (items.size() == items.capacity())
+			allocationCount++;
+		items.push_back(item);
+		return handle;
+	}
+
+	bool despawn(EntityHandle handle)
+	{
+		size_t removed;
+		if (!handles.destroy(handle, removed))
+			return false;
+		if (removed != items.size() - 1)
+			items[removed] = items.back();
+		items.pop_back();
+		return true;
+	}
+
+	void clear()
+	{
+		handles.clear();
+		items.clear();
+	}
+
+	T* get(EntityHandle handle)
+	{
+		int index = handles.indexOf(handle);
+		return index < 0 ? NULL : &items[index];
+	}
+	const T* get(EntityHandle handle) const
+	{
+		int index = handles.indexOf(handle);
+		return index < 0 ? NULL : &items[index];
+	}
+
+	// Dicht durchlaufen: [0, size()), die Reihenfolge aendert sich bei despawn
+	size_t size() const { return items.size(); }
+	T& operator[](size_t index) { return items[index]; }
+	const T& operator[](size_t index) const { return items[index]; }
+	EntityHandle handleAt(size_t index) const { return handles.handleAt(index); }
+
+	unsigned int allocations() const { return allocationCount + handles.allocations(); }
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include <math.h>
+
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+
+// SSE2 gibt es auf jedem x86-Prozessor, den OpenGL 3.3 voraussetzt; MSVC setzt _M_IX86_FP bei /arch:SSE2 (Standard)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SSE2
+#include <emmintrin.h>
+#endif
+
+BoundingSphere transformSphere(const BoundingSphere& sphere, const glm::mat4& model)
+{
+	float scaleX = glm::dot(glm::vec3(model[0]), glm::vec3(model[0]));
+	float scaleY = glm::dot(glm::vec3(model[1]), glm::vec3(model[1]));
+	float scaleZ = glm::dot(glm::vec3(model[2]), glm::vec3(model[2]));
+
+	BoundingSphere world;
+	world.center = glm::vec3(model * glm::vec4(sphere.center, 1.0f));
+	world.radius = sphere.radius * sqrtf(glm::max(scaleX, glm::max(scaleY, scaleZ)));
+	return world;
+}
+
+Frustum extractFrustum(const glm::mat4& viewProjection)
+{
+	// glm speichert spaltenweise, Zeile i ist (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++)
+		row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+	Frustum frustum;
+	frustum.planes[0] = row[3] + row[0];
+	frustum.planes[1] = row[3] - row[0];
+	frustum.planes[2] = row[3] + row[1];
+	frustum.planes[3] = row[3] - row[1];
+	frustum.planes[4] = row[3] + row[2];
+	frustum.planes[5] = row[3] - row[2];
+
+	// Normieren, damit der Abstand zur Ebene direkt mit dem Radius verglichen werden kann
+	for (int i = 0; i < 6; i++)
+		frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+	return frustum;
+}
+
+static bool sphereVisible(const Frustum& frustum, float x, float y, float z, float radius)
+{
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4& plane = frustum.planes[p];
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+size_t cullSpheres(const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+	const float* radius, size_t count, unsigned char* visible)
+{
+	size_t visibleCount = 0;
+	size_t i = 0;
+
+#ifdef FRUSTUM_SSE2
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(centerX + i);
+		__m128 y = _mm_loadu_ps(centerY + i);
+		__m128 z = _mm_loadu_ps(centerZ + i);
+		__m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(radius + i), signBit);
+
+		// Sichtbar, solange keine Ebene die Kugel ganz auf ihrer Aussenseite hat
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int k = 0; k < 4; k++)
+		{
+			visible[i + k] = (unsigned char)((mask >> k) & 1);
+			visibleCount += visible[i + k];
+		}
+	}
+#endif
+
+	// Rest (oder alles ohne SSE)
+	for (; i < count; i++)
+	{
+		visible[i] = sphereVisible(frustum, centerX[i], centerY[i], centerZ[i], radius[i]) ? 1 : 0;
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
+
+bool boxVisible(const Frustum& frustum, const BoundingBox& box, const glm::mat4& model)
+{
+	for (int p = 0; p < 6; p++)
+	{
+		// plane * (model * v) = (plane * model) * v, die Ebene also einmal in den Modellraum
+		const glm::vec4& world = frustum.planes[p];
+		glm::vec4 plane(glm::dot(world, model[0]), glm::dot(world, model[1]), glm::dot(world, model[2]),
+			glm::dot(world, model[3]));
+
+		// Die Ecke, die am weitesten auf der Innenseite liegt
+		glm::vec3 corner(plane.x >= 0.0f ? box.max.x : box.min.x, plane.y >= 0.0f ? box.max.y : box.min.y,
+			plane.z >= 0.0f ? box.max.z : box.min.z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+			return false;
+	}
+	return true;
+}
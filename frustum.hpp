@@ -0,0 +1,45 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// Achsenparallele Box in Modellkoordinaten
+struct BoundingBox
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// Umschliessende Kugel in Modellkoordinaten
+struct BoundingSphere
+{
+	glm::vec3 center;
+	float radius;
+};
+
+// Kugel in Weltkoordinaten: Mittelpunkt transformiert, Radius mit der groessten Skalierung der Matrix
+BoundingSphere transformSphere(const BoundingSphere& sphere, const glm::mat4& model);
+
+// Die sechs Ebenen des Sichtvolumens, Normalen zeigen nach innen und sind normiert
+struct Frustum
+{
+	glm::vec4 planes[6]; // links, rechts, unten, oben, nah, fern
+};
+
+// Ebenen aus Projection * View (Gribb/Hartmann)
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+// Testet count Kugeln (Mittelpunkte und Radien als getrennte Felder) gegen das Frustum,
+// mit SSE vier Kugeln auf einmal. visible[i] wird 1, wenn Kugel i ganz oder teilweise
+// sichtbar ist, sonst 0. Rueckgabe ist die Anzahl der sichtbaren Kugeln.
+size_t cullSpheres(const Frustum& frustum, const float* centerX, const float* centerY, const float* centerZ,
+	const float* radius, size_t count, unsigned char* visible);
+
+// Genauer als die Kugel fuer lange oder flache Objekte: die Box in Modellkoordinaten gegen die
+// Ebenen, die dafuer mit model in den Modellraum gebracht werden. false, wenn eine Ebene die
+// ganze Box auf ihrer Aussenseite hat.
+bool boxVisible(const Frustum& frustum, const BoundingBox& box, const glm::mat4& model);
+
+#endif
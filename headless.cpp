@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#ifdef _WIN32
+#include <GLFW/glfw3.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+#include "headless.hpp"
+#include "mappedfile.hpp"
+
+bool parseHeadlessOptions(int argc, char* argv[], HeadlessOptions& options)
+{
+	options.enabled = false;
+	options.width = 1280;
+	options.height = 720;
+	options.frames = 600;
+	options.foodDrops = 10;
+	options.ants = 1;
+	options.timeStep = 1.0 / 60.0;
+	options.checksum = false;
+	options.tracePath = NULL;
+	options.levelOfDetail = true;
+	options.multiDrawIndirect = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--headless") == 0)
+			options.enabled = true;
+	}
+	if (!options.enabled)
+		return true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--checksum") == 0)
+		{
+			options.checksum = true;
+			continue;
+		}
+		if (strcmp(argv[i], "--no-lod") == 0)
+		{
+			options.levelOfDetail = false;
+			continue;
+		}
+		if (strcmp(argv[i], "--no-mdi") == 0)
+		{
+			options.multiDrawIndirect = false;
+			continue;
+		}
+
+		// Alle anderen Optionen haben einen Wert
+		const char* value = i + 1 < argc ? argv[i + 1] : "";
+		bool ok;
+		if (strcmp(argv[i], "--frames") == 0)
+			ok = (options.frames = atoi(value)) > 0;
+		else if (strcmp(argv[i], "--food") == 0)
+			ok = (options.foodDrops = atoi(value)) >= 0;
+		else if (strcmp(argv[i], "--ants") == 0)
+			ok = (options.ants = atoi(value)) >= 1;
+		else if (strcmp(argv[i], "--step") == 0)
+			ok = (options.timeStep = atof(value)) > 0.0;
+		else if (strcmp(argv[i], "--trace") == 0)
+			ok = (options.tracePath = value)[0] != 0;
+		else if (strcmp(argv[i], "--size") == 0)
+			ok = sscanf(value, "%dx%d", &options.width, &options.height) == 2 && options.width > 0 && options.height > 0;
+		else
+			continue; // z. B. "--headless" selbst
+
+		if (!ok)
+		{
+			printf("Invalid value for %s: %s\n", argv[i], value);
+			printf("Usage: %s --headless [--frames K] [--food N] [--ants M] [--size WxH] [--step seconds] [--checksum] [--trace file.json] [--no-lod] [--no-mdi]\n", argv[0]);
+			return false;
+		}
+		i++;
+	}
+	return true;
+}
+
+HeadlessContext::HeadlessContext()
+	: width(0), height(0), framebuffer(0), colorBuffer(0), depthBuffer(0), display(NULL), context(NULL)
+{
+}
+
+#ifdef _WIN32
+
+bool HeadlessContext::create(int w, int h)
+{
+	width = w;
+	height = h;
+	if (!glfwInit())
+	{
+		fprintf(stderr, "Failed to initialize GLFW\n");
+		return false;
+	}
+
+	// Das Fenster wird nie gezeigt, es liefert nur den Kontext
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	GLFWwindow* window = glfwCreateWindow(w, h, "Ant Game (headless)", NULL, NULL);
+	if (!window)
+	{
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(window);
+	display = window;
+	return true;
+}
+
+#else
+
+bool HeadlessContext::create(int w, int h)
+{
+	width = w;
+	height = h;
+
+	// Surfaceless braucht weder X-Server noch GPU; alte EGL-Versionen kennen nur das Standard-Display
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (eglDisplay == EGL_NO_DISPLAY)
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+	{
+		fprintf(stderr, "Failed to initialize EGL\n");
+		return false;
+	}
+
+	// Ohne Surface ist die Config egal, EGL_KHR_no_config_context erlaubt auch gar keine
+	const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config = NULL;
+	EGLint configCount = 0;
+	eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount);
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext eglContext = eglCreateContext(eglDisplay, configCount ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+	if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+	{
+		fprintf(stderr, "Failed to create a surfaceless EGL context (0x%x)\n", eglGetError());
+		if (eglContext != EGL_NO_CONTEXT)
+			eglDestroyContext(eglDisplay, eglContext);
+		eglTerminate(eglDisplay);
+		return false;
+	}
+
+	display = eglDisplay;
+	context = eglContext;
+	return true;
+}
+
+#endif
+
+bool HeadlessContext::createFramebuffer()
+{
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	// Ohne Fenster gibt es keinen Backbuffer, also auch in das Framebuffer-Objekt lesen und schreiben
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		fprintf(stderr, "Offscreen framebuffer is incomplete (0x%x)\n", status);
+		return false;
+	}
+	return true;
+}
+
+void HeadlessContext::destroy()
+{
+	if (framebuffer)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+	}
+	framebuffer = colorBuffer = depthBuffer = 0;
+
+	if (display)
+	{
+#ifdef _WIN32
+		glfwDestroyWindow((GLFWwindow*)display);
+		glfwTerminate();
+#else
+		eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+		eglTerminate((EGLDisplay)display);
+#endif
+	}
+	display = NULL;
+	context = NULL;
+}
+
+unsigned long long HeadlessContext::checksum() const
+{
+	std::vector<unsigned char> pixels((size_t)width * height * 4);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+	return hashBytes(&pixels[0], pixels.size());
+}
+
+void printFrameTimes(const std::vector<double>& seconds)
+{
+	if (seconds.empty())
+		return;
+
+	std::vector<double> sorted(seconds);
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++)
+		sum += sorted[i];
+	size_t p99 = (sorted.size() * 99 + 99) / 100 - 1; // kleinster Wert, unter dem 99 % liegen
+
+	printf("%u frames: min %.3f ms, avg %.3f ms, p99 %.3f ms, max %.3f ms\n", (unsigned int)sorted.size(),
+		sorted.front() * 1000.0, sum / sorted.size() * 1000.0, sorted[p99] * 1000.0, sorted.back() * 1000.0);
+}
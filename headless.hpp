@@ -0,0 +1,60 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include <vector>
+
+// "--headless": ohne Fenster in ein Framebuffer-Objekt zeichnen, mit fester Spielzeit pro Frame.
+// Damit laesst sich der Renderer auf Rechnern ohne GPU und Bildschirm messen (Mesa llvmpipe).
+// Die Szene ist festgelegt: N Food Drops liegen von Anfang an, die eigene Ameise laeuft im Kreis, M - 1 weitere als Kolonie,
+// nach K Frames werden die Frame-Zeiten und auf Wunsch eine Pruefsumme des letzten Bildes ausgegeben.
+//   Ant --headless [--frames K] [--food N] [--ants M] [--size BxH] [--step Sekunden] [--checksum]
+//                [--trace datei.json] [--no-lod] [--no-mdi]
+struct HeadlessOptions
+{
+	bool enabled;
+	int width;
+	int height;
+	int frames;
+	int foodDrops;
+	int ants;
+	double timeStep; // Spielzeit pro Frame
+	bool checksum;
+	const char* tracePath; // "--trace datei.json", sonst NULL
+	bool levelOfDetail;    // "--no-lod" schaltet die Detailstufen der Kugeln ab
+	bool multiDrawIndirect; // "--no-mdi" zeichnet jedes Mesh wie bisher selbst (ohne IndirectRenderer)
+};
+
+// Ohne "--headless" ist enabled false. false bei falschen Werten (Meldung wurde schon ausgegeben).
+bool parseHeadlessOptions(int argc, char* argv[], HeadlessOptions& options);
+
+// OpenGL-Kontext ohne Fenster. Unter Linux EGL ohne Surface (EGL_MESA_platform_surfaceless,
+// laeuft auch ohne X-Server), unter Windows ein unsichtbares GLFW-Fenster.
+// Gezeichnet wird in jedem Fall in ein eigenes Framebuffer-Objekt mit Tiefenpuffer.
+class HeadlessContext
+{
+	int width;
+	int height;
+	GLuint framebuffer;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+	void* display; // EGLDisplay bzw. GLFWwindow*
+	void* context; // EGLContext
+
+	HeadlessContext(const HeadlessContext&);            // nicht kopierbar
+	HeadlessContext& operator=(const HeadlessContext&);
+
+public:
+	HeadlessContext();
+
+	bool create(int width, int height); // vor glewInit, macht den Kontext aktuell
+	bool createFramebuffer();           // nach glewInit, bindet das Framebuffer-Objekt
+	void destroy();
+
+	// FNV-1a ueber die RGBA-Pixel des Framebuffers, zum Vergleich zweier Laeufe
+	unsigned long long checksum() const;
+};
+
+// min/avg/p99 in Millisekunden
+void printFrameTimes(const std::vector<double>& seconds);
+
+#endif
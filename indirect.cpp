@@ -0,0 +1,352 @@
+#include <stdio.h>
+
+#include <GL/glew.h>
+
+#include "indirect.hpp"
+#include "streamring.hpp"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    MeshArena
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MeshArena::MeshArena()
+	: vertexArrayID(0), vertexBuffer(0), indexBuffer(0), maxVertices(0), maxIndices(0), usedVertices(0), usedIndices(0)
+{
+}
+
+MeshArena& meshArena()
+{
+	static MeshArena arena;
+	return arena;
+}
+
+void MeshArena::create(GLuint vertices, GLuint indices)
+{
+	destroy();
+	maxVertices = vertices;
+	maxIndices = indices;
+
+	glGenVertexArrays(1, &vertexArrayID);
+	glBindVertexArray(vertexArrayID);
+
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)maxVertices * sizeof(ArenaVertex), NULL, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ArenaVertex), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ArenaVertex), (void*)sizeof(glm::vec3));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ArenaVertex), (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
+
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)maxIndices * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+}
+
+void MeshArena::destroy()
+{
+	if (vertexArrayID)
+	{
+		glDeleteVertexArrays(1, &vertexArrayID);
+		glDeleteBuffers(1, &vertexBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+	}
+	vertexArrayID = vertexBuffer = indexBuffer = 0;
+	usedVertices = usedIndices = 0;
+	meshes.clear();
+}
+
+int MeshArena::add(const glm::vec3* positions, const glm::vec2* uvs, const glm::vec3* normals, GLuint vertexCount,
+	const void* indices, GLuint indexSize, GLuint indexCount, const BoundingSphere& sphere)
+{
+	if (!vertexArrayID || vertexCount == 0 || indexCount == 0)
+		return -1;
+	if (vertexCount > maxVertices - usedVertices || indexCount > maxIndices - usedIndices)
+	{
+		printf("Mesh arena full (%u of %u vertices, %u of %u indices), mesh with %u vertices stays separate\n",
+			usedVertices, maxVertices, usedIndices, maxIndices, vertexCount);
+		return -1;
+	}
+
+	std::vector<ArenaVertex> vertices(vertexCount);
+	for (GLuint i = 0; i < vertexCount; i++)
+	{
+		vertices[i].position = positions[i];
+		vertices[i].uv = uvs ? uvs[i] : glm::vec2(0.0f);
+		vertices[i].normal = normals[i];
+	}
+	std::vector<GLuint> wide(indexCount);
+	for (GLuint i = 0; i < indexCount; i++)
+		wide[i] = indexSize == sizeof(GLushort) ? ((const GLushort*)indices)[i] : ((const GLuint*)indices)[i];
+
+	// Das VAO bleibt dabei ungebunden, nur die Buffer werden beschrieben
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)usedVertices * sizeof(ArenaVertex), vertexCount * sizeof(ArenaVertex), &vertices[0]);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)usedIndices * sizeof(GLuint), indexCount * sizeof(GLuint), &wide[0]);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	Mesh mesh;
+	mesh.firstIndex = usedIndices;
+	mesh.indexCount = indexCount;
+	mesh.baseVertex = (GLint)usedVertices;
+	mesh.sphere = sphere;
+	meshes.push_back(mesh);
+
+	usedVertices += vertexCount;
+	usedIndices += indexCount;
+	return (int)meshes.size() - 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    IndirectRenderer
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Platz fuer etwa 1 Mio. Eckpunkte (32 MB) und 4 Mio. Indizes (16 MB)
+static const GLuint ARENA_VERTICES = 1 << 20;
+static const GLuint ARENA_INDICES = 1 << 22;
+
+// Muss zu local_size_x in CullObjects.computeshader passen
+static const GLuint CULL_GROUP_SIZE = 64;
+
+// Bindungspunkte der Shader Storage Buffer (layout(binding = ...) in den Shadern)
+enum
+{
+	OBJECT_BINDING = 0,
+	MESH_BINDING = 1,
+	COMMAND_BINDING = 2,
+	VISIBLE_BINDING = 3
+};
+
+// Location des Instanz-Attributs mit der Nummer des Objekts (StandardShadingIndirect.vertexshader)
+static const GLuint OBJECT_INDEX_LOCATION = 7;
+
+// Waechst auf das Doppelte, damit nicht jeder Frame mit ein paar Objekten mehr neu anlegt.
+// Der Inhalt wird jeden Frame neu geschrieben und muss nicht erhalten bleiben.
+static void uploadBuffer(GLenum target, GLuint buffer, size_t& capacity, const void* data, size_t bytes)
+{
+	glBindBuffer(target, buffer);
+	if (bytes > capacity)
+	{
+		capacity = capacity ? capacity : 1024;
+		while (capacity < bytes)
+			capacity *= 2;
+		glBufferData(target, capacity, NULL, GL_DYNAMIC_DRAW);
+	}
+	if (data && bytes)
+		glBufferSubData(target, 0, bytes, data);
+}
+
+IndirectRenderer::IndirectRenderer()
+	: objectBuffer(0), meshBuffer(0), commandBuffer(0), visibleBuffer(0),
+	objectCapacity(0), commandCapacity(0), visibleCapacity(0), meshesUploaded(0)
+{
+}
+
+bool IndirectRenderer::create(GLuint perFrameBinding)
+{
+	destroy();
+
+	if (!GLEW_VERSION_4_3 && !(GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object &&
+		GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance))
+	{
+		printf("Multi-draw indirect needs OpenGL 4.3, drawing every mesh separately\n");
+		return false;
+	}
+
+	if (!cullProgram.loadCompute("CullObjects.computeshader") ||
+		!drawProgram.load("StandardShadingIndirect.vertexshader", "StandardShading.fragmentshader"))
+	{
+		printf("Multi-draw indirect shaders not available, drawing every mesh separately\n");
+		cullProgram.destroy();
+		drawProgram.destroy();
+		return false;
+	}
+
+	cullProgram.bindUniformBlock("Cull", CULL_BINDING);
+	drawProgram.bindUniformBlock("PerFrame", perFrameBinding);
+	drawProgram.use();
+	drawProgram.set(drawProgram.uniform("myTextureSampler"), 0);
+
+	cullBuffer.create(CULL_BINDING, sizeof(CullUniforms));
+
+	GLuint buffers[4];
+	glGenBuffers(4, buffers);
+	objectBuffer = buffers[0];
+	meshBuffer = buffers[1];
+	commandBuffer = buffers[2];
+	visibleBuffer = buffers[3];
+
+	meshArena().create(ARENA_VERTICES, ARENA_INDICES);
+
+	// Die Liste der sichtbaren Objekte ist zugleich das Instanz-Attribut: Instanz k eines
+	// Kommandos liest visible[baseInstance + k]
+	glBindVertexArray(meshArena().vertexArray());
+	glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+	glEnableVertexAttribArray(OBJECT_INDEX_LOCATION);
+	glVertexAttribIPointer(OBJECT_INDEX_LOCATION, 1, GL_UNSIGNED_INT, 0, (void*)0);
+	glVertexAttribDivisor(OBJECT_INDEX_LOCATION, 1);
+	glBindVertexArray(0);
+	return true;
+}
+
+void IndirectRenderer::destroy()
+{
+	if (objectBuffer)
+	{
+		GLuint buffers[4] = { objectBuffer, meshBuffer, commandBuffer, visibleBuffer };
+		glDeleteBuffers(4, buffers);
+	}
+	objectBuffer = meshBuffer = commandBuffer = visibleBuffer = 0;
+	objectCapacity = commandCapacity = visibleCapacity = 0;
+	meshesUploaded = 0;
+	objects.clear();
+	textures.clear();
+
+	cullBuffer.destroy();
+	cullProgram.destroy();
+	drawProgram.destroy();
+	meshArena().destroy();
+}
+
+void IndirectRenderer::add(int arenaMesh, GLuint texture, const glm::mat4& model)
+{
+	// Meist gibt es nur zwei, drei Texturen
+	size_t group = 0;
+	while (group < textures.size() && textures[group] != texture)
+		group++;
+	if (group == textures.size())
+		textures.push_back(texture);
+
+	Object object;
+	object.model = model;
+	object.mesh = (GLuint)arenaMesh;
+	object.command = (GLuint)group;
+	object.padding[0] = object.padding[1] = 0;
+	objects.push_back(object);
+}
+
+unsigned int IndirectRenderer::draw(const Frustum& frustum)
+{
+	if (objects.empty())
+	{
+		textures.clear();
+		return 0;
+	}
+
+	const MeshArena& arena = meshArena();
+	size_t meshCount = arena.meshCount();
+
+	// Neue Meshes (z. B. eine Kugel-Detailstufe, die erst jetzt gebraucht wurde) nachtragen
+	if (meshesUploaded != meshCount)
+	{
+		meshSpheres.resize(meshCount);
+		for (size_t m = 0; m < meshCount; m++)
+			meshSpheres[m] = glm::vec4(arena.mesh(m).sphere.center, arena.mesh(m).sphere.radius);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, meshBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, meshCount * sizeof(glm::vec4), &meshSpheres[0], GL_STATIC_DRAW);
+		meshesUploaded = meshCount;
+	}
+
+	// Ein Kommando pro (Textur, Mesh), das vorkommt. baseInstance ist die Anzahl der Objekte
+	// aller Kommandos davor, instanceCount zaehlt der Compute-Shader hoch.
+	commandOf.assign(textures.size() * meshCount, -1);
+	commands.clear();
+	for (size_t i = 0; i < objects.size(); i++)
+		commandOf[objects[i].command * meshCount + objects[i].mesh] = 0; // kommt vor
+	groupFirst.assign(1, 0);
+	for (size_t group = 0; group < textures.size(); group++)
+	{
+		for (size_t m = 0; m < meshCount; m++)
+		{
+			GLint& command = commandOf[group * meshCount + m];
+			if (command < 0)
+				continue;
+			command = (GLint)commands.size();
+			Command drawCommand;
+			drawCommand.count = arena.mesh(m).indexCount;
+			drawCommand.instanceCount = 0;
+			drawCommand.firstIndex = arena.mesh(m).firstIndex;
+			drawCommand.baseVertex = arena.mesh(m).baseVertex;
+			drawCommand.baseInstance = 0; // Platzhalter, zaehlt unten die Objekte
+			commands.push_back(drawCommand);
+		}
+		groupFirst.push_back((GLuint)commands.size());
+	}
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		objects[i].command = (GLuint)commandOf[objects[i].command * meshCount + objects[i].mesh];
+		commands[objects[i].command].baseInstance++;
+	}
+	GLuint offset = 0;
+	for (size_t c = 0; c < commands.size(); c++)
+	{
+		GLuint count = commands[c].baseInstance;
+		commands[c].baseInstance = offset;
+		offset += count;
+	}
+
+	// Objekte und Kommandos aendern sich jeden Frame und kommen in den StreamRing, wenn es ihn
+	// gibt. Die Kommandos schreibt danach auch die GPU, der Fence des Rings deckt das mit ab.
+	StreamRange objectRange, commandRange;
+	size_t objectBytes = objects.size() * sizeof(Object);
+	size_t commandBytes = commands.size() * sizeof(Command);
+	StreamRing& ring = streamRing();
+	if (!ring.upload(&objects[0], objectBytes, ring.storageOffsetAlignment(), objectRange))
+	{
+		uploadBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer, objectCapacity, &objects[0], objectBytes);
+		objectRange.buffer = objectBuffer;
+		objectRange.offset = 0;
+		objectRange.size = (GLsizeiptr)objectBytes;
+	}
+	if (!ring.upload(&commands[0], commandBytes, ring.storageOffsetAlignment(), commandRange))
+	{
+		uploadBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer, commandCapacity, &commands[0], commandBytes);
+		commandRange.buffer = commandBuffer;
+		commandRange.offset = 0;
+		commandRange.size = (GLsizeiptr)commandBytes;
+	}
+	uploadBuffer(GL_SHADER_STORAGE_BUFFER, visibleBuffer, visibleCapacity, NULL, objects.size() * sizeof(GLuint));
+
+	CullUniforms cull;
+	for (int p = 0; p < 6; p++)
+		cull.planes[p] = frustum.planes[p];
+	cull.objectCount = (GLuint)objects.size();
+	cull.padding[0] = cull.padding[1] = cull.padding[2] = 0;
+	cullBuffer.update(&cull);
+
+	// Verwerfen auf der GPU
+	cullProgram.use();
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, objectRange.buffer, objectRange.offset, objectRange.size);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_BINDING, meshBuffer);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandRange.buffer, commandRange.offset, commandRange.size);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_BINDING, visibleBuffer);
+	glDispatchCompute(((GLuint)objects.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	// Die Kommandos, die Instanz-Attribute und der Objekt-Buffer muessen fertig geschrieben sein
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// Zeichnen: ein Aufruf pro Textur
+	drawProgram.use();
+	glBindVertexArray(arena.vertexArray());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandRange.buffer);
+	unsigned int calls = 0;
+	for (size_t group = 0; group < textures.size(); group++)
+	{
+		GLsizei drawCount = (GLsizei)(groupFirst[group + 1] - groupFirst[group]);
+		if (drawCount == 0)
+			continue;
+		glBindTexture(GL_TEXTURE_2D, textures[group]);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+			(void*)(commandRange.offset + groupFirst[group] * sizeof(Command)), drawCount, sizeof(Command));
+		calls++;
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	objects.clear();
+	textures.clear();
+	return calls;
+}
@@ -0,0 +1,145 @@
+#ifndef INDIRECT_HPP
+#define INDIRECT_HPP
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+#include "shader.hpp"
+
+// Ein Eckpunkt in der Arena (32 Bytes), dieselben Attribute wie bei Obj3D ohne kompaktes Layout
+struct ArenaVertex
+{
+	glm::vec3 position;
+	glm::vec2 uv;
+	glm::vec3 normal;
+};
+
+// Alle statischen Meshes in einem grossen Vertexbuffer und einem grossen Indexbuffer
+// (32-Bit-Indizes, relativ zum ersten Eckpunkt des Meshes), mit einem gemeinsamen VAO.
+// Verteilt wird einfach der Reihe nach, freigegeben wird nichts: die Meshes leben bis
+// destroy(). Ist die Arena voll, bekommt ein Mesh keinen Platz und wird wie bisher
+// aus seinen eigenen Buffern gezeichnet.
+class MeshArena
+{
+public:
+	struct Mesh
+	{
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLint baseVertex;
+		BoundingSphere sphere; // in Modellkoordinaten
+	};
+
+private:
+	GLuint vertexArrayID;
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+	GLuint maxVertices;
+	GLuint maxIndices;
+	GLuint usedVertices;
+	GLuint usedIndices;
+	std::vector<Mesh> meshes;
+
+	MeshArena(const MeshArena&);            // nicht kopierbar
+	MeshArena& operator=(const MeshArena&);
+
+public:
+	MeshArena();
+
+	void create(GLuint maxVertices, GLuint maxIndices);
+	void destroy();
+	bool created() const { return vertexArrayID != 0; }
+
+	// Kopiert ein Mesh in die Arena und gibt seine Nummer zurueck, -1 wenn es nicht mehr passt.
+	// uvs darf NULL sein, indexSize ist 2 oder 4.
+	int add(const glm::vec3* positions, const glm::vec2* uvs, const glm::vec3* normals, GLuint vertexCount,
+		const void* indices, GLuint indexSize, GLuint indexCount, const BoundingSphere& sphere);
+
+	GLuint vertexArray() const { return vertexArrayID; }
+	size_t meshCount() const { return meshes.size(); }
+	const Mesh& mesh(size_t index) const { return meshes[index]; }
+};
+
+// Die Arena des Programms, leer, bis jemand create() aufruft (siehe IndirectRenderer)
+MeshArena& meshArena();
+
+// Zeichnet Meshes aus der Arena ohne einen Draw-Aufruf pro Mesh: Model-Matrix und Mesh
+// jedes Objekts liegen in einem Shader Storage Buffer, ein Compute-Shader testet jedes
+// Objekt gegen das Frustum und traegt die sichtbaren in DrawElementsIndirectCommands ein
+// (instanceCount per atomicAdd). Danach zeichnet ein glMultiDrawElementsIndirect pro Textur
+// alles auf einmal, die CPU sortiert und verwirft nichts mehr.
+// Das Objekt einer Instanz kommt als Instanz-Attribut (location 7) aus der Liste der
+// sichtbaren Objekte; baseInstance jedes Kommandos zeigt auf seinen Abschnitt darin.
+// In welcher Reihenfolge die Instanzen eines Kommandos gezeichnet werden, entscheidet die GPU.
+// Braucht GL 4.3 (Compute-Shader, Shader Storage Buffer, Multi-Draw Indirect).
+class IndirectRenderer
+{
+	// Layout wie in CullObjects.computeshader (std430)
+	struct Object
+	{
+		glm::mat4 model;
+		GLuint mesh;
+		GLuint command; // beim Einreichen die Gruppe (Textur), beim Zeichnen das Kommando
+		GLuint padding[2];
+	};
+
+	struct Command
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// std140, Bindungspunkt CULL_BINDING
+	struct CullUniforms
+	{
+		glm::vec4 planes[6];
+		GLuint objectCount;
+		GLuint padding[3];
+	};
+
+	ShaderProgram cullProgram;
+	ShaderProgram drawProgram;
+	UniformBuffer cullBuffer;
+
+	GLuint objectBuffer;
+	GLuint meshBuffer;
+	GLuint commandBuffer;
+	GLuint visibleBuffer;
+	size_t objectCapacity;   // in Bytes, die Buffer wachsen nur
+	size_t commandCapacity;
+	size_t visibleCapacity;
+	size_t meshesUploaded;
+
+	std::vector<Object> objects;
+	std::vector<GLuint> textures;      // eine Gruppe pro Textur, in der Reihenfolge des ersten Auftretens
+	std::vector<Command> commands;
+	std::vector<GLuint> groupFirst;    // erstes Kommando jeder Gruppe, plus ein Ende
+	std::vector<GLint> commandOf;      // (Gruppe, Mesh) -> Kommando oder -1
+	std::vector<glm::vec4> meshSpheres;
+
+	IndirectRenderer(const IndirectRenderer&);            // nicht kopierbar
+	IndirectRenderer& operator=(const IndirectRenderer&);
+
+public:
+	enum { CULL_BINDING = 1 };
+
+	IndirectRenderer();
+
+	// Legt auch die Arena an. false, wenn GL 4.3 fehlt oder ein Shader nicht geht.
+	bool create(GLuint perFrameBinding);
+	void destroy();
+
+	void add(int arenaMesh, GLuint texture, const glm::mat4& model);
+	size_t size() const { return objects.size(); }
+
+	// Verwirft und zeichnet alles Eingereichte, gibt die Anzahl der Draw-Aufrufe zurueck.
+	// Danach ist die Liste leer.
+	unsigned int draw(const Frustum& frustum);
+};
+
+#endif
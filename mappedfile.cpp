@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mappedfile.hpp"
+
+// Leere Dateien lassen sich nicht mappen, sind aber trotzdem gueltig
+static const char emptyFile[1] = { 0 };
+
+MappedFile::MappedFile()
+	: mappedData(NULL), mappedSize(0)
+#ifdef _WIN32
+	, fileHandle(NULL), mappingHandle(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path)
+{
+	close();
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || (unsigned long long)fileSize.QuadPart > (size_t)-1)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	if (fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		mappedData = emptyFile;
+		mappedSize = 0;
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	mappedData = (const char*)view;
+	mappedSize = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mappedData && mappedData != emptyFile)
+		UnmapViewOfFile(mappedData);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	if (fileHandle)
+		CloseHandle(fileHandle);
+
+	mappedData = NULL;
+	mappedSize = 0;
+	fileHandle = NULL;
+	mappingHandle = NULL;
+}
+
+#else
+
+bool MappedFile::open(const char* path)
+{
+	close();
+
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	if (st.st_size == 0)
+	{
+		::close(fd);
+		mappedData = emptyFile;
+		mappedSize = 0;
+		return true;
+	}
+
+	void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// Das Mapping bleibt auch nach dem Schliessen des Deskriptors gueltig
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+
+	madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	mappedData = (const char*)view;
+	mappedSize = (size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mappedData && mappedData != emptyFile)
+		munmap((void*)mappedData, mappedSize);
+
+	mappedData = NULL;
+	mappedSize = 0;
+}
+
+#endif
+
+bool getFileStamp(const char* path, unsigned long long& size, unsigned long long& modificationTime)
+{
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_stat64(path, &st) != 0)
+		return false;
+#else
+	struct stat st;
+	if (stat(path, &st) != 0)
+		return false;
+#endif
+	size = (unsigned long long)st.st_size;
+	modificationTime = (unsigned long long)st.st_mtime;
+	return true;
+}
+
+unsigned long long hashBytes(const void* data, size_t size, unsigned long long hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
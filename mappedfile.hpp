@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file.
+// The contents are paged in by the OS on demand, so there is no read() into
+// an intermediate buffer. The mapping lives as long as the object.
+class MappedFile
+{
+	const char* mappedData;
+	size_t mappedSize;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+
+	MappedFile(const MappedFile&);            // nicht kopierbar
+	MappedFile& operator=(const MappedFile&);
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const char* path);
+	void close();
+
+	bool isOpen() const { return mappedData != NULL; }
+	const char* data() const { return mappedData; }
+	size_t size() const { return mappedSize; }
+};
+
+// Groesse und Aenderungszeit (Sekunden seit 1970) einer Datei, false wenn es sie nicht gibt
+bool getFileStamp(const char* path, unsigned long long& size, unsigned long long& modificationTime);
+
+// FNV-1a, 64 bit. Schnell genug, um ganze Dateien zu pruefen, aber kein kryptographischer Hash.
+unsigned long long hashBytes(const void* data, size_t size, unsigned long long hash = 14695981039346656037ULL);
+
+#endif
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "meshcache.hpp"
+
+namespace {
+
+// Aufbau der Datei: dieser Header, danach die Streams, jeweils auf 16 Bytes ausgerichtet
+struct MeshCacheHeader
+{
+	char magic[4];                  // "ANTM"
+	unsigned int version;           // MESHCACHE_VERSION
+	unsigned long long sourceSize;  // Stempel der OBJ-Datei, aus der der Cache erzeugt wurde
+	unsigned long long sourceTime;
+	unsigned long long sourceHash;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	unsigned int indexSize;
+	float boundsRadius;
+	float boundsMin[3];
+	float boundsMax[3];
+	unsigned long long positionsOffset;
+	unsigned long long uvsOffset;
+	unsigned long long normalsOffset;
+	unsigned long long indicesOffset;
+};
+
+static_assert(sizeof(MeshCacheHeader) == 104, "MeshCacheHeader must have the same layout on all platforms");
+
+const char meshCacheMagic[4] = { 'A', 'N', 'T', 'M' };
+
+unsigned long long align16(unsigned long long offset)
+{
+	return (offset + 15) & ~15ULL;
+}
+
+bool inFile(const MappedFile& file, unsigned long long offset, unsigned long long bytes)
+{
+	return offset <= file.size() && bytes <= file.size() - offset;
+}
+
+// Prueft Kennung, Version und dass alle Streams innerhalb der Datei liegen
+const MeshCacheHeader* validHeader(const MappedFile& file)
+{
+	if (file.size() < sizeof(MeshCacheHeader))
+		return NULL;
+
+	const MeshCacheHeader* header = (const MeshCacheHeader*)file.data();
+	if (memcmp(header->magic, meshCacheMagic, 4) != 0 || header->version != MESHCACHE_VERSION)
+		return NULL;
+	if (header->indexSize != 0 && header->indexSize != 2 && header->indexSize != 4)
+		return NULL;
+
+	unsigned long long vertexCount = header->vertexCount;
+	if (!inFile(file, header->positionsOffset, vertexCount * sizeof(glm::vec3)) ||
+		!inFile(file, header->uvsOffset,       vertexCount * sizeof(glm::vec2)) ||
+		!inFile(file, header->normalsOffset,   vertexCount * sizeof(glm::vec3)) ||
+		!inFile(file, header->indicesOffset,   (unsigned long long)header->indexCount * header->indexSize))
+		return NULL;
+
+	return header;
+}
+
+// Traegt nach einem "touch" der OBJ-Datei den neuen Stempel ein, damit der Hash nur einmal faellt
+void updateSourceStamp(const std::string& path, unsigned long long size, unsigned long long time)
+{
+	FILE* file = fopen(path.c_str(), "r+b");
+	if (!file)
+		return;
+
+	MeshCacheHeader header;
+	if (fread(&header, sizeof(header), 1, file) == 1)
+	{
+		header.sourceSize = size;
+		header.sourceTime = time;
+		fseek(file, 0, SEEK_SET);
+		fwrite(&header, sizeof(header), 1, file);
+	}
+	fclose(file);
+}
+
+bool writeStream(FILE* file, unsigned long long& offset, const void* data, unsigned long long bytes)
+{
+	static const char zeros[16] = { 0 };
+	unsigned long long aligned = align16(offset);
+	if (aligned > offset && fwrite(zeros, 1, (size_t)(aligned - offset), file) != aligned - offset)
+		return false;
+	offset = aligned + bytes;
+	return bytes == 0 || fwrite(data, 1, (size_t)bytes, file) == bytes;
+}
+
+} // namespace
+
+std::string meshCachePath(const char* objPath)
+{
+	std::string path(objPath);
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		path.erase(dot);
+	return path + ".antmesh";
+}
+
+bool openMeshCache(const char* objPath, MappedFile& file, MeshStreams& streams)
+{
+	std::string path = meshCachePath(objPath);
+	if (!file.open(path.c_str()))
+		return false;
+
+	const MeshCacheHeader* header = validHeader(file);
+	if (!header)
+	{
+		printf("%s is not a valid mesh cache (version %d expected), rebuilding it\n", path.c_str(), MESHCACHE_VERSION);
+		file.close();
+		return false;
+	}
+
+	// Ohne OBJ-Datei (z. B. nur der Cache ausgeliefert) wird der Cache ungeprueft verwendet
+	unsigned long long size, time;
+	if (getFileStamp(objPath, size, time) && (size != header->sourceSize || time != header->sourceTime))
+	{
+		// Zeitstempel geaendert, aber vielleicht nicht der Inhalt (z. B. nach einem Checkout)
+		MappedFile source;
+		if (!source.open(objPath) || hashBytes(source.data(), source.size()) != header->sourceHash)
+		{
+			printf("%s is out of date, rebuilding it\n", path.c_str());
+			file.close();
+			return false;
+		}
+
+		file.close();
+		updateSourceStamp(path, size, time);
+		if (!file.open(path.c_str()) || !(header = validHeader(file)))
+		{
+			file.close();
+			return false;
+		}
+	}
+
+	streams.positions   = (const glm::vec3*)(file.data() + header->positionsOffset);
+	streams.uvs         = (const glm::vec2*)(file.data() + header->uvsOffset);
+	streams.normals     = (const glm::vec3*)(file.data() + header->normalsOffset);
+	streams.indices     = header->indexCount ? file.data() + header->indicesOffset : NULL;
+	streams.vertexCount = header->vertexCount;
+	streams.indexCount  = header->indexCount;
+	streams.indexSize   = header->indexSize;
+	streams.boundsMin   = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+	streams.boundsMax   = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+	streams.boundsRadius = header->boundsRadius;
+	return true;
+}
+
+bool writeMeshCache(const char* objPath, MeshStreams& streams)
+{
+	streams.boundsMin = glm::vec3(0.0f);
+	streams.boundsMax = glm::vec3(0.0f);
+	if (streams.vertexCount)
+	{
+		streams.boundsMin = streams.boundsMax = streams.positions[0];
+		for (unsigned int i = 1; i < streams.vertexCount; i++)
+		{
+			streams.boundsMin = glm::min(streams.boundsMin, streams.positions[i]);
+			streams.boundsMax = glm::max(streams.boundsMax, streams.positions[i]);
+		}
+	}
+
+	// Die Kugel um die Mitte der Box ist enger als die halbe Diagonale, wenn die Ecken der Box leer sind
+	glm::vec3 center = (streams.boundsMin + streams.boundsMax) * 0.5f;
+	float radiusSquared = 0.0f;
+	for (unsigned int i = 0; i < streams.vertexCount; i++)
+	{
+		glm::vec3 offset = streams.positions[i] - center;
+		radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+	}
+	streams.boundsRadius = sqrtf(radiusSquared);
+
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, meshCacheMagic, 4);
+	header.version = MESHCACHE_VERSION;
+
+	MappedFile source;
+	if (!source.open(objPath) || !getFileStamp(objPath, header.sourceSize, header.sourceTime))
+		return false;
+	header.sourceHash = hashBytes(source.data(), source.size());
+	source.close();
+
+	header.vertexCount = streams.vertexCount;
+	header.indexCount  = streams.indices ? streams.indexCount : 0;
+	header.indexSize   = streams.indices ? streams.indexSize : 0;
+	for (int i = 0; i < 3; i++)
+	{
+		header.boundsMin[i] = streams.boundsMin[i];
+		header.boundsMax[i] = streams.boundsMax[i];
+	}
+	header.boundsRadius = streams.boundsRadius;
+
+	unsigned long long vertexCount = streams.vertexCount;
+	header.positionsOffset = align16(sizeof(header));
+	header.uvsOffset       = align16(header.positionsOffset + vertexCount * sizeof(glm::vec3));
+	header.normalsOffset   = align16(header.uvsOffset + vertexCount * sizeof(glm::vec2));
+	header.indicesOffset   = align16(header.normalsOffset + vertexCount * sizeof(glm::vec3));
+
+	// Erst in eine temporaere Datei schreiben, damit ein Abbruch keinen halben Cache hinterlaesst
+	std::string path = meshCachePath(objPath);
+	std::string tempPath = path + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (!file)
+	{
+		printf("Could not write mesh cache %s\n", path.c_str());
+		return false;
+	}
+
+	unsigned long long offset = 0;
+	bool ok = writeStream(file, offset, &header, sizeof(header))
+		&& writeStream(file, offset, streams.positions, vertexCount * sizeof(glm::vec3))
+		&& writeStream(file, offset, streams.uvs, vertexCount * sizeof(glm::vec2))
+		&& writeStream(file, offset, streams.normals, vertexCount * sizeof(glm::vec3))
+		&& writeStream(file, offset, streams.indices, (unsigned long long)header.indexCount * header.indexSize);
+	ok = fclose(file) == 0 && ok;
+
+	remove(path.c_str()); // rename ueberschreibt unter Windows nicht
+	if (!ok || rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		printf("Could not write mesh cache %s\n", path.c_str());
+		remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,42 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+// Binaerer Cache fuer geladene OBJ-Dateien (".antmesh" neben der OBJ-Datei).
+// Die Datei enthaelt die fertigen Vertex-Streams, Indizes und die Bounding-Box, so dass
+// sie beim naechsten Start nur gemappt und direkt an glBufferData uebergeben werden muss.
+// Der Cache wird verworfen, wenn sich die OBJ-Datei geaendert hat (Groesse/Zeit und Hash).
+
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "mappedfile.hpp"
+
+#define MESHCACHE_VERSION 3 // 2: indiziert und fuer den Vertex-Cache sortiert, 3: mit Kugelradius
+
+// Zeiger auf die Streams eines Meshes, entweder in einen gemappten Cache oder in std::vectors
+struct MeshStreams
+{
+	const glm::vec3* positions;
+	const glm::vec2* uvs;
+	const glm::vec3* normals;
+	const void* indices;        // NULL wenn nicht indiziert
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	unsigned int indexSize;     // 2 oder 4 Bytes, 0 wenn nicht indiziert
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	float boundsRadius;         // umschliessende Kugel um die Mitte der Bounding-Box
+};
+
+// Pfad der Cache-Datei zu einer OBJ-Datei: "ant.obj" -> "ant.antmesh"
+std::string meshCachePath(const char* objPath);
+
+// Mappt den Cache zu objPath, wenn er zur OBJ-Datei passt. Die Zeiger in streams
+// bleiben gueltig, solange file offen ist.
+bool openMeshCache(const char* objPath, MappedFile& file, MeshStreams& streams);
+
+// Schreibt den Cache zu objPath. Bounding-Box und Kugelradius werden hier berechnet und in streams eingetragen.
+bool writeMeshCache(const char* objPath, MeshStreams& streams);
+
+#endif
@@ -4,14 +4,62 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <vector>
+#include <map>
 
 // Include GLEW
 #include <GL/glew.h>
 
+// Include GLM
+#include <glm/glm.hpp>
 
+#include "objects.hpp"
+#include "indirect.hpp"
+#include "streamring.hpp"
 
 
 
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Instanzen
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Eine mat4 belegt vier Attribute (3 bis 6), je eines pro Spalte
+static void pointInstanceAttributes(GLuint buffer, GLintptr offset)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (int column = 0; column < 4; column++)
+		glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + column * sizeof(glm::vec4)));
+}
+
+GLuint createInstanceBuffer()
+{
+	GLuint instancebuffer;
+	glGenBuffers(1, &instancebuffer);
+	pointInstanceAttributes(instancebuffer, 0);
+	for (int column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(3 + column);
+		glVertexAttribDivisor(3 + column, 1); // einmal pro Instanz weiterschalten statt pro Eckpunkt
+	}
+	return instancebuffer;
+}
+
+void uploadInstanceMatrices(GLuint instancebuffer, const glm::mat4* models, GLsizei count)
+{
+	// Am liebsten in den Ring dieses Frames, die Attribute zeigen dann dorthin
+	StreamRange range;
+	if (streamRing().upload(models, count * sizeof(glm::mat4), 16, range))
+	{
+		pointInstanceAttributes(range.buffer, range.offset);
+		return;
+	}
+
+	// glBufferData mit neuem Speicher, damit nicht auf den letzten Frame gewartet werden muss
+	pointInstanceAttributes(instancebuffer, 0);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), models, GL_STREAM_DRAW);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////    DrahtWuerfel-Objekt
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -167,107 +215,301 @@ void drawCube()
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-////    Kugel-Objekt
+////    Grundkoerper (Kugel, Bodenplatte), einmal pro (Art, slices, stacks)
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-GLuint VertexArrayIDSphere = 0;
-GLuint lats;
-GLuint longs;
-
+// Feiner als die angeforderte Kugel wird nie gezeichnet, die Stufen dazwischen werden geteilt
+static const GLuint SPHERE_LOD_SLICES[] = { 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+// Erlaubte Abweichung der Kugeloberflaeche vom Umriss, in Pixeln
+static const float SPHERE_LOD_ERROR_PIXELS = 1.0f;
 
-// Dieser Code  basiert auf http://ozark.hendrix.edu/~burch/cs/490/sched/feb8/
-static void createSphere()
+class PrimitiveDrawable : public Drawable
 {
-	glGenVertexArrays(1, &VertexArrayIDSphere);
-	glBindVertexArray(VertexArrayIDSphere);
+public:
+	PrimitiveType type;
+	GLuint slices;
+	GLuint stacks;
+	GLuint vertexArrayID;
+	GLuint instanceBuffer;
+	GLsizei indexCount;
+	GLenum mode;
+	BoundingBox box;
+	BoundingSphere sphere;
+	int arenaMeshID; // immer als GL_TRIANGLES
+
+	GLuint vertexArray()
+	{
+		return vertexArrayID;
+	}
 
-	static GLuint sphereVertexBuffer = 0;
-	static GLfloat* sphereVertexBufferData = NULL;
-	static GLfloat* sphereNormalBufferData = NULL;
+	void drawInstanced(const glm::mat4* models, GLsizei count)
+	{
+		if (count <= 0)
+			return;
+		glBindVertexArray(vertexArrayID);
+		uploadInstanceMatrices(instanceBuffer, models, count);
+		glDrawElementsInstanced(mode, indexCount, GL_UNSIGNED_SHORT, (void*)0, count);
+	}
 
-	sphereVertexBufferData = new GLfloat [6 * (lats + 1) * (longs + 1)];
-	sphereNormalBufferData = new GLfloat [6 * (lats + 1) * (longs + 1)];
-	int index = 0;
+	BoundingBox boundingBox()
+	{
+		return box;
+	}
 
-    for (int i = 0; i <= lats; i++) 
+	BoundingSphere boundingSphere()
 	{
-          GLfloat lat0 = (GLfloat) M_PI * ((GLfloat) -0.5 + (GLfloat) (i - 1) / (GLfloat) lats);
-          GLfloat z0  = sin(lat0);
-          GLfloat zr0 =  cos(lat0);
-    
-          GLfloat lat1 = (GLfloat) M_PI * ((GLfloat) -0.5 + (GLfloat) i / (GLfloat) lats);
-          GLfloat z1 = sin(lat1);
-          GLfloat zr1 = cos(lat1);
-    
-		  for (int j = 0; j <= longs; j++)
-		  {
-              GLfloat lng = (GLfloat) 2 * (GLfloat) M_PI * (GLfloat) (j - 1) / (GLfloat) longs;
-              GLfloat x = cos(lng);
-              GLfloat y = sin(lng);
-
-			  sphereNormalBufferData[index] = x * zr0;
-			  sphereVertexBufferData[index++] = x * zr0;
-			  sphereNormalBufferData[index] = y * zr0;
-			  sphereVertexBufferData[index++] = y * zr0;
-			  sphereNormalBufferData[index] = z0;
-			  sphereVertexBufferData[index++] = z0;
-			  sphereNormalBufferData[index] = x * zr1;
-			  sphereVertexBufferData[index++] = x * zr1;
-			  sphereNormalBufferData[index] = y * zr1;
-			  sphereVertexBufferData[index++] = y * zr1;
-			  sphereNormalBufferData[index] = z1;
-			  sphereVertexBufferData[index++] = z1;
-          }
-     }
+		return sphere;
+	}
 
-	GLuint vertexbuffer;
-	GLuint normalbuffer;
-	
-	glGenBuffers(1, &vertexbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * (lats + 1) * (longs + 1), sphereVertexBufferData, GL_STATIC_DRAW);
+	unsigned int triangleCount()
+	{
+		return mode == GL_TRIANGLE_STRIP ? indexCount - 2 : indexCount / 3;
+	}
 
-	glGenBuffers(1, &normalbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * (lats + 1) * (longs + 1), sphereNormalBufferData, GL_STATIC_DRAW);
+	Drawable* levelOfDetail(float pixelRadius);
 
-	glEnableVertexAttribArray(0); // Kein Disable ausfhren !
-	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glVertexAttribPointer(
-			0,                  // attribute. No particular reason for 0, but must match the layout in the shader.
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-	);
+	int arenaMesh()
+	{
+		return arenaMeshID;
+	}
+};
 
-	// 2nd attribute buffer : normals
-	glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-	glEnableVertexAttribArray(2); // Kein Disable ausfhren !
-	glVertexAttribPointer(
-			2,                                // attribute. No particular reason for 2, but must match the layout in the shader.
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-	);
+static std::map<unsigned long long, PrimitiveDrawable*> primitives;
+
+// Einheitskugel um den Ursprung, Pole auf der z-Achse wie bisher. Auf der Einheitskugel ist
+// die Normale gleich der Position, beide Attribute lesen also denselben Buffer.
+// Die Pole sind je ein Eckpunkt, die Naht wird nicht verdoppelt (die Kugel hat keine UVs).
+static void createSphere(PrimitiveDrawable& sphere)
+{
+	GLuint slices = sphere.slices, stacks = sphere.stacks;
+	std::vector<glm::vec3> positions;
+	positions.reserve(2 + (stacks - 1) * slices);
+	positions.push_back(glm::vec3(0, 0, -1));
+	for (GLuint i = 1; i < stacks; i++)
+	{
+		GLfloat lat = (GLfloat) M_PI * ((GLfloat) -0.5 + (GLfloat) i / (GLfloat) stacks);
+		for (GLuint j = 0; j < slices; j++)
+		{
+			GLfloat lng = (GLfloat) 2 * (GLfloat) M_PI * (GLfloat) j / (GLfloat) slices;
+			positions.push_back(glm::vec3(cos(lng) * cos(lat), sin(lng) * cos(lat), sin(lat)));
+		}
+	}
+	positions.push_back(glm::vec3(0, 0, 1));
+
+	// Dreiecke gegen den Uhrzeigersinn von aussen gesehen
+	GLushort south = 0, north = (GLushort)(positions.size() - 1);
+	std::vector<GLushort> indices;
+	indices.reserve(3 * slices * (2 * stacks - 2));
+	for (GLuint j = 0; j < slices; j++)
+	{
+		GLuint next = (j + 1) % slices;
+		indices.push_back(south);
+		indices.push_back((GLushort)(1 + next));
+		indices.push_back((GLushort)(1 + j));
+	}
+	for (GLuint i = 0; i + 2 < stacks; i++)
+	{
+		GLuint ring = 1 + i * slices, above = ring + slices;
+		for (GLuint j = 0; j < slices; j++)
+		{
+			GLuint next = (j + 1) % slices;
+			indices.push_back((GLushort)(ring + j));
+			indices.push_back((GLushort)(ring + next));
+			indices.push_back((GLushort)(above + next));
+			indices.push_back((GLushort)(ring + j));
+			indices.push_back((GLushort)(above + next));
+			indices.push_back((GLushort)(above + j));
+		}
+	}
+	GLuint last = 1 + (stacks - 2) * slices;
+	for (GLuint j = 0; j < slices; j++)
+	{
+		GLuint next = (j + 1) % slices;
+		indices.push_back((GLushort)(last + j));
+		indices.push_back((GLushort)(last + next));
+		indices.push_back(north);
+	}
+
+	GLuint buffers[2];
+	glGenBuffers(2, buffers);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), &positions[0], GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0); // Position
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(2); // Normale, dieselben Daten
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+
+	sphere.mode = GL_TRIANGLES;
+	sphere.indexCount = (GLsizei)indices.size();
+	sphere.box.min = glm::vec3(-1.0f);
+	sphere.box.max = glm::vec3(1.0f);
+	sphere.sphere.center = glm::vec3(0.0f);
+	sphere.sphere.radius = 1.0f;
+
+	if (meshArena().created())
+		sphere.arenaMeshID = meshArena().add(&positions[0], NULL, &positions[0], (GLuint)positions.size(),
+			&indices[0], sizeof(GLushort), (GLuint)indices.size(), sphere.sphere);
+}
 
+// Quadrat [-1, 1] in der x-z-Ebene aus slices x stacks Feldern, Normale nach oben,
+// UV (0,0) bei (-1, -1) bis (1,1) bei (1, 1). Ein Streifen pro Reihe, verbunden durch leere Dreiecke.
+static void createPlane(PrimitiveDrawable& plane)
+{
+	struct PlaneVertex
+	{
+		glm::vec3 position;
+		glm::vec2 uv;
+		glm::vec3 normal;
+	};
+
+	GLuint slices = plane.slices, stacks = plane.stacks;
+	std::vector<PlaneVertex> vertices;
+	for (GLuint i = 0; i <= stacks; i++)
+	{
+		for (GLuint j = 0; j <= slices; j++)
+		{
+			PlaneVertex vertex;
+			vertex.uv = glm::vec2((GLfloat)j / slices, (GLfloat)i / stacks);
+			vertex.position = glm::vec3(vertex.uv.x * 2.0f - 1.0f, 0.0f, vertex.uv.y * 2.0f - 1.0f);
+			vertex.normal = glm::vec3(0, 1, 0);
+			vertices.push_back(vertex);
+		}
+	}
+	std::vector<GLushort> indices;
+	for (GLuint i = 0; i < stacks; i++)
+	{
+		if (i > 0)
+			indices.push_back((GLushort)(i * (slices + 1))); // leeres Dreieck zur naechsten Reihe
+		for (GLuint j = 0; j <= slices; j++)
+		{
+			indices.push_back((GLushort)(i * (slices + 1) + j));
+			indices.push_back((GLushort)((i + 1) * (slices + 1) + j));
+		}
+		if (i + 1 < stacks)
+			indices.push_back(indices.back());
+	}
+
+	GLuint buffers[2];
+	glGenBuffers(2, buffers);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PlaneVertex), &vertices[0], GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PlaneVertex), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(PlaneVertex), (void*)sizeof(glm::vec3));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(PlaneVertex), (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+
+	plane.mode = GL_TRIANGLE_STRIP;
+	plane.indexCount = (GLsizei)indices.size();
+	plane.box.min = glm::vec3(-1, 0, -1);
+	plane.box.max = glm::vec3(1, 0, 1);
+	plane.sphere.center = glm::vec3(0.0f);
+	plane.sphere.radius = 1.41421356f;
+
+	// In der Arena wird alles als Dreiecksliste gezeichnet: jedes zweite Dreieck des Streifens
+	// umdrehen, die leeren weglassen
+	if (meshArena().created())
+	{
+		std::vector<GLushort> triangles;
+		for (size_t k = 0; k + 2 < indices.size(); k++)
+		{
+			GLushort a = indices[k], b = indices[k + 1], c = indices[k + 2];
+			if (a == b || b == c || a == c)
+				continue;
+			triangles.push_back(a);
+			triangles.push_back(k % 2 ? c : b);
+			triangles.push_back(k % 2 ? b : c);
+		}
+		std::vector<glm::vec3> positions, normals;
+		std::vector<glm::vec2> uvs;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			positions.push_back(vertices[i].position);
+			uvs.push_back(vertices[i].uv);
+			normals.push_back(vertices[i].normal);
+		}
+		plane.arenaMeshID = meshArena().add(&positions[0], &uvs[0], &normals[0], (GLuint)vertices.size(),
+			&triangles[0], sizeof(GLushort), (GLuint)triangles.size(), plane.sphere);
+	}
+}
+
+static PrimitiveDrawable* primitive(PrimitiveType type, GLuint slices, GLuint stacks)
+{
+	// Weniger geht nicht, und die Indizes muessen in 16 Bit passen
+	GLuint minSlices = type == PRIMITIVE_SPHERE ? 3 : 1;
+	GLuint minStacks = type == PRIMITIVE_SPHERE ? 2 : 1;
+	slices = slices < minSlices ? minSlices : (slices > 250 ? 250 : slices);
+	stacks = stacks < minStacks ? minStacks : (stacks > 250 ? 250 : stacks);
+
+	unsigned long long key = ((unsigned long long)type << 48) | ((unsigned long long)slices << 24) | stacks;
+	std::map<unsigned long long, PrimitiveDrawable*>::iterator found = primitives.find(key);
+	if (found != primitives.end())
+		return found->second;
+
+	PrimitiveDrawable* mesh = new PrimitiveDrawable();
+	mesh->type = type;
+	mesh->slices = slices;
+	mesh->stacks = stacks;
+	mesh->arenaMeshID = -1;
+	glGenVertexArrays(1, &mesh->vertexArrayID);
+	glBindVertexArray(mesh->vertexArrayID);
+	if (type == PRIMITIVE_SPHERE)
+		createSphere(*mesh);
+	else
+		createPlane(*mesh);
+	mesh->instanceBuffer = createInstanceBuffer();
 	glBindVertexArray(0);
+
+	primitives[key] = mesh;
+	return mesh;
 }
 
-// Nur die Angabe bei der ersten Kugel ist relevant
-void drawSphere(GLuint slats, GLuint slongs)
+// Die groebste Stufe, deren Abweichung r * (1 - cos(pi / slices)) unter SPHERE_LOD_ERROR_PIXELS bleibt
+Drawable* PrimitiveDrawable::levelOfDetail(float pixelRadius)
 {
-	if (!VertexArrayIDSphere)
+	if (type != PRIMITIVE_SPHERE)
+		return this;
+
+	for (size_t i = 0; i < sizeof(SPHERE_LOD_SLICES) / sizeof(SPHERE_LOD_SLICES[0]); i++)
 	{
-		lats = slats;
-		longs = slongs;
-		createSphere();
+		GLuint lodSlices = SPHERE_LOD_SLICES[i];
+		if (lodSlices >= slices)
+			break;
+		if (pixelRadius * (1.0f - cosf((float)M_PI / lodSlices)) <= SPHERE_LOD_ERROR_PIXELS)
+		{
+			// Das Verhaeltnis von slices zu stacks bleibt
+			GLuint lodStacks = (stacks * lodSlices + slices / 2) / slices;
+			return primitive(PRIMITIVE_SPHERE, lodSlices, lodStacks < 2 ? 2 : lodStacks);
+		}
 	}
+	return this;
+}
 
-	glBindVertexArray(VertexArrayIDSphere);
-	// Draw the triangles !
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 2 * (lats + 1) * (longs + 1)); 
-}
\ No newline at end of file
+Drawable* primitiveDrawable(PrimitiveType type, GLuint slices, GLuint stacks)
+{
+	return primitive(type, slices, stacks);
+}
+
+void drawSphere(GLuint slices, GLuint stacks)
+{
+	PrimitiveDrawable* sphere = primitive(PRIMITIVE_SPHERE, slices, stacks);
+	glBindVertexArray(sphere->vertexArrayID);
+	glDrawElements(sphere->mode, sphere->indexCount, GL_UNSIGNED_SHORT, (void*)0);
+}
+
+Drawable* sphereDrawable(GLuint slices, GLuint stacks)
+{
+	return primitiveDrawable(PRIMITIVE_SPHERE, slices, stacks);
+}
+
+Drawable* quadDrawable()
+{
+	return primitiveDrawable(PRIMITIVE_PLANE, 1, 1);
+}
@@ -1,11 +1,32 @@
 #ifndef OBJECTS_HPP
 #define OBJECTS_HPP
 
+#include <glm/glm.hpp>
+
+#include "renderqueue.hpp"
+
 void drawWireCube(); // Wuerfel mit Kantenlaenge 2 im Drahtmodell
 void drawCube();     // Bunter Wuerfel mit Kantenlaenge 2
-void drawSphere(GLuint slices, GLuint stacks); // Kugel mit radius 1 bzw. Durchmesser 2
+void drawSphere(GLuint slices, GLuint stacks); // Kugel mit radius 1 bzw. Durchmesser 2, indiziert
+
+enum PrimitiveType
+{
+	PRIMITIVE_SPHERE, // Einheitskugel, slices um die z-Achse, stacks von Pol zu Pol
+	PRIMITIVE_PLANE   // Quadrat [-1, 1] in der x-z-Ebene aus slices x stacks Feldern, UV 0..1
+};
+
+// Jede Kombination aus (Art, slices, stacks) wird beim ersten Aufruf einmal indiziert
+// angelegt und danach geteilt. Kugeln waehlen in der Render-Queue nach ihrer Groesse auf
+// dem Bildschirm eine groebere Stufe (levelOfDetail), nie eine feinere als angefordert.
+Drawable* primitiveDrawable(PrimitiveType type, GLuint slices, GLuint stacks);
+Drawable* sphereDrawable(GLuint slices, GLuint stacks); // primitiveDrawable(PRIMITIVE_SPHERE, ...)
+Drawable* quadDrawable(); // PRIMITIVE_PLANE mit einem Feld, z. B. fuer den Boden
 
-int main(void);
+// Legt im gebundenen VAO einen Buffer fuer eine Model-Matrix pro Instanz an (location 3 bis 6)
+GLuint createInstanceBuffer();
+// Die Matrizen kommen in den StreamRing, falls es ihn gibt und er Platz hat, sonst in instancebuffer.
+// Das VAO muss gebunden sein, seine Attribute 3 bis 6 zeigen danach auf die neuen Daten.
+void uploadInstanceMatrices(GLuint instancebuffer, const glm::mat4* models, GLsizei count);
 
-void shaderHelper();
+int main(int argc, char* argv[]);
 #endif
@@ -2,10 +2,16 @@
 #include <stdio.h>
 #include <string>
 #include <cstring>
+#include <stdlib.h>
+#include <thread>
+#include <atomic>
 
 #include <glm/glm.hpp>
 
 #include "objloader.hpp"
+#include "mappedfile.hpp"
+#include "vboindexer.hpp"
+#include "parallel.hpp"
 
 // Very, VERY simple OBJ loader.
 // Here is a short list of features a real function would provide : 
@@ -17,7 +23,392 @@
 // - More secure. Change another line and you can inject code.
 // - Loading from memory, stream, etc
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Schneller OBJ-Parser
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The file is memory mapped and split into line aligned chunks, which are parsed on all cores.
+// Every chunk collects its own attributes and face indices. OBJ indices are absolute (1-based
+// over the whole file), so the chunks can simply be concatenated in order afterwards.
+// The output is identical to loadOBJReference below, which is kept to verify and benchmark this one.
+
+namespace {
+
+struct ObjChunk
+{
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
+	bool ok;
+
+	ObjChunk() : ok(true) {}
+};
+
+// Chunks below this size are not worth a thread of their own
+const size_t minChunkSize = 256 * 1024;
+
+inline bool isBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+inline const char* skipBlanks(const char* p, const char* end)
+{
+	while (p < end && isBlank(*p))
+		++p;
+	return p;
+}
+
+// All powers of ten that are exact in a float (5^10 < 2^24)
+const float exactPowersOf10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+// Slow path: let strtof handle everything unusual (many digits, large exponents, inf, nan, ...)
+const char* parseFloatStrtof(const char* p, const char* end, float& out)
+{
+	char token[64];
+	size_t length = 0;
+	while (p + length < end && !isBlank(p[length]) && p[length] != '\n' && length < sizeof(token) - 1)
+	{
+		token[length] = p[length];
+		length++;
+	}
+	token[length] = 0;
+
+	char* tokenEnd;
+	out = strtof(token, &tokenEnd);
+	if (tokenEnd == token)
+		return NULL;
+	return p + (tokenEnd - token);
+}
+
+// Parses a float exactly like fscanf("%f") / strtof do. Plain decimal numbers with up to
+// 7-8 significant digits, which is what exporters write, are converted with a single exact
+// float multiplication or division and are therefore correctly rounded as well.
+const char* parseFloat(const char* p, const char* end, float& out)
+{
+	p = skipBlanks(p, end);
+	const char* start = p;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	unsigned long long mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+
+	while (p < end && isDigit(*p))
+	{
+		anyDigits = true;
+		if (mantissa || *p != '0')
+		{
+			if (++significantDigits > 18)
+				return parseFloatStrtof(start, end, out);
+			mantissa = mantissa * 10 + (*p - '0');
+		}
+		++p;
+	}
+	if (p < end && *p == '.')
+	{
+		++p;
+		while (p < end && isDigit(*p))
+		{
+			anyDigits = true;
+			if (mantissa || *p != '0')
+			{
+				if (++significantDigits > 18)
+					return parseFloatStrtof(start, end, out);
+				mantissa = mantissa * 10 + (*p - '0');
+			}
+			exponent--;
+			++p;
+		}
+	}
+	if (!anyDigits || (p < end && !isBlank(*p) && *p != '\n'))
+		return parseFloatStrtof(start, end, out);
+
+	if (mantissa > (1u << 24) || exponent < -10)
+		return parseFloatStrtof(start, end, out);
+
+	float value = (float)mantissa;
+	value = exponent < 0 ? value / exactPowersOf10[-exponent] : value;
+	out = negative ? -value : value;
+	return p;
+}
+
+const char* parseIndex(const char* p, const char* end, unsigned int& out)
+{
+	p = skipBlanks(p, end);
+	if (p >= end || !isDigit(*p))
+		return NULL;
+
+	unsigned int value = 0;
+	while (p < end && isDigit(*p))
+		value = value * 10 + (*p++ - '0');
+
+	out = value;
+	return p;
+}
+
+const char* expect(const char* p, const char* end, char c)
+{
+	return (p && p < end && *p == c) ? p + 1 : NULL;
+}
+
+bool parseFace(const char* p, const char* end, ObjChunk& chunk)
+{
+	unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
+
+	p = parseIndex(p, end, vertexIndex[0]);
+	if (!p)
+		return false;
+
+	if (p < end && *p == '/')
+	{
+		// f v/vt/vn v/vt/vn v/vt/vn
+		for (int i = 0; i < 3; i++)
+		{
+			if (i > 0)
+				p = parseIndex(p, end, vertexIndex[i]);
+			p = expect(p, end, '/');
+			p = p ? parseIndex(p, end, uvIndex[i]) : NULL;
+			p = expect(p, end, '/');
+			p = p ? parseIndex(p, end, normalIndex[i]) : NULL;
+			if (!p)
+				return false;
+		}
+	}
+	else
+	{
+		// f v v v (Teddy-obj-Dateien ohne Normalen und UVs)
+		p = parseIndex(p, end, vertexIndex[1]);
+		p = p ? parseIndex(p, end, vertexIndex[2]) : NULL;
+		if (!p)
+			return false;
+		uvIndex[0] = uvIndex[1] = uvIndex[2] = normalIndex[0] = normalIndex[1] = normalIndex[2] = 0;
+	}
+
+	// Wie beim fscanf-Loader wird alles nach der dritten Ecke ignoriert
+	chunk.vertexIndices.insert(chunk.vertexIndices.end(), vertexIndex, vertexIndex + 3);
+	chunk.uvIndices    .insert(chunk.uvIndices    .end(), uvIndex,     uvIndex + 3);
+	chunk.normalIndices.insert(chunk.normalIndices.end(), normalIndex, normalIndex + 3);
+	return true;
+}
+
+void parseLine(const char* p, const char* end, ObjChunk& chunk)
+{
+	p = skipBlanks(p, end);
+	const char* header = p;
+	while (p < end && !isBlank(*p))
+		++p;
+	size_t headerLength = p - header;
+
+	if (headerLength == 1 && header[0] == 'v'){
+		glm::vec3 vertex;
+		p = parseFloat(p, end, vertex.x);
+		p = p ? parseFloat(p, end, vertex.y) : NULL;
+		p = p ? parseFloat(p, end, vertex.z) : NULL;
+		chunk.vertices.push_back(vertex);
+	}else if (headerLength == 2 && header[0] == 'v' && header[1] == 't'){
+		glm::vec2 uv;
+		p = parseFloat(p, end, uv.x);
+		p = p ? parseFloat(p, end, uv.y) : NULL;
+		uv.y = -uv.y; // Invert V coordinate, see loadOBJReference
+		chunk.uvs.push_back(uv);
+	}else if (headerLength == 2 && header[0] == 'v' && header[1] == 'n'){
+		glm::vec3 normal;
+		p = parseFloat(p, end, normal.x);
+		p = p ? parseFloat(p, end, normal.y) : NULL;
+		p = p ? parseFloat(p, end, normal.z) : NULL;
+		chunk.normals.push_back(normal);
+	}else if (headerLength == 1 && header[0] == 'f'){
+		p = parseFace(p, end, chunk) ? p : NULL;
+	}
+	// everything else (comments, groups, materials, ...) is skipped
+
+	if (!p)
+		chunk.ok = false;
+}
+
+void parseChunk(const char* p, const char* end, ObjChunk* chunk)
+{
+	while (p < end && chunk->ok)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (!lineEnd)
+			lineEnd = end;
+		parseLine(p, lineEnd, *chunk);
+		p = lineEnd + 1;
+	}
+}
+
+template <typename T>
+void appendAll(std::vector<T>& out, const std::vector<ObjChunk>& chunks, std::vector<T> ObjChunk::* member)
+{
+	size_t total = out.size();
+	for (size_t i = 0; i < chunks.size(); i++)
+		total += (chunks[i].*member).size();
+	out.reserve(total);
+	for (size_t i = 0; i < chunks.size(); i++)
+		out.insert(out.end(), (chunks[i].*member).begin(), (chunks[i].*member).end());
+}
+
+} // namespace
+
+bool loadOBJ(
+	const char * path, 
+	std::vector<glm::vec3> & out_vertices, 
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	printf("Loading OBJ file %s...\n", path);
+
+	MappedFile file;
+	if( !file.open(path) ){
+		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		return false;
+	}
+
+	const char* begin = file.data();
+	const char* end = begin + file.size();
+
+	size_t threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+	size_t chunkCount = file.size() / minChunkSize + 1;
+	if (chunkCount > threadCount)
+		chunkCount = threadCount;
+
+	// Chunk boundaries always start right after a line break
+	std::vector<const char*> bounds(chunkCount + 1);
+	bounds[0] = begin;
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		const char* p = begin + file.size() * i / chunkCount;
+		if (p < bounds[i - 1])
+			p = bounds[i - 1];
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		bounds[i] = lineEnd ? lineEnd + 1 : end;
+	}
+	bounds[chunkCount] = end;
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	std::vector<std::thread> threads;
+	threads.reserve(chunkCount - 1);
+	for (size_t i = 1; i < chunkCount; i++)
+		threads.push_back(std::thread(parseChunk, bounds[i], bounds[i + 1], &chunks[i]));
+	parseChunk(bounds[0], bounds[1], &chunks[0]);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		if (!chunks[i].ok)
+		{
+			printf("File can't be read by our simple parser :-( Try exporting with other options\n");
+			return false;
+		}
+	}
+
+	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
+	std::vector<glm::vec3> temp_vertices; 
+	std::vector<glm::vec2> temp_uvs;
+	std::vector<glm::vec3> temp_normals;
+
+	appendAll(temp_vertices, chunks, &ObjChunk::vertices);
+	appendAll(temp_uvs,      chunks, &ObjChunk::uvs);
+	appendAll(temp_normals,  chunks, &ObjChunk::normals);
+	appendAll(vertexIndices, chunks, &ObjChunk::vertexIndices);
+	appendAll(uvIndices,     chunks, &ObjChunk::uvIndices);
+	appendAll(normalIndices, chunks, &ObjChunk::normalIndices);
+	chunks.clear();
+
+	// For each vertex of each triangle, written in parallel straight into the output
+	size_t base = out_vertices.size();
+	size_t count = vertexIndices.size();
+	out_vertices.resize(base + count);
+	out_uvs     .resize(base + count);
+	out_normals .resize(base + count);
+
+	std::atomic<bool> indicesOk(true);
+	parallelFor(count, count < minChunkSize ? 1 : threadCount, [&](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			unsigned int vertexIndex = vertexIndices[i];
+			unsigned int uvIndex = uvIndices[i];
+			unsigned int normalIndex = normalIndices[i];
+
+			if (vertexIndex - 1 >= temp_vertices.size() || uvIndex > temp_uvs.size() || normalIndex > temp_normals.size())
+			{
+				indicesOk = false;
+				return;
+			}
+
+			// Ohne UVs und Normalen (Teddy-obj) wird mit 0 aufgefuellt
+			out_vertices[base + i] = temp_vertices[vertexIndex - 1];
+			out_uvs     [base + i] = uvIndex ? temp_uvs[uvIndex - 1] : glm::vec2(0.0, 0.0);
+			out_normals [base + i] = normalIndex ? temp_normals[normalIndex - 1] : glm::vec3(0.0, 0.0, 0.0);
+		}
+	});
+
+	if (!indicesOk)
+	{
+		printf("File %s references a vertex that does not exist\n", path);
+		out_vertices.resize(base);
+		out_uvs     .resize(base);
+		out_normals .resize(base);
+		return false;
+	}
+
+	return true;
+}
+
 bool loadOBJ(
+	const char * path, 
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices, 
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	if (!loadOBJ(path, vertices, uvs, normals))
+		return false;
+
+	out_indices.clear();
+	out_vertices.clear();
+	out_uvs.clear();
+	out_normals.clear();
+	indexVBO(vertices, uvs, normals, out_indices, out_vertices, out_uvs, out_normals);
+
+	float acmrFileOrder = computeACMR(out_indices, (unsigned int)out_vertices.size());
+	optimizeVertexCache(out_indices, out_vertices, out_uvs, out_normals);
+	float acmrOptimized = computeACMR(out_indices, (unsigned int)out_vertices.size());
+
+	// Ohne Indizes wird jeder Eckpunkt jedes Dreiecks transformiert, ACMR also 3.0
+	printf("%s: %u -> %u vertices (%.1fx fewer), ACMR 3.00 -> %.2f (file order) -> %.2f (optimized)\n",
+		path, (unsigned int)vertices.size(), (unsigned int)out_vertices.size(),
+		out_vertices.empty() ? 0.0 : (double)vertices.size() / out_vertices.size(), acmrFileOrder, acmrOptimized);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Urspruenglicher fscanf-Loader (Referenz fuer Tests und Benchmarks)
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool loadOBJReference(
 	const char * path, 
 	std::vector<glm::vec3> & out_vertices, 
 	std::vector<glm::vec2> & out_uvs,
@@ -34,7 +425,6 @@ bool loadOBJ(
 	FILE * file = fopen(path, "r");
 	if( file == NULL ){
 		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
-		getchar();
 		return false;
 	}
 
@@ -147,8 +537,7 @@ bool loadAssImp(
 
 	const aiScene* scene = importer.ReadFile(path, 0/*aiProcess_JoinIdenticalVertices | aiProcess_SortByPType*/);
 	if( !scene) {
-		fprintf( stderr, importer.GetErrorString());
-		getchar();
+		fprintf( stderr, "%s\n", importer.GetErrorString());
 		return false;
 	}
 	const aiMesh* mesh = scene->mMeshes[0]; // In this simple example code we always use the 1rst mesh (in OBJ files there is often only one anyway)
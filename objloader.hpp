@@ -8,6 +8,25 @@ bool loadOBJ(
 	std::vector<glm::vec3> & out_normals
 );
 
+// Wie oben, fasst aber gleiche Eckpunkte zusammen und liefert dazu einen Indexbuffer,
+// dessen Dreiecke fuer den Vertex-Cache der GPU sortiert sind (siehe vboindexer.hpp).
+bool loadOBJ(
+	const char * path, 
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices, 
+	std::vector<glm::vec2> & out_uvs, 
+	std::vector<glm::vec3> & out_normals
+);
+
+// Der urspruengliche fscanf-basierte Loader. Liefert dasselbe Ergebnis wie loadOBJ,
+// wird aber nur noch zum Vergleich (siehe benchmark.cpp) verwendet.
+bool loadOBJReference(
+	const char * path, 
+	std::vector<glm::vec3> & out_vertices, 
+	std::vector<glm::vec2> & out_uvs, 
+	std::vector<glm::vec3> & out_normals
+);
+
 bool loadAssImp(
 	const char * path, 
 	std::vector<unsigned short> & indices,
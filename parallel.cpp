@@ -0,0 +1,142 @@
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "parallel.hpp"
+
+namespace {
+
+// Ein Aufruf von parallelFor
+struct ParallelJob
+{
+	const std::function<void(size_t, size_t)>* body;
+	size_t remaining; // noch nicht fertige Stuecke, nur unter dem Mutex des Pools
+};
+
+struct ParallelTask
+{
+	ParallelJob* job;
+	size_t first;
+	size_t last;
+};
+
+// Threads, die bis zum Programmende bleiben. Vorher startete jeder Aufruf threadCount - 1 neue
+// std::threads, die Simulation also in jedem Schritt.
+class ParallelPool
+{
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeWorkers;
+	std::condition_variable jobDone;
+	std::deque<ParallelTask> tasks;
+	bool stopping;
+
+	void workerLoop();
+	void runTask(const ParallelTask& task, std::unique_lock<std::mutex>& lock);
+
+	ParallelPool(const ParallelPool&);            // nicht kopierbar
+	ParallelPool& operator=(const ParallelPool&);
+
+public:
+	ParallelPool();
+	~ParallelPool();
+
+	void run(size_t count, size_t threadCount, const std::function<void(size_t, size_t)>& body);
+};
+
+ParallelPool::ParallelPool()
+	: stopping(false)
+{
+	// Der Aufrufer rechnet immer mit, ein Kern bleibt fuer ihn
+	unsigned int hardware = std::thread::hardware_concurrency();
+	for (unsigned int i = 1; i < hardware; i++)
+		workers.push_back(std::thread(&ParallelPool::workerLoop, this));
+}
+
+ParallelPool::~ParallelPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeWorkers.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+// Wird mit gesperrtem Mutex aufgerufen und gibt ihn fuer die Rechnung frei
+void ParallelPool::runTask(const ParallelTask& task, std::unique_lock<std::mutex>& lock)
+{
+	lock.unlock();
+	(*task.job->body)(task.first, task.last);
+	lock.lock();
+	if (--task.job->remaining == 0)
+		jobDone.notify_all();
+}
+
+void ParallelPool::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		while (tasks.empty() && !stopping)
+			wakeWorkers.wait(lock);
+		if (tasks.empty())
+			return;
+
+		ParallelTask task = tasks.front();
+		tasks.pop_front();
+		runTask(task, lock);
+	}
+}
+
+void ParallelPool::run(size_t count, size_t threadCount, const std::function<void(size_t, size_t)>& body)
+{
+	ParallelJob job = { &body, threadCount - 1 };
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t t = 1; t < threadCount; t++)
+		{
+			ParallelTask task = { &job, count * t / threadCount, count * (t + 1) / threadCount };
+			tasks.push_back(task);
+		}
+	}
+	wakeWorkers.notify_all();
+
+	body((size_t)0, count / threadCount);
+
+	// Beim Warten selbst Stuecke abarbeiten (auch anderer Aufrufe): so geht es ohne Worker,
+	// und ein parallelFor aus einem body heraus kann den Pool nicht blockieren
+	std::unique_lock<std::mutex> lock(mutex);
+	while (job.remaining > 0)
+	{
+		if (tasks.empty())
+		{
+			jobDone.wait(lock);
+			continue;
+		}
+		ParallelTask task = tasks.front();
+		tasks.pop_front();
+		runTask(task, lock);
+	}
+}
+
+ParallelPool& parallelPool()
+{
+	static ParallelPool pool;
+	return pool;
+}
+
+} // namespace
+
+void parallelFor(size_t count, size_t threadCount, const std::function<void(size_t, size_t)>& body)
+{
+	if (threadCount <= 1 || count < threadCount)
+	{
+		body((size_t)0, count);
+		return;
+	}
+	parallelPool().run(count, threadCount, body);
+}
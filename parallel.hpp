@@ -0,0 +1,14 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <stddef.h>
+#include <functional>
+
+// Teilt [0, count) in threadCount gleich grosse Stuecke und fuehrt body(first, last) fuer alle
+// parallel aus, das erste im aufrufenden Thread. Kehrt zurueck, wenn alle fertig sind.
+// Mit threadCount <= 1 oder weniger Elementen als Threads laeuft alles im aufrufenden Thread.
+// Die anderen Stuecke rechnet ein Pool aus hardware_concurrency - 1 Threads, der beim ersten
+// Aufruf entsteht und bleibt; es duerfen mehrere Threads gleichzeitig parallelFor aufrufen.
+void parallelFor(size_t count, size_t threadCount, const std::function<void(size_t, size_t)>& body);
+
+#endif
@@ -0,0 +1,281 @@
+#include <math.h>
+#include <string.h>
+#include <thread>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include "pheromone.hpp"
+#include "colony.hpp"
+#include "parallel.hpp"
+
+// Wie in frustum.cpp: SSE2 ist bei x64 immer und bei MSVC x86 mit /arch:SSE2 (Standard) da
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PHEROMONE_SSE2
+#include <emmintrin.h>
+#endif
+
+PheromoneField::PheromoneField(int size, float halfSize, float diffusion, float evaporation)
+	: size((size + TILE - 1) / TILE * TILE), halfSize(halfSize), diffusion(diffusion), evaporation(evaporation),
+	threshold(1e-3f), current(0), textureName(0)
+{
+	tiles = this->size / TILE;
+	size_t cellCount = (size_t)this->size * this->size;
+	for (int c = 0; c < PHEROMONE_CHANNELS; c++)
+	{
+		cells[c][0].assign(cellCount, 0.0f);
+		cells[c][1].assign(cellCount, 0.0f);
+	}
+	tileEmpty[0].assign(tiles * tiles, 1);
+	tileEmpty[1].assign(tiles * tiles, 1);
+	tileChanged.assign(tiles * tiles, 0);
+
+	// Die Textur braucht einmal den ganzen (leeren) Inhalt
+	uploadImage.assign(cellCount * 2, 0.0f);
+	uploadDirty.assign(tiles * tiles, 1);
+
+	// Kleine Felder lohnen keine Threads
+	unsigned int hardware = std::thread::hardware_concurrency();
+	threadCount = cellCount >= 512 * 512 && hardware ? hardware : 1;
+}
+
+int PheromoneField::cellIndex(float x, float y) const
+{
+	float scale = size / (2.0f * halfSize);
+	int cx = (int)floorf((x + halfSize) * scale) % size;
+	int cy = (int)floorf((y + halfSize) * scale) % size;
+	if (cx < 0)
+		cx += size;
+	if (cy < 0)
+		cy += size;
+	return cy * size + cx;
+}
+
+void PheromoneField::deposit(PheromoneChannel channel, const float* x, const float* y, size_t count, float amount)
+{
+	std::vector<float>& target = cells[channel][current];
+	for (size_t i = 0; i < count; i++)
+	{
+		int cell = cellIndex(x[i], y[i]);
+		target[cell] += amount;
+		int tile = (cell / size / TILE) * tiles + (cell % size) / TILE;
+		tileEmpty[current][tile] = 0;
+		tileChanged[tile] = 1;
+	}
+}
+
+void PheromoneField::deposit(const Colony& colony, float amount)
+{
+	for (size_t i = 0; i < colony.size(); i++)
+	{
+		PheromoneChannel channel = colony.state[i] == ANT_RETURNING ? PHEROMONE_TO_FOOD : PHEROMONE_TO_HOME;
+		deposit(channel, &colony.x[i], &colony.y[i], 1, amount);
+	}
+}
+
+void PheromoneField::sample(PheromoneChannel channel, const float* x, const float* y, size_t count, float* values) const
+{
+	const std::vector<float>& source = cells[channel][current];
+	for (size_t i = 0; i < count; i++)
+		values[i] = source[cellIndex(x[i], y[i])];
+}
+
+void PheromoneField::fill(PheromoneChannel channel, const std::vector<float>& values)
+{
+	std::copy(values.begin(), values.begin() + std::min(values.size(), cells[channel][current].size()),
+		cells[channel][current].begin());
+	for (int t = 0; t < tiles * tiles; t++)
+	{
+		tileEmpty[current][t] = 0;
+		tileChanged[t] = 1;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Stencil-Kernel
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Eine Zeile einer Kachel, [x0, x1). up/down sind die Nachbarzeilen (schon umgebrochen).
+// neu = (center * c + k * ((links + rechts) + (oben + unten))) * decay, unter threshold 0.
+// Gibt zurueck, ob ein Wert ungleich 0 geschrieben wurde.
+static bool diffuseRow(const float* up, const float* row, const float* down, float* out, int size, int x0, int x1,
+	float k, float center, float decay, float threshold, bool simd)
+{
+	bool nonzero = false;
+	int x = x0;
+
+#ifdef PHEROMONE_SSE2
+	if (simd)
+	{
+		// Die Randspalten brechen um und bleiben skalar
+		int first = std::max(x0, 1);
+		int last = std::min(x1, size - 1);
+		for (; x < first; x++)
+		{
+			float v = (center * row[x] + k * ((row[size - 1] + row[x + 1]) + (up[x] + down[x]))) * decay;
+			v = v >= threshold ? v : 0.0f;
+			out[x] = v;
+			nonzero = nonzero || v != 0.0f;
+		}
+
+		const __m128 vK = _mm_set1_ps(k);
+		const __m128 vCenter = _mm_set1_ps(center);
+		const __m128 vDecay = _mm_set1_ps(decay);
+		const __m128 vThreshold = _mm_set1_ps(threshold);
+		__m128 any = _mm_setzero_ps();
+		for (; x + 4 <= last; x += 4)
+		{
+			__m128 sides = _mm_add_ps(_mm_loadu_ps(row + x - 1), _mm_loadu_ps(row + x + 1));
+			__m128 vertical = _mm_add_ps(_mm_loadu_ps(up + x), _mm_loadu_ps(down + x));
+			__m128 v = _mm_add_ps(_mm_mul_ps(vCenter, _mm_loadu_ps(row + x)), _mm_mul_ps(vK, _mm_add_ps(sides, vertical)));
+			v = _mm_mul_ps(v, vDecay);
+			__m128 keep = _mm_cmpge_ps(v, vThreshold);
+			v = _mm_and_ps(v, keep);
+			any = _mm_or_ps(any, keep);
+			_mm_storeu_ps(out + x, v);
+		}
+		nonzero = nonzero || _mm_movemask_ps(any) != 0;
+	}
+#else
+	(void)simd;
+#endif
+
+	for (; x < x1; x++)
+	{
+		int left = x == 0 ? size - 1 : x - 1;
+		int right = x == size - 1 ? 0 : x + 1;
+		float v = (center * row[x] + k * ((row[left] + row[right]) + (up[x] + down[x]))) * decay;
+		v = v >= threshold ? v : 0.0f;
+		out[x] = v;
+		nonzero = nonzero || v != 0.0f;
+	}
+	return nonzero;
+}
+
+void PheromoneField::updateTiles(size_t first, size_t last, float k, float decay, bool simd)
+{
+	int source = current;
+	int target = 1 - current;
+	float center = 1.0f - 4.0f * k;
+
+	for (size_t t = first; t < last; t++)
+	{
+		int ty = (int)t / tiles;
+		int tx = (int)t % tiles;
+
+		// Leer bleibt leer, wenn auch alle Nachbarn leer sind und das Ziel schon leer ist
+		int up = (ty + tiles - 1) % tiles, down = (ty + 1) % tiles;
+		int left = (tx + tiles - 1) % tiles, right = (tx + 1) % tiles;
+		if (tileEmpty[source][t] && tileEmpty[source][up * tiles + tx] && tileEmpty[source][down * tiles + tx] &&
+			tileEmpty[source][ty * tiles + left] && tileEmpty[source][ty * tiles + right] && tileEmpty[target][t])
+			continue;
+
+		bool nonzero = false;
+		for (int c = 0; c < PHEROMONE_CHANNELS; c++)
+		{
+			const float* src = &cells[c][source][0];
+			float* dst = &cells[c][target][0];
+			for (int y = ty * TILE; y < (ty + 1) * TILE; y++)
+			{
+				const float* rowUp = src + (size_t)((y + size - 1) % size) * size;
+				const float* row = src + (size_t)y * size;
+				const float* rowDown = src + (size_t)((y + 1) % size) * size;
+				if (diffuseRow(rowUp, row, rowDown, dst + (size_t)y * size, size, tx * TILE, (tx + 1) * TILE,
+					k, center, decay, threshold, simd))
+					nonzero = true;
+			}
+		}
+
+		// Eine Kachel, die leer war und leer bleibt, muss nicht hochgeladen werden
+		if (nonzero || !tileEmpty[source][t])
+			tileChanged[t] = 1;
+		tileEmpty[target][t] = nonzero ? 0 : 1;
+	}
+}
+
+void PheromoneField::update(float dt, bool simd)
+{
+	float k = std::min(diffusion * dt, 0.2f); // ueber 0.25 wuerde der Stencil instabil
+	float decay = expf(-evaporation * dt);
+
+	parallelFor(tiles * tiles, threadCount, [&](size_t first, size_t last)
+	{
+		updateTiles(first, last, k, decay, simd);
+	});
+	current = 1 - current;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Textur
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PheromoneField::publish()
+{
+	std::lock_guard<std::mutex> lock(uploadMutex);
+	const float* food = &cells[PHEROMONE_TO_FOOD][current][0];
+	const float* home = &cells[PHEROMONE_TO_HOME][current][0];
+	for (int t = 0; t < tiles * tiles; t++)
+	{
+		if (!tileChanged[t])
+			continue;
+		int ty = t / tiles, tx = t % tiles;
+		for (int y = ty * TILE; y < (ty + 1) * TILE; y++)
+		{
+			size_t cell = (size_t)y * size + tx * TILE;
+			float* out = &uploadImage[cell * 2];
+			for (int x = 0; x < TILE; x++)
+			{
+				out[2 * x] = food[cell + x];
+				out[2 * x + 1] = home[cell + x];
+			}
+		}
+		uploadDirty[t] = 1;
+		tileChanged[t] = 0;
+	}
+}
+
+void PheromoneField::createTexture()
+{
+	glGenTextures(1, &textureName);
+	glBindTexture(GL_TEXTURE_2D, textureName);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, size, size, 0, GL_RG, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // Torus wie die Welt
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+}
+
+unsigned int PheromoneField::uploadDirtyTiles()
+{
+	if (!textureName)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(uploadMutex);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, textureName);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, size); // direkt aus dem ganzen Abbild, ohne umzukopieren
+
+	unsigned int uploaded = 0;
+	for (int t = 0; t < tiles * tiles; t++)
+	{
+		if (!uploadDirty[t])
+			continue;
+		int ty = t / tiles, tx = t % tiles;
+		glTexSubImage2D(GL_TEXTURE_2D, 0, tx * TILE, ty * TILE, TILE, TILE, GL_RG, GL_FLOAT,
+			&uploadImage[((size_t)ty * TILE * size + tx * TILE) * 2]);
+		uploadDirty[t] = 0;
+		uploaded++;
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	return uploaded;
+}
+
+void PheromoneField::destroyTexture()
+{
+	if (textureName)
+		glDeleteTextures(1, &textureName);
+	textureName = 0;
+}
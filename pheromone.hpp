@@ -0,0 +1,95 @@
+#ifndef PHEROMONE_HPP
+#define PHEROMONE_HPP
+
+#include <mutex>
+#include <vector>
+
+#include <GL/glew.h>
+
+class Colony;
+
+enum PheromoneChannel
+{
+	PHEROMONE_TO_FOOD = 0, // legen Ameisen, die Futter tragen
+	PHEROMONE_TO_HOME = 1, // legen Ameisen auf der Suche
+	PHEROMONE_CHANNELS
+};
+
+// Duftspuren auf einem quadratischen Gitter ueber der Welt [-halfSize, halfSize]^2, ein Feld
+// pro Kanal. Die Raender sind verbunden wie bei der Kolonie (Torus).
+// Ein Schritt (update) laesst die Spuren zerfliessen (5-Punkte-Stencil) und verdunsten.
+// Gerechnet wird in Kacheln zu TILE x TILE Zellen, die im L1/L2 bleiben, mit SSE2 und
+// verteilt auf alle Kerne. Kacheln, die samt Nachbarn leer sind, werden uebersprungen.
+//
+// Die Simulation rechnet, der GL-Thread zeichnet: publish() kopiert die geaenderten Kacheln
+// (unter einem Mutex) in ein RG-Abbild, uploadDirtyTiles() laedt nur diese mit glTexSubImage2D
+// in eine RG16F-Textur, die als Bodenplatte mit dem normalen Shader gezeichnet wird
+// (rot: Spur zum Futter, gruen: Spur nach Hause).
+class PheromoneField
+{
+public:
+	enum { TILE = 64 };
+
+private:
+	int size;       // Zellen pro Seite, Vielfaches von TILE
+	int tiles;      // Kacheln pro Seite
+	float halfSize;
+	float diffusion;   // Anteil pro Sekunde, der an die 4 Nachbarn fliesst
+	float evaporation; // Zerfall pro Sekunde (exponentiell)
+	float threshold;   // kleinere Werte werden 0, damit Kacheln wieder leer werden
+
+	// Zwei Puffer pro Kanal, current zeigt auf den aktuellen
+	std::vector<float> cells[PHEROMONE_CHANNELS][2];
+	int current;
+	std::vector<unsigned char> tileEmpty[2]; // alle Kanaele der Kachel sind 0, pro Puffer
+	std::vector<unsigned char> tileChanged;  // seit dem letzten publish()
+
+	// Geteilt mit dem GL-Thread
+	std::mutex uploadMutex;
+	std::vector<float> uploadImage; // RG, size x size
+	std::vector<unsigned char> uploadDirty;
+	GLuint textureName;
+
+	size_t threadCount;
+
+	void updateTiles(size_t first, size_t last, float k, float decay, bool simd);
+
+	PheromoneField(const PheromoneField&);            // nicht kopierbar
+	PheromoneField& operator=(const PheromoneField&);
+
+public:
+	PheromoneField(int size, float halfSize, float diffusion, float evaporation);
+
+	int cellsPerSide() const { return size; }
+	float worldHalfSize() const { return halfSize; }
+	int cellIndex(float x, float y) const; // Zelle unter der Weltposition
+
+	// Simulation ---------------------------------------------------------------------------
+
+	// Jede Ameise legt amount auf die Zelle unter sich: Suchende nach PHEROMONE_TO_HOME,
+	// Heimkehrende nach PHEROMONE_TO_FOOD
+	void deposit(const Colony& colony, float amount);
+	void deposit(PheromoneChannel channel, const float* x, const float* y, size_t count, float amount);
+	// Wert der Zelle unter jeder Position
+	void sample(PheromoneChannel channel, const float* x, const float* y, size_t count, float* values) const;
+
+	// Zerfliessen und Verdunsten. simd = false erzwingt den skalaren Kernel (Vergleich).
+	void update(float dt, bool simd = true);
+	void setThreadCount(size_t threads) { threadCount = threads ? threads : 1; }
+
+	const float* channel(PheromoneChannel channel) const { return &cells[channel][current][0]; }
+	void fill(PheromoneChannel channel, const std::vector<float>& values); // fuer den Benchmark
+
+	// Geaenderte Kacheln fuer den GL-Thread bereitlegen
+	void publish();
+
+	// GL-Thread ----------------------------------------------------------------------------
+
+	void createTexture();
+	// Laedt die seit dem letzten Aufruf veroeffentlichten Kacheln hoch, gibt ihre Anzahl zurueck
+	unsigned int uploadDirtyTiles();
+	GLuint texture() const { return textureName; }
+	void destroyTexture();
+};
+
+#endif
@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include "profiler.hpp"
+
+// Jeder Thread findet seinen Ring ohne Lock, angelegt wird er beim ersten Abschnitt
+static thread_local ProfileRing* currentRing = NULL;
+
+ProfileRing::ProfileRing(unsigned int capacity, unsigned int thread, const std::string& threadName)
+	: events(capacity), head(0), tail(0), thread(thread), threadName(threadName), dropped(0)
+{
+}
+
+bool ProfileRing::push(const ProfileEvent& event)
+{
+	unsigned int h = head.load(std::memory_order_relaxed);
+	if (h - tail.load(std::memory_order_acquire) == events.size())
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	events[h % events.size()] = event;
+	head.store(h + 1, std::memory_order_release); // erst jetzt sieht der Leser das Ereignis
+	return true;
+}
+
+bool ProfileRing::pop(ProfileEvent& event)
+{
+	unsigned int t = tail.load(std::memory_order_relaxed);
+	if (t == head.load(std::memory_order_acquire))
+		return false;
+	event = events[t % events.size()];
+	tail.store(t + 1, std::memory_order_release); // Platz wieder frei fuer den Besitzer
+	return true;
+}
+
+Profiler& profiler()
+{
+	static Profiler instance;
+	return instance;
+}
+
+Profiler::Profiler()
+	: origin(std::chrono::steady_clock::now()), glThread(std::this_thread::get_id()), timerQueries(false),
+	frame(0), gpuMissed(0), gpuDiscarded(0)
+{
+	for (int i = 0; i < GPU_LATENCY; i++)
+		gpuUsed[i] = 0;
+}
+
+void Profiler::create()
+{
+	glThread = std::this_thread::get_id();
+	timerQueries = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	if (!timerQueries)
+		printf("Profiler: no timer queries, measuring CPU time only\n");
+}
+
+void Profiler::destroy()
+{
+	for (int i = 0; i < GPU_LATENCY; i++)
+	{
+		for (size_t q = 0; q < gpuFrames[i].size(); q++)
+			glDeleteQueries(2, gpuFrames[i][q].queries);
+		gpuFrames[i].clear();
+		gpuUsed[i] = 0;
+	}
+	timerQueries = false;
+}
+
+double Profiler::now() const
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+}
+
+ProfileRing& Profiler::threadRing()
+{
+	if (!currentRing)
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		unsigned int thread = (unsigned int)rings.size();
+		char name[32];
+		if (std::this_thread::get_id() == glThread)
+			snprintf(name, sizeof(name), "GL thread");
+		else
+			snprintf(name, sizeof(name), "Worker %u", thread);
+		rings.push_back(std::unique_ptr<ProfileRing>(new ProfileRing(4096, thread, name)));
+		currentRing = rings.back().get();
+	}
+	return *currentRing;
+}
+
+void Profiler::begin(const char* name, bool gpu)
+{
+	ProfileRing& ring = threadRing();
+	ProfileRing::Open open = { name, 0.0, -1 };
+
+	// GL gibt es nur auf dem GL-Thread
+	if (gpu && timerQueries && std::this_thread::get_id() == glThread)
+	{
+		std::vector<GpuQuery>& queries = gpuFrames[frame % GPU_LATENCY];
+		size_t& used = gpuUsed[frame % GPU_LATENCY];
+		if (used == queries.size())
+		{
+			GpuQuery query = { { 0, 0 }, NULL, 0.0, 0 };
+			glGenQueries(2, query.queries);
+			queries.push_back(query);
+		}
+		open.gpuQuery = (int)used;
+		GpuQuery& query = queries[used++];
+		query.name = name;
+		query.frame = frame;
+		glQueryCounter(query.queries[0], GL_TIMESTAMP);
+	}
+
+	open.start = now();
+	ring.open.push_back(open);
+	if (open.gpuQuery >= 0)
+		gpuFrames[frame % GPU_LATENCY][open.gpuQuery].cpuStart = open.start;
+}
+
+void Profiler::end()
+{
+	ProfileRing& ring = threadRing();
+	if (ring.open.empty())
+		return;
+
+	ProfileRing::Open open = ring.open.back();
+	ring.open.pop_back();
+	ProfileEvent event = { open.name, open.start, now() - open.start, frame };
+	if (open.gpuQuery >= 0)
+		glQueryCounter(gpuFrames[frame % GPU_LATENCY][open.gpuQuery].queries[1], GL_TIMESTAMP);
+	ring.push(event);
+}
+
+// p-tes Perzentil eines sortierten, nicht leeren Fensters
+static float percentile(const std::vector<float>& sorted, size_t p)
+{
+	return sorted[(sorted.size() * p + 99) / 100 - 1];
+}
+
+const Profiler::Samples* Profiler::findSamples(const char* name) const
+{
+	std::map<std::string, size_t>::const_iterator found = sampleIndex.find(name);
+	return found == sampleIndex.end() ? NULL : &samples[found->second];
+}
+
+Profiler::Samples& Profiler::samplesFor(const char* name)
+{
+	std::map<std::string, size_t>::iterator found = sampleIndex.find(name);
+	if (found != sampleIndex.end())
+		return samples[found->second];
+
+	sampleIndex[name] = samples.size();
+	samples.push_back(Samples());
+	Samples& added = samples.back();
+	added.name = name;
+	added.nextCpu = added.nextGpu = 0;
+	return added;
+}
+
+void Profiler::record(const ProfileEvent& event, unsigned int thread, bool gpu)
+{
+	Samples& s = samplesFor(event.name);
+	std::vector<float>& window = gpu ? s.gpu : s.cpu;
+	size_t& next = gpu ? s.nextGpu : s.nextCpu;
+	float ms = (float)(event.duration / 1000.0);
+	if (window.size() < WINDOW)
+		window.push_back(ms);
+	else
+		window[next] = ms;
+	next = (next + 1) % WINDOW;
+
+	TraceEvent trace = { event, thread };
+	history.push_back(trace);
+	if (history.size() > HISTORY)
+		history.pop_front();
+}
+
+void Profiler::readGpuFrame(size_t slot)
+{
+	std::vector<GpuQuery>& queries = gpuFrames[slot];
+	size_t used = gpuUsed[slot];
+	gpuUsed[slot] = 0;
+	if (used == 0)
+		return;
+
+	double readback = now();
+	for (size_t i = 0; i < used; i++)
+	{
+		// Jeden Zeitstempel einzeln fragen: GL_QUERY_RESULT auf einem noch nicht fertigen wuerde
+		// auf die GPU warten
+		GLint available[2] = { 0, 0 };
+		glGetQueryObjectiv(queries[i].queries[0], GL_QUERY_RESULT_AVAILABLE, &available[0]);
+		glGetQueryObjectiv(queries[i].queries[1], GL_QUERY_RESULT_AVAILABLE, &available[1]);
+		if (!available[0] || !available[1])
+		{
+			gpuMissed++;
+			continue;
+		}
+
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(queries[i].queries[0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(queries[i].queries[1], GL_QUERY_RESULT, &end);
+
+		// Die GPU kann erst nach dem Einreichen anfangen und war vor dem Auslesen fertig
+		double duration = (double)(end - start) / 1000.0;
+		if (end < start || duration > readback - queries[i].cpuStart)
+		{
+			gpuDiscarded++;
+			continue;
+		}
+
+		// Die GPU-Spur beginnt beim Einreichen auf der CPU, die Dauer ist die der GPU
+		ProfileEvent event = { queries[i].name, queries[i].cpuStart, duration, queries[i].frame };
+		record(event, ~0u, true);
+	}
+}
+
+void Profiler::endFrame()
+{
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		for (size_t r = 0; r < rings.size(); r++)
+		{
+			ProfileEvent event;
+			while (rings[r]->pop(event))
+				record(event, rings[r]->thread, false);
+		}
+	}
+
+	// Der naechste Frame benutzt die Queries des aeltesten wieder, also jetzt auslesen
+	frame++;
+	if (timerQueries)
+		readGpuFrame(frame % GPU_LATENCY);
+}
+
+void Profiler::printStats() const
+{
+	unsigned int dropped = 0;
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		for (size_t r = 0; r < rings.size(); r++)
+			dropped += rings[r]->dropped.load(std::memory_order_relaxed);
+	}
+
+	printf("%-16s %27s %27s\n", "", "CPU p50/p95/p99 ms", "GPU p50/p95/p99 ms");
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		const Samples& s = samples[i];
+		char columns[2][32];
+		const std::vector<float>* windows[2] = { &s.cpu, &s.gpu };
+		for (int c = 0; c < 2; c++)
+		{
+			if (windows[c]->empty())
+			{
+				snprintf(columns[c], sizeof(columns[c]), "-");
+				continue;
+			}
+			std::vector<float> sorted(*windows[c]);
+			std::sort(sorted.begin(), sorted.end());
+			snprintf(columns[c], sizeof(columns[c]), "%.3f/%.3f/%.3f", sorted[(sorted.size() - 1) / 2],
+				percentile(sorted, 95), percentile(sorted, 99));
+		}
+		printf("%-16s %27s %27s\n", s.name.c_str(), columns[0], columns[1]);
+	}
+	if (dropped || gpuMissed || gpuDiscarded)
+		printf("Profiler: %u events dropped (ring full), %u GPU results not ready in time, %u impossible ones discarded\n",
+			dropped, gpuMissed, gpuDiscarded);
+}
+
+bool Profiler::checkGpuTimes(const char* frameName) const
+{
+	const Samples* frameSamples = findSamples(frameName);
+	if (!frameSamples || frameSamples->cpu.empty())
+		return true;
+	std::vector<float> sorted(frameSamples->cpu);
+	std::sort(sorted.begin(), sorted.end());
+	float frameP99 = percentile(sorted, 99);
+
+	bool ok = true;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		if (samples[i].gpu.empty())
+			continue;
+		sorted = samples[i].gpu;
+		std::sort(sorted.begin(), sorted.end());
+		float gpuP99 = percentile(sorted, 99);
+		if (gpuP99 > frameP99)
+		{
+			printf("Profiler check failed: %s GPU p99 %.3f ms is longer than %s p99 %.3f ms\n",
+				samples[i].name.c_str(), gpuP99, frameName, frameP99);
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+bool Profiler::writeTrace(const char* path) const
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		printf("Impossible to open %s for writing\n", path);
+		return false;
+	}
+
+	// "X" = vollstaendiges Ereignis mit Dauer, "M" = Name einer Spur
+	fprintf(file, "{\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}");
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		for (size_t r = 0; r < rings.size(); r++)
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				rings[r]->thread + 1, rings[r]->threadName.c_str());
+	}
+	for (size_t i = 0; i < history.size(); i++)
+	{
+		const TraceEvent& trace = history[i];
+		fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+			trace.event.name, trace.thread + 1, trace.event.start, trace.event.duration, trace.event.frame);
+	}
+	fprintf(file, "\n]}\n");
+
+	bool ok = !ferror(file);
+	fclose(file);
+	printf("Wrote %u trace events to %s\n", (unsigned int)history.size(), path);
+	return ok;
+}
@@ -0,0 +1,149 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Ein abgeschlossener Abschnitt. Zeiten in Mikrosekunden seit dem Start des Profilers.
+struct ProfileEvent
+{
+	const char* name; // Stringliteral, wird nicht kopiert
+	double start;
+	double duration;
+	unsigned int frame;
+};
+
+// Ring fuer genau einen schreibenden Thread (den Besitzer) und einen lesenden (den GL-Thread
+// in Profiler::endFrame). Beide Seiten kommen ohne Lock aus, ist der Ring voll, geht das
+// Ereignis verloren und wird gezaehlt.
+class ProfileRing
+{
+	std::vector<ProfileEvent> events;
+	std::atomic<unsigned int> head; // naechster Schreibplatz, schreibt nur der Besitzer
+	std::atomic<unsigned int> tail; // naechster Leseplatz, schreibt nur der Leser
+
+public:
+	struct Open
+	{
+		const char* name;
+		double start;
+		int gpuQuery; // Index in den GPU-Queries des Frames, -1 ohne
+	};
+
+	unsigned int thread;             // Nummer in der Trace-Datei
+	std::string threadName;
+	std::atomic<unsigned int> dropped;
+	std::vector<Open> open;          // offene Abschnitte, nur der Besitzer
+
+	ProfileRing(unsigned int capacity, unsigned int thread, const std::string& threadName);
+
+	bool push(const ProfileEvent& event); // Besitzer
+	bool pop(ProfileEvent& event);        // Leser
+};
+
+// Zeitmessung fuer benannte Abschnitte eines Frames (Eingabe, Simulation, Zeichnen, ...).
+// Jeder Abschnitt misst die CPU-Zeit, auf dem GL-Thread auf Wunsch auch die GPU-Zeit ueber
+// ein Paar GL_TIMESTAMP-Queries (glQueryCounter) am Anfang und am Ende, die sich auch verschachteln
+// lassen. Deren Ergebnis wird erst GPU_LATENCY - 1 Frames spaeter gelesen, und nur, wenn beide
+// Zeitstempel schon da sind; niemand wartet auf die GPU. Was nicht stimmen kann (Ende vor dem
+// Anfang, laenger als vom Einreichen bis zum Auslesen), wird verworfen und gezaehlt.
+// Ausgabe als gleitende Perzentile ueber die letzten Frames (printStats) oder als Trace-Datei
+// im Chrome-Format (writeTrace, ansehen mit chrome://tracing oder ui.perfetto.dev).
+class Profiler
+{
+	enum { GPU_LATENCY = 4, WINDOW = 128, HISTORY = 32768 };
+
+	struct GpuQuery
+	{
+		GLuint queries[2]; // Zeitstempel am Anfang und am Ende
+		const char* name;
+		double cpuStart;
+		unsigned int frame;
+	};
+
+	struct Samples
+	{
+		std::string name;
+		std::vector<float> cpu, gpu; // Millisekunden, Ringe mit WINDOW Eintraegen
+		size_t nextCpu, nextGpu;
+	};
+
+	struct TraceEvent
+	{
+		ProfileEvent event;
+		unsigned int thread; // GPU bekommt eine eigene Spur
+	};
+
+	std::chrono::steady_clock::time_point origin;
+	std::thread::id glThread;
+	bool timerQueries; // GL_TIMESTAMP verfuegbar, erst nach create()
+
+	mutable std::mutex ringMutex; // beim ersten Abschnitt eines Threads und beim Einsammeln
+	std::vector<std::unique_ptr<ProfileRing> > rings;
+
+	std::vector<GpuQuery> gpuFrames[GPU_LATENCY];
+	size_t gpuUsed[GPU_LATENCY];
+	unsigned int frame;
+	unsigned int gpuMissed;    // Abschnitte, die nach GPU_LATENCY Frames noch kein Ergebnis hatten
+	unsigned int gpuDiscarded; // Abschnitte mit unmoeglicher Dauer
+
+	std::vector<Samples> samples;
+	std::map<std::string, size_t> sampleIndex;
+	std::deque<TraceEvent> history;
+
+	ProfileRing& threadRing();
+	Samples& samplesFor(const char* name);
+	const Samples* findSamples(const char* name) const;
+	void record(const ProfileEvent& event, unsigned int thread, bool gpu);
+	void readGpuFrame(size_t slot);
+
+	Profiler(const Profiler&);            // nicht kopierbar
+	Profiler& operator=(const Profiler&);
+
+public:
+	Profiler();
+
+	void create(); // nach glewInit auf dem GL-Thread
+	void destroy();
+
+	// Abschnitte duerfen verschachtelt werden, end() schliesst den zuletzt geoeffneten.
+	// name muss ein Stringliteral sein. gpu gilt nur auf dem GL-Thread.
+	void begin(const char* name, bool gpu = false);
+	void end();
+
+	// Einmal pro Frame auf dem GL-Thread: sammelt die Ringe aller Threads ein und liest die
+	// GPU-Zeiten von vor GPU_LATENCY - 1 Frames
+	void endFrame();
+
+	double now() const; // Mikrosekunden
+
+	// p50/p95/p99 pro Abschnitt ueber die letzten WINDOW Messungen
+	void printStats() const;
+	// Prueft, dass kein Abschnitt auf der GPU im p99 laenger dauert als frameName auf der CPU.
+	// Gibt false zurueck und nennt die Abschnitte, sonst true (auch ohne GPU-Zeiten).
+	bool checkGpuTimes(const char* frameName) const;
+	// Die gesammelten Ereignisse (hoechstens HISTORY) als Chrome-Trace-JSON
+	bool writeTrace(const char* path) const;
+};
+
+Profiler& profiler();
+
+// Misst den umschliessenden Block
+class ProfileScope
+{
+	ProfileScope(const ProfileScope&);
+	ProfileScope& operator=(const ProfileScope&);
+
+public:
+	explicit ProfileScope(const char* name, bool gpu = false) { profiler().begin(name, gpu); }
+	~ProfileScope() { profiler().end(); }
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "renderqueue.hpp"
+#include "shader.hpp"
+#include "indirect.hpp"
+#include "profiler.hpp"
+
+// Aufteilung des Schluessels, von oben nach unten:
+// 8 Bit Programm, 16 Bit VAO, 16 Bit Textur, 24 Bit Tiefe.
+// Die OpenGL-Namen werden abgeschnitten; eine Kollision sortiert nur schlechter,
+// zusammengefasst wird nur bei wirklich gleichem Zustand.
+static unsigned long long makeKey(GLuint program, GLuint vertexArray, GLuint texture, unsigned int depth)
+{
+	return ((unsigned long long)(program & 0xFF) << 56) |
+		((unsigned long long)(vertexArray & 0xFFFF) << 40) |
+		((unsigned long long)(texture & 0xFFFF) << 24) |
+		(unsigned long long)(depth & 0xFFFFFF);
+}
+
+RenderQueue::RenderQueue()
+	: view(1.0f), farPlane(100.0f), pixelsPerUnit(360.0f), levelOfDetail(true),
+	indirect(NULL), indirectReplaces(NULL), indirectTriangles(0)
+{
+	lastStats.submitted = 0;
+	lastStats.culled = 0;
+	lastStats.issued = 0;
+	lastStats.triangles = 0;
+}
+
+void RenderQueue::begin(const glm::mat4& View, const glm::mat4& Projection, float far, int viewportHeight)
+{
+	clear();
+	frustum = extractFrustum(Projection * View);
+	view = View;
+	farPlane = far;
+	// Projection[1][1] = 1 / tan(fovy / 2): so viele halbe Bildhoehen ist eine Einheit in Entfernung 1
+	pixelsPerUnit = Projection[1][1] * viewportHeight * 0.5f;
+}
+
+void RenderQueue::submit(Drawable* mesh, ShaderProgram* program, GLuint texture, const glm::mat4& model)
+{
+	BoundingSphere sphere = transformSphere(mesh->boundingSphere(), model);
+
+	// Abstand des Objektursprungs vor der Kamera (die Kamera schaut entlang -z)
+	float distance = -(view * model[3]).z;
+	float depth = glm::clamp(distance / farPlane, 0.0f, 1.0f);
+
+	// Detailstufe nach der Groesse der Kugel auf dem Bildschirm; was die Kamera beruehrt, bleibt fein
+	if (levelOfDetail)
+	{
+		float sphereDistance = -(view * glm::vec4(sphere.center, 1.0f)).z;
+		if (sphereDistance > sphere.radius)
+			mesh = mesh->levelOfDetail(sphere.radius * pixelsPerUnit / sphereDistance);
+	}
+
+	// Liegt das Mesh in der Arena, kuemmert sich die GPU um Verwerfen und Zeichnen
+	int arenaMesh = indirect && program == indirectReplaces ? mesh->arenaMesh() : -1;
+	if (arenaMesh >= 0)
+	{
+		indirect->add(arenaMesh, texture, model);
+		indirectTriangles += mesh->triangleCount();
+		return;
+	}
+
+	Item item;
+	item.key = makeKey(program->id(), mesh->vertexArray(), texture, (unsigned int)(depth * 0xFFFFFF));
+	item.sequence = (unsigned int)items.size();
+	item.mesh = mesh;
+	item.program = program;
+	item.texture = texture;
+	item.model = model;
+	items.push_back(item);
+
+	sphereX.push_back(sphere.center.x);
+	sphereY.push_back(sphere.center.y);
+	sphereZ.push_back(sphere.center.z);
+	sphereRadius.push_back(sphere.radius);
+}
+
+void RenderQueue::flush()
+{
+	lastStats.submitted = (unsigned int)items.size();
+	lastStats.culled = 0;
+	lastStats.issued = 0;
+	lastStats.triangles = 0;
+
+	// Zuerst die Arena, die Schleife unten bindet ihre Texturen danach selbst
+	if (indirect && indirect->size())
+	{
+		ProfileScope scope("draw indirect", true);
+		lastStats.submitted += (unsigned int)indirect->size();
+		lastStats.issued += indirect->draw(frustum);
+		lastStats.triangles += indirectTriangles;
+	}
+
+	// Alle Kugeln auf einmal testen, was danach noch drin ist, genauer mit der Box;
+	// die sichtbaren Eintraege nach vorne schieben
+	if (!items.empty())
+	{
+		ProfileScope scope("cull");
+		visible.resize(items.size());
+		cullSpheres(frustum, &sphereX[0], &sphereY[0], &sphereZ[0], &sphereRadius[0], items.size(), &visible[0]);
+
+		size_t kept = 0;
+		for (size_t i = 0; i < items.size(); i++)
+			if (visible[i] && boxVisible(frustum, items[i].mesh->boundingBox(), items[i].model))
+				items[kept++] = items[i];
+		lastStats.culled = (unsigned int)(items.size() - kept);
+		items.resize(kept);
+	}
+
+	profiler().begin("sort");
+	std::sort(items.begin(), items.end());
+	profiler().end();
+
+	ProfileScope scope("draw batches", true);
+
+	GLuint boundTexture = 0;
+	bool textureBound = false;
+	size_t first = 0;
+	while (first < items.size())
+	{
+		// Gleicher Zustand direkt hintereinander -> eine Instanz mehr im selben Aufruf
+		const Item& head = items[first];
+		size_t last = first + 1;
+		while (last < items.size() && items[last].mesh == head.mesh && items[last].program == head.program &&
+			items[last].texture == head.texture)
+			last++;
+
+		batch.clear();
+		for (size_t i = first; i < last; i++)
+			batch.push_back(items[i].model);
+
+		head.program->use();
+		if (!textureBound || head.texture != boundTexture)
+		{
+			glBindTexture(GL_TEXTURE_2D, head.texture);
+			boundTexture = head.texture;
+			textureBound = true;
+		}
+		head.mesh->drawInstanced(&batch[0], (GLsizei)batch.size());
+		lastStats.issued++;
+		lastStats.triangles += head.mesh->triangleCount() * (unsigned int)batch.size();
+
+		first = last;
+	}
+
+	clear();
+}
+
+void RenderQueue::clear()
+{
+	items.clear();
+	sphereX.clear();
+	sphereY.clear();
+	sphereZ.clear();
+	sphereRadius.clear();
+	indirectTriangles = 0;
+}
@@ -0,0 +1,114 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+
+class ShaderProgram;
+class IndirectRenderer;
+
+// Alles, was die Render-Queue zeichnen kann (Obj3D, Kugel). Gezeichnet wird immer
+// instanziert, eine einzelne Zeichnung ist eine Instanz.
+class Drawable
+{
+public:
+	virtual ~Drawable() {}
+	virtual GLuint vertexArray() = 0; // fuer den Sortierschluessel
+	virtual void drawInstanced(const glm::mat4* models, GLsizei count) = 0;
+	virtual BoundingBox boundingBox() = 0;       // in Modellkoordinaten, zweite Stufe beim Culling
+	virtual BoundingSphere boundingSphere() = 0; // fuers Frustum-Culling
+	virtual unsigned int triangleCount() = 0;    // pro Instanz, fuer die Statistik
+	// Was stattdessen gezeichnet werden soll, wenn die Bounding-Kugel pixelRadius Pixel gross
+	// auf dem Bildschirm erscheint (z. B. eine groebere Kugel). Standard: immer dasselbe.
+	virtual Drawable* levelOfDetail(float pixelRadius) { (void)pixelRadius; return this; }
+	// Nummer in der MeshArena oder -1, wenn das Mesh nur eigene Buffer hat
+	virtual int arenaMesh() { return -1; }
+};
+
+// Zaehler fuer den letzten Frame
+struct RenderStats
+{
+	unsigned int submitted; // submit()-Aufrufe
+	unsigned int culled;    // davon ausserhalb des Sichtvolumens, nicht gezeichnet (nur auf der CPU verworfene)
+	unsigned int issued;    // tatsaechliche Draw-Aufrufe nach dem Zusammenfassen
+	unsigned int triangles; // gezeichnete Dreiecke, nach dem Verwerfen und der Detailstufe
+	                        // (was die GPU selbst verwirft, ist hier noch mitgezaehlt)
+};
+
+// Sammelt die Zeichnungen eines Frames, sortiert sie nach einem 64-Bit-Schluessel
+// (Programm, VAO, Textur, Tiefe) und fasst aufeinanderfolgende Zeichnungen desselben
+// Meshes mit demselben Programm und derselben Textur zu einem instanzierten Aufruf zusammen.
+// Alle Objekte gelten als undurchsichtig und werden innerhalb einer Gruppe von vorne
+// nach hinten gezeichnet, damit der Z-Test moeglichst frueh verwirft.
+// Vorher werden alle Objekte mit ihrer umschliessenden Kugel gegen das Sichtvolumen getestet,
+// was die Kugel nicht verwirft, noch einmal mit der Box.
+// Beim Einreichen waehlt jedes Objekt nach seiner Groesse auf dem Bildschirm seine Detailstufe.
+// Die Programme muessen die Model-Matrix als Instanz-Attribut lesen (location 3 bis 6).
+// Mit setIndirect gehen Meshes aus der MeshArena stattdessen an den IndirectRenderer,
+// der sie auf der GPU verwirft und mit einem Aufruf pro Textur zeichnet.
+class RenderQueue
+{
+	struct Item
+	{
+		unsigned long long key;
+		unsigned int sequence; // Reihenfolge beim Einreichen, falls die Schluessel gleich sind
+		Drawable* mesh;
+		ShaderProgram* program;
+		GLuint texture;
+		glm::mat4 model;
+
+		bool operator<(const Item& other) const
+		{
+			return key != other.key ? key < other.key : sequence < other.sequence;
+		}
+	};
+
+	std::vector<Item> items;          // behalten ihren Speicher ueber die Frames
+	std::vector<glm::mat4> batch;
+
+	// Kugeln in Weltkoordinaten, getrennt nach Komponenten fuer cullSpheres
+	std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+	std::vector<unsigned char> visible;
+	Frustum frustum;
+
+	glm::mat4 view;
+	float farPlane;
+	float pixelsPerUnit; // Bildschirmhoehe in Pixeln / Hoehe des Sichtvolumens in Entfernung 1
+	bool levelOfDetail;
+	RenderStats lastStats;
+
+	IndirectRenderer* indirect;
+	ShaderProgram* indirectReplaces;
+	unsigned int indirectTriangles;
+
+	void clear();
+
+public:
+	RenderQueue();
+
+	// Beginnt einen Frame. Die Tiefe wird entlang der Blickrichtung der Kamera gemessen,
+	// farPlane ist die Entfernung, auf die der Tiefenanteil des Schluessels skaliert wird.
+	// viewportHeight in Pixeln, fuer die Detailstufen.
+	void begin(const glm::mat4& View, const glm::mat4& Projection, float farPlane, int viewportHeight);
+	void submit(Drawable* mesh, ShaderProgram* program, GLuint texture, const glm::mat4& model);
+	// Verwirft Unsichtbares, sortiert und zeichnet den Rest. Danach ist die Queue leer.
+	void flush();
+
+	// false: immer das eingereichte Mesh zeichnen (zum Vergleich)
+	void setLevelOfDetail(bool enabled) { levelOfDetail = enabled; }
+
+	// Was mit dem Programm replaces eingereicht wird und in der Arena liegt, zeichnet renderer
+	// mit seinem eigenen Programm. NULL: alles wie bisher.
+	void setIndirect(IndirectRenderer* renderer, ShaderProgram* replaces)
+	{
+		indirect = renderer;
+		indirectReplaces = replaces;
+	}
+
+	const RenderStats& stats() const { return lastStats; }
+};
+
+#endif
@@ -1,8 +1,6 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
-#include <iostream>
-#include <fstream>
 #include <algorithm>
 using namespace std;
 
@@ -12,86 +10,194 @@ using namespace std;
 #include <GL/glew.h>
 
 #include "shader.hpp"
+#include "mappedfile.hpp"
+#include "streamring.hpp"
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Cache fuer fertig gelinkte Programme (glGetProgramBinary)
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+// Die Datei liegt neben dem Vertex-Shader: "StandardShading.vertexshader" + "StandardShading.fragmentshader"
+// -> "StandardShading_StandardShading.antprog". Der Schluessel ist ein Hash ueber beide Quelltexte und
+// die Treiberkennung, ein neuer Treiber oder eine andere Grafikkarte verwirft den Cache also.
+#define PROGRAMCACHE_VERSION 1
 
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
-	}else{
-		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
-		getchar();
-		return 0;
-	}
+namespace {
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
-	}
+struct ProgramCacheHeader
+{
+	char magic[4];                // "ANTP"
+	unsigned int version;         // PROGRAMCACHE_VERSION
+	unsigned long long key;
+	unsigned int binaryFormat;
+	unsigned int binarySize;
+};
 
+static_assert(sizeof(ProgramCacheHeader) == 24, "ProgramCacheHeader must have the same layout on all platforms");
 
+const char programCacheMagic[4] = { 'A', 'N', 'T', 'P' };
 
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
+// Die ganze Datei auf einmal lesen statt Zeile fuer Zeile
+bool readTextFile(const char * path, std::string & text)
+{
+	FILE * file = fopen(path, "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	text.resize(size > 0 ? (size_t)size : 0);
+	bool ok = size >= 0 && (size == 0 || fread(&text[0], 1, (size_t)size, file) == (size_t)size);
+	fclose(file);
+	return ok;
+}
 
+std::string baseName(const char * path)
+{
+	std::string name(path);
+	size_t slash = name.find_last_of("/\\");
+	if (slash != std::string::npos)
+		name.erase(0, slash + 1);
+	size_t dot = name.find_last_of('.');
+	if (dot != std::string::npos)
+		name.erase(dot);
+	return name;
+}
 
+std::string programCachePath(const char * vertex_file_path, const char * fragment_file_path)
+{
+	std::string path(vertex_file_path);
+	size_t slash = path.find_last_of("/\\");
+	path.erase(slash == std::string::npos ? 0 : slash + 1);
+	return path + baseName(vertex_file_path) + "_" + baseName(fragment_file_path) + ".antprog";
+}
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
+bool programBinarySupported()
+{
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
 
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("%s\n", &VertexShaderErrorMessage[0]);
+unsigned long long programCacheKey(const std::string & vertexCode, const std::string & fragmentCode)
+{
+	unsigned long long key = hashBytes(vertexCode.data(), vertexCode.size());
+	key = hashBytes("\0", 1, key); // "ab" + "c" soll nicht dasselbe sein wie "a" + "bc"
+	key = hashBytes(fragmentCode.data(), fragmentCode.size(), key);
+	const GLenum driverStrings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (int i = 0; i < 3; i++){
+		const char * text = (const char *)glGetString(driverStrings[i]);
+		key = hashBytes("\0", 1, key);
+		if (text)
+			key = hashBytes(text, strlen(text), key);
 	}
+	return key;
+}
 
+// 0, wenn es keinen passenden Cache gibt oder der Treiber das Binary ablehnt
+GLuint loadProgramBinary(const std::string & path, unsigned long long key)
+{
+	MappedFile file;
+	if (!file.open(path.c_str()))
+		return 0;
 
+	const ProgramCacheHeader * header = (const ProgramCacheHeader *)file.data();
+	if (file.size() < sizeof(ProgramCacheHeader) || memcmp(header->magic, programCacheMagic, 4) != 0 ||
+		header->version != PROGRAMCACHE_VERSION || header->key != key ||
+		header->binarySize > file.size() - sizeof(ProgramCacheHeader))
+		return 0;
 
-	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
+	GLuint ProgramID = glCreateProgram();
+	glProgramBinary(ProgramID, header->binaryFormat, file.data() + sizeof(ProgramCacheHeader), header->binarySize);
 
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("%s\n", &FragmentShaderErrorMessage[0]);
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if (!Result){
+		printf("%s was rejected by the driver, compiling from source\n", path.c_str());
+		glDeleteProgram(ProgramID);
+		return 0;
 	}
+	return ProgramID;
+}
+
+void saveProgramBinary(const std::string & path, unsigned long long key, GLuint ProgramID)
+{
+	GLint length = 0;
+	glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	ProgramCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, programCacheMagic, 4);
+	header.version = PROGRAMCACHE_VERSION;
+	header.key = key;
 
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(ProgramID, length, &written, &format, &binary[0]);
+	if (written <= 0)
+		return;
+	header.binaryFormat = format;
+	header.binarySize = (unsigned int)written;
 
+	// Wie beim Mesh-Cache erst in eine temporaere Datei, damit ein Abbruch nichts Halbes hinterlaesst
+	std::string tempPath = path + ".tmp";
+	FILE * file = fopen(tempPath.c_str(), "wb");
+	if (!file)
+		return;
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(&binary[0], written, 1, file) == 1;
+	ok = fclose(file) == 0 && ok;
 
-	// Link the program
+	remove(path.c_str()); // rename ueberschreibt unter Windows nicht
+	if (!ok || rename(tempPath.c_str(), path.c_str()) != 0)
+		remove(tempPath.c_str());
+}
+
+// Kompiliert einen Shader und gibt das Log aus, 0 bei einem Fehler
+GLuint compileShader(GLenum type, const char * path, const std::string & code)
+{
+	printf("Compiling shader : %s\n", path);
+	GLuint ShaderID = glCreateShader(type);
+	char const * SourcePointer = code.c_str();
+	glShaderSource(ShaderID, 1, &SourcePointer , NULL);
+	glCompileShader(ShaderID);
+
+	GLint Result = GL_FALSE;
+	int InfoLogLength = 0;
+	glGetShaderiv(ShaderID, GL_COMPILE_STATUS, &Result);
+	glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if ( InfoLogLength > 0 ){
+		std::vector<char> ShaderErrorMessage(InfoLogLength+1);
+		glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+		printf("%s\n", &ShaderErrorMessage[0]);
+	}
+
+	if (!Result){
+		glDeleteShader(ShaderID);
+		return 0;
+	}
+	return ShaderID;
+}
+
+// Linkt die Shader zu einem Programm und gibt das Log aus, 0 bei einem Fehler.
+// Die Shader werden in jedem Fall geloescht. retrievable fuer glGetProgramBinary.
+GLuint linkProgram(const GLuint * shaders, int count, bool retrievable)
+{
 	printf("Linking program\n");
 	GLuint ProgramID = glCreateProgram();
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
+	for (int i = 0; i < count; i++)
+		glAttachShader(ProgramID, shaders[i]);
+	if (retrievable)
+		glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(ProgramID);
 
-	// Check the program
+	GLint Result = GL_FALSE;
+	int InfoLogLength = 0;
 	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
 	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
@@ -100,10 +206,255 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 		printf("%s\n", &ProgramErrorMessage[0]);
 	}
 
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
+	for (int i = 0; i < count; i++)
+		glDeleteShader(shaders[i]);
 
+	if (!Result){
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
 	return ProgramID;
 }
 
+} // namespace
+
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
 
+	// Read the Vertex Shader code from the file
+	std::string VertexShaderCode;
+	if (!readTextFile(vertex_file_path, VertexShaderCode)){
+		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
+		return 0;
+	}
+
+	// Read the Fragment Shader code from the file
+	std::string FragmentShaderCode;
+	if (!readTextFile(fragment_file_path, FragmentShaderCode)){
+		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", fragment_file_path);
+		return 0;
+	}
+
+	// Try the binary from the last run first
+	bool useCache = programBinarySupported();
+	std::string cachePath;
+	unsigned long long cacheKey = 0;
+	if (useCache){
+		cachePath = programCachePath(vertex_file_path, fragment_file_path);
+		cacheKey = programCacheKey(VertexShaderCode, FragmentShaderCode);
+		GLuint ProgramID = loadProgramBinary(cachePath, cacheKey);
+		if (ProgramID){
+			printf("Loaded program binary %s\n", cachePath.c_str());
+			return ProgramID;
+		}
+	}
+
+	GLuint VertexShaderID = compileShader(GL_VERTEX_SHADER, vertex_file_path, VertexShaderCode);
+	GLuint FragmentShaderID = compileShader(GL_FRAGMENT_SHADER, fragment_file_path, FragmentShaderCode);
+	if (!VertexShaderID || !FragmentShaderID){
+		glDeleteShader(VertexShaderID);
+		glDeleteShader(FragmentShaderID);
+		return 0;
+	}
+
+	GLuint shaders[2] = { VertexShaderID, FragmentShaderID };
+	GLuint ProgramID = linkProgram(shaders, 2, useCache);
+
+	if (useCache && ProgramID)
+		saveProgramBinary(cachePath, cacheKey, ProgramID);
+
+	return ProgramID;
+}
+
+
+GLuint LoadComputeShader(const char * compute_file_path){
+
+	std::string ComputeShaderCode;
+	if (!readTextFile(compute_file_path, ComputeShaderCode)){
+		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", compute_file_path);
+		return 0;
+	}
+
+	GLuint ComputeShaderID = compileShader(GL_COMPUTE_SHADER, compute_file_path, ComputeShaderCode);
+	if (!ComputeShaderID)
+		return 0;
+	return linkProgram(&ComputeShaderID, 1, false);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    ShaderProgram
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ShaderProgram* ShaderProgram::currentProgram = NULL;
+
+ShaderProgram::ShaderProgram()
+	: programID(0)
+{
+}
+
+bool ShaderProgram::load(const char * vertex_file_path, const char * fragment_file_path){
+
+	destroy();
+
+	programID = LoadShaders(vertex_file_path, fragment_file_path);
+	return queryUniforms();
+}
+
+bool ShaderProgram::loadCompute(const char * compute_file_path){
+
+	destroy();
+
+	programID = LoadComputeShader(compute_file_path);
+	return queryUniforms();
+}
+
+bool ShaderProgram::queryUniforms()
+{
+	if (!programID)
+		return false;
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+	if (!linked)
+		return false;
+
+	// Alle aktiven Uniforms einmal abfragen. Uniforms in Bloecken haben keine Position.
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> name(maxLength + 1);
+
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(programID, i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+
+		GLint location = glGetUniformLocation(programID, &name[0]);
+		if (location < 0)
+			continue;
+
+		// Felder heissen "name[0]", wir wollen sie auch als "name" finden
+		std::string uniformName(&name[0], length);
+		if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+			uniformName.erase(uniformName.size() - 3);
+
+		Uniform uniform;
+		uniform.location = location;
+		uniform.type = type;
+		uniform.hasValue = false;
+		uniformByName[uniformName] = (int)uniforms.size();
+		uniforms.push_back(uniform);
+	}
+
+	return true;
+}
+
+void ShaderProgram::destroy()
+{
+	if (currentProgram == this)
+		currentProgram = NULL;
+	if (programID)
+		glDeleteProgram(programID);
+
+	programID = 0;
+	uniforms.clear();
+	uniformByName.clear();
+}
+
+void ShaderProgram::use()
+{
+	if (currentProgram == this)
+		return;
+	glUseProgram(programID);
+	currentProgram = this;
+}
+
+int ShaderProgram::uniform(const char* name) const
+{
+	std::map<std::string, int, std::less<> >::const_iterator it = uniformByName.find(name);
+	return it == uniformByName.end() ? -1 : it->second;
+}
+
+bool ShaderProgram::bindUniformBlock(const char* blockName, GLuint bindingPoint)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(programID, blockName);
+	if (blockIndex == GL_INVALID_INDEX)
+		return false;
+	glUniformBlockBinding(programID, blockIndex, bindingPoint);
+	return true;
+}
+
+bool ShaderProgram::changed(int handle, const void* value, size_t bytes)
+{
+	Uniform& uniform = uniforms[handle];
+	if (uniform.hasValue && memcmp(uniform.value, value, bytes) == 0)
+		return false;
+
+	memcpy(uniform.value, value, bytes);
+	uniform.hasValue = true;
+	return true;
+}
+
+void ShaderProgram::set(int handle, int value)
+{
+	if (handle >= 0 && changed(handle, &value, sizeof(value)))
+		glUniform1i(uniforms[handle].location, value);
+}
+
+void ShaderProgram::set(int handle, const glm::vec3& value)
+{
+	if (handle >= 0 && changed(handle, &value[0], sizeof(value)))
+		glUniform3fv(uniforms[handle].location, 1, &value[0]);
+}
+
+void ShaderProgram::set(int handle, const glm::mat4& value)
+{
+	if (handle >= 0 && changed(handle, &value[0][0], sizeof(value)))
+		glUniformMatrix4fv(uniforms[handle].location, 1, GL_FALSE, &value[0][0]);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    UniformBuffer
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UniformBuffer::UniformBuffer()
+	: buffer(0), bufferSize(0), binding(0)
+{
+}
+
+void UniformBuffer::create(GLuint bindingPoint, GLsizeiptr size)
+{
+	destroy();
+
+	bufferSize = size;
+	binding = bindingPoint;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+}
+
+void UniformBuffer::update(const void* data)
+{
+	StreamRange range;
+	if (streamRing().upload(data, bufferSize, streamRing().uniformOffsetAlignment(), range))
+	{
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, range.buffer, range.offset, range.size);
+		return;
+	}
+
+	// Vorher kann der Bindungspunkt noch auf den Ring gezeigt haben
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, bufferSize, data);
+}
+
+void UniformBuffer::destroy()
+{
+	if (buffer)
+		glDeleteBuffers(1, &buffer);
+	buffer = 0;
+	bufferSize = 0;
+}
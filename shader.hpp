@@ -1,6 +1,83 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
+#include <map>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+// Beide geben 0 zurueck, wenn eine Datei fehlt oder Kompilieren bzw. Linken fehlschlaegt
 GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+GLuint LoadComputeShader(const char * compute_file_path); // GL 4.3, ohne Programm-Cache
+
+// Shaderprogramm, das beim Linken alle aktiven Uniforms abfragt und sich ihre Positionen merkt.
+// Statt glGetUniformLocation bei jedem Zeichnen holt man sich einmal ein Handle mit uniform()
+// und setzt die Werte mit set(). Werte, die sich seit dem letzten set() nicht geaendert haben,
+// werden nicht noch einmal an die Grafikkarte geschickt.
+class ShaderProgram
+{
+	struct Uniform
+	{
+		GLint location;
+		GLenum type;
+		bool hasValue;
+		float value[16]; // zuletzt hochgeladener Wert
+	};
+
+	GLuint programID;
+	std::vector<Uniform> uniforms;
+	std::map<std::string, int, std::less<> > uniformByName;
+
+	static ShaderProgram* currentProgram;
+
+	bool changed(int handle, const void* value, size_t bytes);
+	bool queryUniforms();
+
+	ShaderProgram(const ShaderProgram&);            // nicht kopierbar
+	ShaderProgram& operator=(const ShaderProgram&);
+
+public:
+	ShaderProgram();
+
+	bool load(const char * vertex_file_path, const char * fragment_file_path);
+	bool loadCompute(const char * compute_file_path);
+	void destroy();
+
+	GLuint id() const { return programID; }
+
+	// Alle Programme muessen ueber use() aktiviert werden, damit current() stimmt
+	void use();
+	static ShaderProgram* current() { return currentProgram; }
+
+	// Handle fuer set(), -1 wenn es die Uniform nicht gibt oder sie in einem Uniform-Block liegt
+	int uniform(const char* name) const;
+
+	// Verbindet einen Uniform-Block (layout(std140) uniform Name { ... }) mit einem Bindungspunkt
+	bool bindUniformBlock(const char* blockName, GLuint bindingPoint);
+
+	// Nur fuer das aktive Programm. Handle -1 wird ignoriert.
+	void set(int handle, int value);
+	void set(int handle, const glm::vec3& value);
+	void set(int handle, const glm::mat4& value);
+};
+
+// Uniform-Buffer fuer Daten, die fuer alle Programme gleich sind und sich hoechstens einmal
+// pro Frame aendern. Bleibt dauerhaft an seinem Bindungspunkt. Gibt es den StreamRing,
+// landet jedes update() dort und der Bindungspunkt zeigt auf das neue Stueck.
+class UniformBuffer
+{
+	GLuint buffer;
+	GLsizeiptr bufferSize;
+	GLuint binding;
+
+public:
+	UniformBuffer();
+
+	void create(GLuint bindingPoint, GLsizeiptr size);
+	void update(const void* data);
+	void destroy();
+};
 
 #endif
@@ -0,0 +1,348 @@
+#include <math.h>
+
+#include <GL/glew.h>
+
+#include "simulation.hpp"
+#include "profiler.hpp"
+
+// Geschwindigkeiten entsprechen dem alten Verhalten bei etwa 30 Tastenwiederholungen pro Sekunde
+// (0.1 vor, 0.02 zurueck und 6 Grad pro Wiederholung)
+static const float ANT_SPEED = 3.0f;      // pro Sekunde
+static const float ANT_BACK_SPEED = 0.6f; // pro Sekunde
+static const float ANT_TURN_SPEED = 180.0f; // Grad pro Sekunde
+
+// Food Drops landen in [-10, 10] x [-10, 10]
+static const float FOOD_MIN = -10.0f;
+static const float FOOD_MAX = 10.0f;
+static const float FOOD_SCALE = 0.2f; // so werden sie gezeichnet, danach liegen sie in der Welt der Kolonie
+static const float FOOD_AMOUNT = 20.0f; // Ameisenladungen pro Food Drop
+
+// Die Kolonie laeuft ungefaehr dort, wo die Food Drops liegen (die werden mit 0.2 skaliert gezeichnet)
+static const float COLONY_HALF_SIZE = 2.0f;
+static const float COLONY_WANDER = 3.0f; // Bogenmass pro Sekunde
+static const float COLONY_SPEED = 0.3f;
+static const float FOOD_PICKUP_RADIUS = 0.2f; // Radius eines gezeichneten Food Drops
+static const float NEST_RADIUS = 0.25f;
+static const float NEIGHBOUR_RADIUS = 0.5f; // so weit zaehlen Ameisen als Nachbarn der eigenen
+
+// 256 x 256 Zellen, also etwa 1.5 cm pro Zelle. Eine laufende Ameise hinterlaesst etwa 0.5 pro Zelle.
+static const int PHEROMONE_CELLS = 256;
+static const float PHEROMONE_DIFFUSION = 1.0f;   // pro Sekunde
+static const float PHEROMONE_EVAPORATION = 0.3f; // pro Sekunde
+static const float PHEROMONE_DEPOSIT = 10.0f;    // pro Sekunde und Ameise
+
+bool SimInputQueue::push(const SimInputEvent& event)
+{
+	unsigned int h = head.load(std::memory_order_relaxed);
+	if (h - tail.load(std::memory_order_acquire) == CAPACITY)
+		return false;
+	events[h % CAPACITY] = event;
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+bool SimInputQueue::pop(SimInputEvent& event)
+{
+	unsigned int t = tail.load(std::memory_order_relaxed);
+	if (t == head.load(std::memory_order_acquire))
+		return false;
+	event = events[t % CAPACITY];
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+Simulation::Simulation(double tickRate, int maxFood, int initialFood, size_t colonySize, unsigned int seed)
+	: tickRate(tickRate), maxFood(maxFood), foodInterval(5.0), food(maxFood), colony(COLONY_HALF_SIZE, COLONY_WANDER),
+	pheromones(PHEROMONE_CELLS, COLONY_HALF_SIZE, PHEROMONE_DIFFUSION, PHEROMONE_EVAPORATION),
+	foodGrid(COLONY_HALF_SIZE, FOOD_PICKUP_RADIUS), antGrid(COLONY_HALF_SIZE, NEIGHBOUR_RADIUS), lastFood(0.0), random(seed),
+	middle(1), writeIndex(0), readIndex(2), running(false), start(std::chrono::steady_clock::now())
+{
+	state.tick = 0;
+	state.time = 0.0;
+	state.antX = state.antY = state.antRotation = 0.0f;
+	state.antsNearby = 0;
+	state.foodX.reserve(maxFood);
+	state.foodY.reserve(maxFood);
+	for (int i = 0; i < SIM_INPUT_COUNT; i++)
+		held[i] = tapped[i] = false;
+	while ((int)food.size() < initialFood && (int)food.size() < maxFood)
+		spawnFood();
+	copyFood();
+	foodWorldX.reserve(maxFood);
+	foodWorldY.reserve(maxFood);
+	colony.reserve(colonySize);
+	colony.spawn(colonySize, 0.0f, 0.0f, COLONY_SPEED, seed);
+	nearestFood.reserve(colonySize);
+	antNeighbours.reserve(colonySize);
+
+	// Alle drei Plaetze zeigen den Anfangszustand, bis der erste Schritt veroeffentlicht ist
+	previousState = state;
+	copyColony(previousState);
+	for (int i = 0; i < 3; i++)
+	{
+		frames[i].previous = previousState;
+		frames[i].current = previousState;
+	}
+}
+
+Simulation::~Simulation()
+{
+	stopThread();
+}
+
+void Simulation::spawnFood()
+{
+	// Wie frueher mit rand(), aber mit eigenem Generator: rand() hat je nach Plattform
+	// einen Zustand pro Thread, und der Ablauf soll mit demselben seed immer gleich sein
+	float x = FOOD_MIN + (random() - random.min()) / (float((random.max() - random.min()) / (FOOD_MAX - FOOD_MIN)));
+	float y = FOOD_MIN + (random() - random.min()) / (float((random.max() - random.min()) / (FOOD_MAX - FOOD_MIN)));
+	FoodDrop drop = { x, y, FOOD_AMOUNT };
+	food.spawn(drop);
+}
+
+void Simulation::copyFood()
+{
+	state.foodX.resize(food.size());
+	state.foodY.resize(food.size());
+	for (size_t i = 0; i < food.size(); i++)
+	{
+		state.foodX[i] = food[i].x;
+		state.foodY[i] = food[i].y;
+	}
+}
+
+void Simulation::copyColony(SimState& target) const
+{
+	target.colonyX = colony.x;
+	target.colonyY = colony.y;
+	target.colonyHeading = colony.heading;
+	target.colonyHandle.resize(colony.size());
+	for (size_t i = 0; i < colony.size(); i++)
+		target.colonyHandle[i] = colony.handle(i);
+}
+
+// Suchende Ameisen, die einen Food Drop erreichen, nehmen Futter auf und kehren um;
+// ist er leer, verschwindet er. Heimkehrende geben das Futter am Nest ab und suchen weiter.
+void Simulation::pickUpFood()
+{
+	size_t foodCount = food.size();
+	size_t antCount = colony.size();
+	if (antCount == 0)
+		return;
+
+	foodWorldX.resize(foodCount);
+	foodWorldY.resize(foodCount);
+	for (size_t i = 0; i < foodCount; i++)
+	{
+		foodWorldX[i] = food[i].x * FOOD_SCALE;
+		foodWorldY[i] = food[i].y * FOOD_SCALE;
+	}
+	foodGrid.build(foodWorldX.empty() ? NULL : &foodWorldX[0], foodWorldY.empty() ? NULL : &foodWorldY[0], foodCount);
+
+	// Eine Abfrage fuer alle Ameisen auf einmal
+	nearestFood.resize(antCount);
+	foodGrid.nearest(&colony.x[0], &colony.y[0], antCount, 1, FOOD_PICKUP_RADIUS, &nearestFood[0]);
+	// Leere Food Drops verschwinden mitten in der Schleife, die Stellen der anderen aendern sich dabei
+	for (size_t i = 0; i < antCount; i++)
+		nearestFood[i] = nearestFood[i] == SpatialGrid::NONE ? NO_ENTITY : food.handleAt(nearestFood[i]);
+
+	for (size_t i = 0; i < antCount; i++)
+	{
+		FoodDrop* drop = colony.state[i] == ANT_SEARCHING ? food.get(nearestFood[i]) : NULL;
+		if (drop)
+		{
+			drop->amount -= 1.0f;
+			if (drop->amount <= 0.0f)
+				food.despawn(nearestFood[i]);
+			colony.state[i] = ANT_RETURNING;
+			colony.carried[i] = 1.0f;
+			float h = colony.heading[i] + 3.14159265f;
+			colony.heading[i] = h >= 3.14159265f ? h - 6.28318531f : h;
+		}
+		else if (colony.state[i] == ANT_RETURNING &&
+			colony.x[i] * colony.x[i] + colony.y[i] * colony.y[i] <= NEST_RADIUS * NEST_RADIUS)
+		{
+			colony.state[i] = ANT_SEARCHING;
+			colony.carried[i] = 0.0f;
+		}
+	}
+}
+
+// Die Kolonie in ihr eigenes Gitter, danach ist jede Nachbarschaftsfrage zwischen Ameisen
+// eine Abfrage darauf; hier zaehlen wir die Ameisen um die eigene
+void Simulation::findNeighbours()
+{
+	size_t antCount = colony.size();
+	antGrid.build(antCount ? &colony.x[0] : NULL, antCount ? &colony.y[0] : NULL, antCount);
+	antNeighbours.clear();
+	state.antsNearby = (unsigned int)antGrid.queryRadius(state.antX, state.antY, NEIGHBOUR_RADIUS, antNeighbours);
+}
+
+void Simulation::tick()
+{
+	SimInputEvent event;
+	while (inputs.pop(event))
+	{
+		held[event.input] = event.pressed;
+		if (event.pressed)
+			tapped[event.input] = true;
+	}
+
+	state.tick++;
+	state.time = state.tick / tickRate;
+	float dt = (float)(1.0 / tickRate);
+
+	bool turnLeft = held[SIM_TURN_LEFT] || tapped[SIM_TURN_LEFT];
+	bool turnRight = held[SIM_TURN_RIGHT] || tapped[SIM_TURN_RIGHT];
+	if (turnRight)
+		state.antRotation += ANT_TURN_SPEED * dt;
+	if (turnLeft)
+		state.antRotation -= ANT_TURN_SPEED * dt;
+
+	float radians = state.antRotation * (3.14159265358979323846f / 180.0f);
+	float speed = 0.0f;
+	if (held[SIM_FORWARD] || tapped[SIM_FORWARD])
+		speed += ANT_SPEED;
+	if (held[SIM_BACKWARD] || tapped[SIM_BACKWARD])
+		speed -= ANT_BACK_SPEED;
+	state.antX += cosf(radians) * speed * dt;
+	state.antY += sinf(radians) * speed * dt;
+
+	for (int i = 0; i < SIM_INPUT_COUNT; i++)
+		tapped[i] = false;
+
+	colony.update(dt);
+	pickUpFood();
+	findNeighbours();
+	pheromones.deposit(colony, PHEROMONE_DEPOSIT * dt);
+	pheromones.update(dt);
+
+	//nach x Sekunden und bei weniger als y Food Drops auf dem Feld
+	if (state.time - lastFood > foodInterval && (int)food.size() < maxFood)
+	{
+		spawnFood();
+		lastFood = state.time;
+	}
+	copyFood();
+}
+
+void Simulation::publish()
+{
+	SimFrame& frame = frames[writeIndex];
+	frame.previous = previousState;
+	frame.current = state;
+	copyColony(frame.current);
+	// Den geschriebenen Platz in die Mitte legen und den alten mittleren zum Schreiben nehmen
+	writeIndex = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & 3;
+}
+
+void Simulation::advance(double time)
+{
+	bool ticked = false;
+	while ((state.tick + 1) / tickRate <= time)
+	{
+		// Die Kolonie nur vor dem letzten Schritt kopieren, nur der wird veroeffentlicht
+		previousState = state;
+		if ((state.tick + 2) / tickRate > time)
+			copyColony(previousState);
+		tick();
+		ticked = true;
+	}
+	if (ticked)
+	{
+		pheromones.publish();
+		publish();
+	}
+}
+
+double Simulation::clock() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Simulation::threadLoop()
+{
+	while (running.load(std::memory_order_relaxed))
+	{
+		{
+			ProfileScope scope("simulation tick");
+			advance(clock());
+		}
+		std::chrono::duration<double> next((state.tick + 1) / tickRate);
+		std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(next));
+	}
+}
+
+void Simulation::startThread()
+{
+	if (running)
+		return;
+	// Die Uhr beginnt beim aktuellen Zustand
+	start = std::chrono::steady_clock::now() -
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(state.time));
+	running = true;
+	thread = std::thread(&Simulation::threadLoop, this);
+}
+
+void Simulation::stopThread()
+{
+	if (!running)
+		return;
+	running = false;
+	thread.join();
+}
+
+void Simulation::input(SimInput input, bool pressed)
+{
+	SimInputEvent event = { (unsigned char)input, pressed };
+	inputs.push(event);
+}
+
+void Simulation::snapshot(double renderTime, SimView& view)
+{
+	if (middle.load(std::memory_order_acquire) & FRESH)
+		readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & 3;
+	const SimFrame& frame = frames[readIndex];
+
+	// Einen Schritt hinter der Simulation: bei current.time steht man noch auf previous
+	double alpha = (renderTime - frame.current.time) * tickRate;
+	if (frame.current.tick == frame.previous.tick || alpha > 1.0)
+		alpha = 1.0;
+	if (alpha < 0.0)
+		alpha = 0.0;
+	float a = (float)alpha;
+
+	view.time = frame.previous.time + (frame.current.time - frame.previous.time) * alpha;
+	view.antX = frame.previous.antX + (frame.current.antX - frame.previous.antX) * a;
+	view.antY = frame.previous.antY + (frame.current.antY - frame.previous.antY) * a;
+	view.antRotation = frame.previous.antRotation + (frame.current.antRotation - frame.previous.antRotation) * a;
+	view.foodX = &frame.current.foodX;
+	view.foodY = &frame.current.foodY;
+	view.antsNearby = frame.current.antsNearby;
+
+	// Wer ueber den Rand gesprungen ist, wird nicht quer durch die Welt interpoliert;
+	// die Richtung geht den kurzen Weg ueber +-pi
+	const SimState& from = frame.previous;
+	const SimState& to = frame.current;
+	size_t count = to.colonyX.size();
+	view.colonyX.resize(count);
+	view.colonyY.resize(count);
+	view.colonyHeading.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		// Nach despawn steht an dieser Stelle vielleicht eine andere Ameise
+		bool interpolate = i < from.colonyHandle.size() && from.colonyHandle[i] == to.colonyHandle[i];
+		float dx = interpolate ? to.colonyX[i] - from.colonyX[i] : 0.0f;
+		float dy = interpolate ? to.colonyY[i] - from.colonyY[i] : 0.0f;
+		float dh = interpolate ? to.colonyHeading[i] - from.colonyHeading[i] : 0.0f;
+		if (fabsf(dx) > COLONY_HALF_SIZE || fabsf(dy) > COLONY_HALF_SIZE)
+			dx = dy = 0.0f;
+		if (dh > 3.14159265f)
+			dh -= 6.28318531f;
+		else if (dh < -3.14159265f)
+			dh += 6.28318531f;
+		view.colonyX[i] = to.colonyX[i] - dx * (1.0f - a);
+		view.colonyY[i] = to.colonyY[i] - dy * (1.0f - a);
+		view.colonyHeading[i] = to.colonyHeading[i] - dh * (1.0f - a);
+	}
+}
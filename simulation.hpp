@@ -0,0 +1,183 @@
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "colony.hpp"
+#include "entitypool.hpp"
+#include "pheromone.hpp"
+#include "spatialgrid.hpp"
+
+// Was die Tasten mit der Ameise machen. Solange eine Taste gedrueckt ist, laeuft bzw. dreht
+// sich die Ameise mit fester Geschwindigkeit, unabhaengig von der Tastenwiederholung des OS.
+enum SimInput
+{
+	SIM_FORWARD,
+	SIM_BACKWARD,
+	SIM_TURN_LEFT,
+	SIM_TURN_RIGHT,
+	SIM_INPUT_COUNT
+};
+
+struct SimInputEvent
+{
+	unsigned char input; // SimInput
+	bool pressed;
+};
+
+// Eingaben von den GLFW-Callbacks (GL-Thread) zur Simulation. Ein Schreiber, ein Leser,
+// ohne Lock; ist die Queue voll, geht die Eingabe verloren.
+class SimInputQueue
+{
+	enum { CAPACITY = 256 };
+
+	SimInputEvent events[CAPACITY];
+	std::atomic<unsigned int> head; // schreibt nur der GL-Thread
+	std::atomic<unsigned int> tail; // schreibt nur die Simulation
+
+public:
+	SimInputQueue() : head(0), tail(0) {}
+
+	bool push(const SimInputEvent& event);
+	bool pop(SimInputEvent& event);
+};
+
+struct FoodDrop
+{
+	float x; // wie frueher in [-10, 10], gezeichnet mit 0.2 skaliert
+	float y;
+	float amount; // so oft kann eine Ameise noch etwas mitnehmen
+};
+
+// Zustand der Welt nach einem Schritt
+struct SimState
+{
+	unsigned long long tick;
+	double time; // tick / tickRate, Sekunden
+	float antX;
+	float antY;
+	float antRotation; // Grad, wird nicht auf 0..360 begrenzt, damit die Interpolation stetig ist
+	std::vector<float> foodX; // Kopie der liegenden Food Drops, nur zum Zeichnen
+	std::vector<float> foodY;
+	// Kopie aus der Kolonie, nur zum Zeichnen. Im Zustand der Simulation bleiben sie leer, damit
+	// das Kopieren des Zustands in jedem Schritt nicht die ganze Kolonie mitnimmt; gefuellt werden
+	// sie nur in den Kopien, die veroeffentlicht werden (copyColony).
+	std::vector<float> colonyX;
+	std::vector<float> colonyY;
+	std::vector<float> colonyHeading;
+	std::vector<EntityHandle> colonyHandle; // interpoliert wird nur, wo derselbe Handle steht
+	unsigned int antsNearby; // Ameisen der Kolonie nahe der eigenen (antGrid)
+};
+
+// Die letzten beiden Zustaende, zwischen denen der Renderer interpoliert
+struct SimFrame
+{
+	SimState previous;
+	SimState current;
+};
+
+// Interpolierter Zustand fuer einen Frame
+struct SimView
+{
+	double time;
+	float antX;
+	float antY;
+	float antRotation;
+	const std::vector<float>* foodX; // aus current, gilt bis zum naechsten snapshot()
+	const std::vector<float>* foodY;
+	std::vector<float> colonyX; // interpoliert, behalten ihren Speicher ueber die Frames
+	std::vector<float> colonyY;
+	std::vector<float> colonyHeading; // Bogenmass
+	unsigned int antsNearby; // aus current
+};
+
+// Die Spielwelt (Ameise, Food Drops) rechnet in festen Schritten, in einem eigenen Thread.
+// Ein langsamer Frame bremst die Welt also nicht mehr, und die Welt bremst keinen Frame.
+// Jeder Schritt legt das Paar (vorheriger, aktueller Zustand) in einen dreifachen Puffer:
+// ein Platz gehoert der Simulation, einer dem Renderer, der dritte liegt dazwischen und
+// wird mit einem atomaren exchange getauscht. Keine Seite wartet auf die andere.
+// Der Renderer zeichnet einen Schritt hinter der Simulation und interpoliert dazwischen.
+class Simulation
+{
+	enum { FRESH = 4 }; // Bit im mittleren Index: seit dem letzten Lesen neu geschrieben
+
+	double tickRate;
+	int maxFood;
+	double foodInterval; // Sekunden zwischen zwei Food Drops
+
+	// Nur die Simulation (bzw. der Aufrufer von advance)
+	SimState state;
+	EntityPool<FoodDrop> food;
+	Colony colony;
+	PheromoneField pheromones; // gehoert der Simulation, nur Textur und Upload sind fuer den GL-Thread
+	SimState previousState; // behaelt seinen Speicher, damit ein Schritt nichts anlegt
+	SpatialGrid foodGrid;   // Food Drops in Weltkoordinaten, jeden Schritt neu
+	std::vector<float> foodWorldX;
+	std::vector<float> foodWorldY;
+	std::vector<unsigned int> nearestFood; // pro Ameise, erst Stelle, dann Handle
+	SpatialGrid antGrid;    // Ameisen der Kolonie, jeden Schritt neu
+	std::vector<unsigned int> antNeighbours; // Stellen der Ameisen nahe der eigenen
+	double lastFood;
+	bool held[SIM_INPUT_COUNT];
+	bool tapped[SIM_INPUT_COUNT]; // in diesem Schritt gedrueckt, wirkt auch, wenn schon wieder losgelassen
+	std::minstd_rand random;
+
+	SimFrame frames[3];
+	std::atomic<unsigned int> middle;
+	unsigned int writeIndex;
+	unsigned int readIndex;
+
+	SimInputQueue inputs;
+	std::thread thread;
+	std::atomic<bool> running;
+	std::chrono::steady_clock::time_point start;
+
+	void spawnFood();
+	void copyFood();
+	void copyColony(SimState& target) const;
+	void pickUpFood();
+	void findNeighbours();
+	void tick();
+	void publish();
+	void threadLoop();
+
+	Simulation(const Simulation&);            // nicht kopierbar
+	Simulation& operator=(const Simulation&);
+
+public:
+	// Alle foodInterval Sekunden ein Food Drop, bis maxFood liegen. initialFood liegen sofort.
+	// Dazu colonySize Ameisen, die vom Nest im Ursprung aus umherlaufen (siehe colony.hpp).
+	Simulation(double tickRate, int maxFood, int initialFood, size_t colonySize, unsigned int seed);
+	~Simulation();
+
+	// Eigener Thread, der nach der Uhr tickt
+	void startThread();
+	void stopThread();
+
+	// Ohne Thread: so viele Schritte rechnen, bis time erreicht ist (fuer --headless)
+	void advance(double time);
+	// Sekunden seit startThread, in derselben Zeitrechnung wie SimState::time
+	double clock() const;
+
+	// Thread-sicher, vom GL-Thread aus
+	void input(SimInput input, bool pressed);
+
+	// Holt den neuesten veroeffentlichten Zustand und interpoliert fuer renderTime.
+	// renderTime liegt normalerweise zwischen previous.time und current.time + 1 / tickRate.
+	void snapshot(double renderTime, SimView& view);
+
+	double rate() const { return tickRate; }
+
+	// Wie oft die Pools (Food Drops, Kolonie) wachsen mussten. Nach dem Konstruktor sollte
+	// sich das nicht mehr aendern. Nur ohne eigenen Thread aufrufen.
+	unsigned int poolAllocations() const { return food.allocations() + colony.allocations(); }
+
+	// createTexture, uploadDirtyTiles und texture() vom GL-Thread aus (siehe pheromone.hpp)
+	PheromoneField& pheromoneField() { return pheromones; }
+};
+
+#endif
@@ -0,0 +1,219 @@
+#include <math.h>
+#include <thread>
+#include <algorithm>
+
+#include "spatialgrid.hpp"
+#include "parallel.hpp"
+
+// Darunter lohnen sich keine Threads
+static const size_t MIN_PARALLEL_QUERIES = 1024;
+static const int MAX_CELLS_PER_SIDE = 4096;
+
+SpatialGrid::SpatialGrid(float halfSize, float cellSize)
+	: halfSize(halfSize)
+{
+	cellsPerSide = (int)ceilf(2.0f * halfSize / cellSize);
+	cellsPerSide = std::max(1, std::min(cellsPerSide, MAX_CELLS_PER_SIDE));
+	this->cellSize = 2.0f * halfSize / cellsPerSide;
+	invCellSize = cellsPerSide / (2.0f * halfSize);
+	cellStart.assign((size_t)cellsPerSide * cellsPerSide + 1, 0);
+
+	unsigned int hardware = std::thread::hardware_concurrency();
+	threadCount = hardware ? hardware : 1;
+}
+
+int SpatialGrid::cellX(float x) const
+{
+	int c = (int)floorf((x + halfSize) * invCellSize);
+	return c < 0 ? 0 : (c >= cellsPerSide ? cellsPerSide - 1 : c);
+}
+
+int SpatialGrid::cellY(float y) const
+{
+	return cellX(y); // quadratisch
+}
+
+void SpatialGrid::build(const float* x, const float* y, size_t count)
+{
+	// Counting sort: zaehlen, Anfaenge aufsummieren, einsortieren. Innerhalb einer Zelle
+	// bleibt die urspruengliche Reihenfolge erhalten.
+	std::fill(cellStart.begin(), cellStart.end(), 0);
+	cellOf.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned int cell = (unsigned int)(cellY(y[i]) * cellsPerSide + cellX(x[i]));
+		cellOf[i] = cell;
+		cellStart[cell + 1]++;
+	}
+	for (size_t c = 1; c < cellStart.size(); c++)
+		cellStart[c] += cellStart[c - 1];
+
+	order.resize(count);
+	sortedX.resize(count);
+	sortedY.resize(count);
+	// cellStart[c] dient beim Einsortieren als Schreibposition von Zelle c ...
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned int slot = cellStart[cellOf[i]]++;
+		order[slot] = (unsigned int)i;
+		sortedX[slot] = x[i];
+		sortedY[slot] = y[i];
+	}
+	// ... und steht danach auf ihrem Ende, also alles um eine Zelle nach hinten schieben
+	for (size_t c = cellStart.size() - 1; c > 0; c--)
+		cellStart[c] = cellStart[c - 1];
+	cellStart[0] = 0;
+}
+
+template <typename Body>
+void SpatialGrid::forEachInRadius(float x, float y, float radius, Body body) const
+{
+	if (order.empty() || !(radius >= 0.0f))
+		return;
+	int x0 = cellX(x - radius), x1 = cellX(x + radius);
+	int y0 = cellY(y - radius), y1 = cellY(y + radius);
+	float radius2 = radius * radius;
+	for (int cy = y0; cy <= y1; cy++)
+	{
+		// Die Zellen x0..x1 einer Zeile liegen in order hintereinander
+		unsigned int begin = cellStart[cy * cellsPerSide + x0];
+		unsigned int end = cellStart[cy * cellsPerSide + x1 + 1];
+		for (unsigned int j = begin; j < end; j++)
+		{
+			float dx = sortedX[j] - x;
+			float dy = sortedY[j] - y;
+			float d2 = dx * dx + dy * dy;
+			if (d2 <= radius2)
+				body(order[j], d2);
+		}
+	}
+}
+
+size_t SpatialGrid::queryRadius(float x, float y, float radius, std::vector<unsigned int>& result) const
+{
+	size_t before = result.size();
+	forEachInRadius(x, y, radius, [&](unsigned int index, float)
+	{
+		result.push_back(index);
+	});
+	return result.size() - before;
+}
+
+size_t SpatialGrid::nearest(float x, float y, size_t k, float maxRadius, unsigned int* indices, float* distances2) const
+{
+	// Die besten k, aufsteigend, per Einfuegen (k ist klein)
+	std::vector<float> best2Storage;
+	float bestLocal[16];
+	float* best2 = distances2;
+	if (!best2)
+	{
+		if (k <= 16)
+			best2 = bestLocal;
+		else
+		{
+			best2Storage.resize(k);
+			best2 = &best2Storage[0];
+		}
+	}
+	for (size_t i = 0; i < k; i++)
+		indices[i] = NONE;
+	if (k == 0 || order.empty() || !(maxRadius >= 0.0f))
+		return 0;
+
+	float maxRadius2 = maxRadius * maxRadius;
+	size_t found = 0;
+	int cx = cellX(x), cy = cellY(y);
+
+	// Ringe von Zellen um die Zelle der Abfrage, bis nichts Naeheres mehr kommen kann
+	for (int ring = 0; ; ring++)
+	{
+		int x0 = cx - ring, x1 = cx + ring, y0 = cy - ring, y1 = cy + ring;
+		for (int ry = std::max(y0, 0); ry <= std::min(y1, cellsPerSide - 1); ry++)
+		{
+			// Auf der oberen und unteren Zeile des Rings alle Zellen, dazwischen nur die beiden Raender
+			bool fullRow = ry == y0 || ry == y1;
+			for (int side = 0; side < (fullRow ? 1 : 2); side++)
+			{
+				int first = fullRow ? x0 : (side == 0 ? x0 : x1);
+				int last = fullRow ? x1 : first;
+				first = std::max(first, 0);
+				last = std::min(last, cellsPerSide - 1);
+				if (first > last)
+					continue;
+				unsigned int begin = cellStart[ry * cellsPerSide + first];
+				unsigned int end = cellStart[ry * cellsPerSide + last + 1];
+				for (unsigned int j = begin; j < end; j++)
+				{
+					float dx = sortedX[j] - x;
+					float dy = sortedY[j] - y;
+					float d2 = dx * dx + dy * dy;
+					if (d2 > maxRadius2 || (found == k && d2 >= best2[k - 1]))
+						continue;
+					size_t slot = found < k ? found++ : k - 1;
+					while (slot > 0 && best2[slot - 1] > d2)
+					{
+						best2[slot] = best2[slot - 1];
+						indices[slot] = indices[slot - 1];
+						slot--;
+					}
+					best2[slot] = d2;
+					indices[slot] = order[j];
+				}
+			}
+		}
+
+		// Abstand von der Abfrage bis ausserhalb der bisher besuchten Zellen
+		float left = x - (-halfSize + x0 * cellSize);
+		float right = (-halfSize + (x1 + 1) * cellSize) - x;
+		float bottom = y - (-halfSize + y0 * cellSize);
+		float top = (-halfSize + (y1 + 1) * cellSize) - y;
+		float outside = std::min(std::min(left, right), std::min(bottom, top));
+		bool coversGrid = x0 <= 0 && y0 <= 0 && x1 >= cellsPerSide - 1 && y1 >= cellsPerSide - 1;
+		if (coversGrid || (outside > 0.0f && outside * outside > maxRadius2) ||
+			(found == k && outside > 0.0f && outside * outside >= best2[k - 1]))
+			break;
+	}
+	return found;
+}
+
+void SpatialGrid::queryRadius(const float* x, const float* y, size_t count, float radius,
+	std::vector<unsigned int>& offsets, std::vector<unsigned int>& result) const
+{
+	// Erst zaehlen, dann schreibt jede Abfrage an ihre eigene Stelle: kein Lock, und das
+	// Ergebnis ist unabhaengig von der Anzahl der Threads
+	offsets.resize(count + 1);
+	size_t threads = count < MIN_PARALLEL_QUERIES ? 1 : threadCount;
+	parallelFor(count, threads, [&](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			unsigned int hits = 0;
+			forEachInRadius(x[i], y[i], radius, [&](unsigned int, float) { hits++; });
+			offsets[i + 1] = hits;
+		}
+	});
+	offsets[0] = 0;
+	for (size_t i = 1; i <= count; i++)
+		offsets[i] += offsets[i - 1];
+
+	result.resize(offsets[count]);
+	parallelFor(count, threads, [&](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			unsigned int* out = result.empty() ? NULL : &result[0] + offsets[i];
+			forEachInRadius(x[i], y[i], radius, [&](unsigned int index, float) { *out++ = index; });
+		}
+	});
+}
+
+void SpatialGrid::nearest(const float* x, const float* y, size_t count, size_t k, float maxRadius,
+	unsigned int* indices) const
+{
+	size_t threads = count < MIN_PARALLEL_QUERIES ? 1 : threadCount;
+	parallelFor(count, threads, [&](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+			nearest(x[i], y[i], k, maxRadius, indices + i * k, NULL);
+	});
+}
@@ -0,0 +1,63 @@
+#ifndef SPATIALGRID_HPP
+#define SPATIALGRID_HPP
+
+#include <vector>
+
+// Gleichmaessiges Gitter ueber [-halfSize, halfSize]^2 fuer Nachbarschaftsfragen (Food Drops,
+// Ameisen). build() sortiert die Positionen mit counting sort nach Zellen: danach liegen die
+// Eintraege jeder Gitterzeile hintereinander, eine Abfrage liest pro Zeile einen zusammen-
+// haengenden Bereich. Positionen ausserhalb landen in der naechsten Randzelle, die Abstaende
+// sind ganz normal euklidisch (die Raender sind hier nicht verbunden).
+// Gedacht ist, das Gitter in jedem Schritt neu aufzubauen; es behaelt seinen Speicher.
+class SpatialGrid
+{
+	float halfSize;
+	float cellSize;
+	float invCellSize;
+	int cellsPerSide;
+
+	std::vector<unsigned int> cellStart; // Anfang jeder Zelle in order, plus ein Ende
+	std::vector<unsigned int> cellOf;    // Zelle jedes Eintrags, nur waehrend build()
+	std::vector<unsigned int> order;     // Eintraege nach Zellen sortiert
+	std::vector<float> sortedX;          // Positionen in derselben Reihenfolge wie order
+	std::vector<float> sortedY;
+
+	size_t threadCount;
+
+	int cellX(float x) const;
+	int cellY(float y) const;
+	// body(index, distanz^2) fuer alle Eintraege mit Abstand <= radius
+	template <typename Body>
+	void forEachInRadius(float x, float y, float radius, Body body) const;
+
+public:
+	enum { NONE = 0xffffffffu }; // kein Eintrag gefunden
+
+	// cellSize etwa so gross wie der uebliche Suchradius. Zu feine Gitter werden auf
+	// 4096 x 4096 Zellen begrenzt.
+	SpatialGrid(float halfSize, float cellSize);
+
+	void build(const float* x, const float* y, size_t count);
+	size_t size() const { return order.size(); }
+	int cellsPerRow() const { return cellsPerSide; }
+
+	// Einzelne Abfragen ------------------------------------------------------------------------
+
+	// Haengt alle Eintraege mit Abstand <= radius an result an, gibt ihre Anzahl zurueck
+	size_t queryRadius(float x, float y, float radius, std::vector<unsigned int>& result) const;
+	// Die k naechsten mit Abstand <= maxRadius, aufsteigend nach Abstand. Gibt die Anzahl zurueck,
+	// die restlichen Plaetze von indices werden NONE. distances2 (Abstand^2) darf NULL sein.
+	size_t nearest(float x, float y, size_t k, float maxRadius, unsigned int* indices, float* distances2) const;
+
+	// Viele Abfragen auf einmal, verteilt auf die Kerne -------------------------------------------
+
+	// Die Treffer von Abfrage i stehen in result[offsets[i], offsets[i + 1])
+	void queryRadius(const float* x, const float* y, size_t count, float radius,
+		std::vector<unsigned int>& offsets, std::vector<unsigned int>& result) const;
+	// k Plaetze pro Abfrage in indices (count * k), nicht gefundene sind NONE
+	void nearest(const float* x, const float* y, size_t count, size_t k, float maxRadius, unsigned int* indices) const;
+
+	void setThreadCount(size_t threads) { threadCount = threads ? threads : 1; }
+};
+
+#endif
@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include "streamring.hpp"
+
+// Laenger wartet glClientWaitSync nicht am Stueck, danach wird erneut gefragt
+static const GLuint64 FENCE_TIMEOUT_NS = 100 * 1000 * 1000;
+
+static void resetStats(StreamStats& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+StreamRing::StreamRing()
+	: ringBuffer(0), mapped(NULL), frameSize(0), frameIndex(0), used(0), inFrame(false),
+	uniformAlignment(256), storageAlignment(256), frames(0), peakBytes(0)
+{
+	resetStats(current);
+	resetStats(last);
+	resetStats(total);
+}
+
+StreamRing& streamRing()
+{
+	static StreamRing ring;
+	return ring;
+}
+
+bool StreamRing::create(size_t size, unsigned int frameCount)
+{
+	destroy();
+
+	if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+	{
+		printf("Persistent stream ring needs OpenGL 4.4 or ARB_buffer_storage, uploading per buffer\n");
+		return false;
+	}
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	uniformAlignment = alignment > 0 ? (size_t)alignment : 256;
+	alignment = 0;
+	if (GLEW_VERSION_4_3 || GLEW_ARB_shader_storage_buffer_object)
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	storageAlignment = alignment > 0 ? (size_t)alignment : 256;
+
+	// Jeder Bereich beginnt so ausgerichtet, wie es der strengste Nutzer verlangt
+	frameSize = alignUp(size, uniformAlignment > storageAlignment ? uniformAlignment : storageAlignment);
+	fences.assign(frameCount, (GLsync)0);
+	frameIndex = 0;
+	used = 0;
+	inFrame = false;
+	resetStats(current);
+	resetStats(last);
+	resetStats(total);
+	frames = 0;
+	peakBytes = 0;
+
+	// Einmal mappen und das Mapping behalten. Coherent: kein Flush noetig, die Fences reichen.
+	GLsizeiptr bytes = (GLsizeiptr)(frameSize * frameCount);
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &ringBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, bytes, NULL, flags);
+	mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, flags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	if (!mapped)
+	{
+		printf("Could not map the stream ring, uploading per buffer\n");
+		glDeleteBuffers(1, &ringBuffer);
+		ringBuffer = 0;
+		return false;
+	}
+	return true;
+}
+
+void StreamRing::destroy()
+{
+	for (size_t i = 0; i < fences.size(); i++)
+		if (fences[i])
+			glDeleteSync(fences[i]);
+	fences.clear();
+
+	if (ringBuffer)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &ringBuffer);
+	}
+	ringBuffer = 0;
+	mapped = NULL;
+	inFrame = false;
+}
+
+void StreamRing::beginFrame()
+{
+	if (!ringBuffer || inFrame)
+		return;
+
+	frameIndex = (frameIndex + 1) % fences.size();
+	used = 0;
+	inFrame = true;
+	resetStats(current);
+
+	// Der Bereich wurde vor frameCount Frames zuletzt benutzt, meist ist die GPU laengst fertig
+	GLsync& fence = fences[frameIndex];
+	if (!fence)
+		return;
+	GLenum state = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (state == GL_TIMEOUT_EXPIRED)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		do
+			state = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+		while (state == GL_TIMEOUT_EXPIRED);
+		current.fenceWaits = 1;
+		current.waitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	glDeleteSync(fence);
+	fence = 0;
+}
+
+void StreamRing::endFrame()
+{
+	if (!ringBuffer || !inFrame)
+		return;
+
+	fences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	inFrame = false;
+
+	last = current;
+	total.bytes += current.bytes;
+	total.allocations += current.allocations;
+	total.overflows += current.overflows;
+	total.fenceWaits += current.fenceWaits;
+	total.waitMilliseconds += current.waitMilliseconds;
+	if (current.bytes > peakBytes)
+		peakBytes = current.bytes;
+	frames++;
+}
+
+bool StreamRing::allocate(size_t bytes, size_t alignment, StreamRange& range)
+{
+	if (!inFrame)
+		return false;
+
+	size_t start = alignUp(used, alignment);
+	if (start + bytes > frameSize)
+	{
+		current.overflows++;
+		return false;
+	}
+
+	range.buffer = ringBuffer;
+	range.offset = (GLintptr)(frameIndex * frameSize + start);
+	range.size = (GLsizeiptr)bytes;
+	range.data = mapped + range.offset;
+
+	current.bytes += start + bytes - used;
+	current.allocations++;
+	used = start + bytes;
+	return true;
+}
+
+bool StreamRing::allocateUniform(size_t bytes, StreamRange& range)
+{
+	return allocate(bytes, uniformAlignment, range);
+}
+
+bool StreamRing::allocateStorage(size_t bytes, StreamRange& range)
+{
+	return allocate(bytes, storageAlignment, range);
+}
+
+bool StreamRing::allocateVertices(size_t bytes, StreamRange& range)
+{
+	return allocate(bytes, 16, range);
+}
+
+bool StreamRing::upload(const void* data, size_t bytes, size_t alignment, StreamRange& range)
+{
+	if (!allocate(bytes, alignment, range))
+		return false;
+	memcpy(range.data, data, bytes);
+	return true;
+}
+
+void StreamRing::printStats() const
+{
+	if (!ringBuffer)
+		return;
+	printf("Stream ring (%u x %.1f MB): %u frames, avg %.1f KB/frame, peak %.1f KB, %.1f allocations/frame, "
+		"%u fence waits (%.2f ms), %u overflows\n",
+		(unsigned int)fences.size(), frameSize / (1024.0 * 1024.0), frames,
+		frames ? total.bytes / 1024.0 / frames : 0.0, peakBytes / 1024.0,
+		frames ? (double)total.allocations / frames : 0.0, total.fenceWaits, total.waitMilliseconds, total.overflows);
+}
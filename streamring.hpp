@@ -0,0 +1,92 @@
+#ifndef STREAMRING_HPP
+#define STREAMRING_HPP
+
+#include <stddef.h>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Ein Stueck des Rings fuer diesen Frame. data ist dauerhaft gemappt und kann direkt
+// beschrieben werden, die GPU liest es unter buffer/offset.
+struct StreamRange
+{
+	unsigned char* data;
+	GLuint buffer;
+	GLintptr offset;
+	GLsizeiptr size;
+};
+
+// Zaehler eines Frames
+struct StreamStats
+{
+	size_t bytes;             // vergeben, mit Verschnitt durch die Ausrichtung
+	unsigned int allocations;
+	unsigned int overflows;   // kein Platz mehr, der Aufrufer hat seinen alten Weg genommen
+	unsigned int fenceWaits;  // 1, wenn beginFrame auf die GPU warten musste
+	double waitMilliseconds;
+};
+
+// Ein Buffer fuer alles, was jeden Frame neu zur GPU muss (Uniform-Bloecke, Instanz-Matrizen,
+// Objekt-Daten, Eckpunkte), statt pro Aufruf einen Buffer zu verwaisen oder glBufferSubData
+// auf einen Buffer zu machen, den die GPU vielleicht noch liest.
+// Mit glBufferStorage einmal angelegt und dauerhaft gemappt (GL_MAP_PERSISTENT_BIT |
+// GL_MAP_COHERENT_BIT), aufgeteilt in frameCount gleich grosse Bereiche, einer pro Frame.
+// Innerhalb eines Frames wird nur ein Zeiger weitergeschoben. endFrame() setzt einen Fence
+// hinter den Bereich, beginFrame() wartet auf den Fence des Bereichs, den es wiederverwendet;
+// bei drei Bereichen darf die GPU also zwei Frames hinterher sein, ohne dass jemand wartet.
+// Ohne GL 4.4 / ARB_buffer_storage wird nichts angelegt, alle Nutzer bleiben bei ihrem alten Weg.
+class StreamRing
+{
+	GLuint ringBuffer;
+	unsigned char* mapped;
+	size_t frameSize;
+	std::vector<GLsync> fences; // einer pro Bereich, 0 wenn frei
+	size_t frameIndex;
+	size_t used;                // im aktuellen Bereich
+	bool inFrame;
+
+	size_t uniformAlignment;
+	size_t storageAlignment;
+
+	StreamStats current;
+	StreamStats last;           // letzter abgeschlossener Frame
+	StreamStats total;          // Summe seit create()
+	unsigned int frames;
+	size_t peakBytes;
+
+	StreamRing(const StreamRing&);            // nicht kopierbar
+	StreamRing& operator=(const StreamRing&);
+
+public:
+	StreamRing();
+
+	// frameCount Bereiche zu je frameSize Bytes. false ohne GL 4.4 / ARB_buffer_storage.
+	bool create(size_t frameSize, unsigned int frameCount = 3);
+	void destroy();
+	bool created() const { return ringBuffer != 0; }
+
+	// Klammern alles, was in einem Frame vergeben wird. Ausserhalb schlaegt allocate fehl.
+	void beginFrame();
+	void endFrame();
+
+	// false, wenn der Bereich dieses Frames voll ist (oder kein Frame laeuft); der Aufrufer
+	// laedt dann auf seinem alten Weg hoch. alignment muss eine Zweierpotenz sein.
+	bool allocate(size_t bytes, size_t alignment, StreamRange& range);
+	bool allocateUniform(size_t bytes, StreamRange& range); // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	bool allocateStorage(size_t bytes, StreamRange& range); // GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+	bool allocateVertices(size_t bytes, StreamRange& range); // 16 Bytes, reicht fuer alle Attribute
+	// allocate und hineinkopieren
+	bool upload(const void* data, size_t bytes, size_t alignment, StreamRange& range);
+
+	GLuint buffer() const { return ringBuffer; }
+	size_t uniformOffsetAlignment() const { return uniformAlignment; }
+	size_t storageOffsetAlignment() const { return storageAlignment; }
+
+	const StreamStats& frameStats() const { return last; }
+	void printStats() const;
+};
+
+// Der Ring des Programms, leer, bis jemand create() aufruft
+StreamRing& streamRing();
+
+#endif
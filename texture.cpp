@@ -6,9 +6,36 @@
 
 #include <GLFW/glfw3.h>
 
+#include "texture.hpp"
+#include "texturecooker.hpp"
+
 
 GLuint loadBMP_custom(const char * imagepath){
 
+	// Use the cooked BC1 file when it is up to date, cook it if not
+	if (GLEW_EXT_texture_compression_s3tc){
+		CookStats stats;
+		bool fresh = cookedTextureFresh(imagepath);
+		if (!fresh && cookTexture(imagepath, &stats)){
+			printCookStats(imagepath, stats);
+			fresh = true;
+		}
+		if (fresh){
+			GLuint textureID = loadDDS(cookedTexturePath(imagepath).c_str());
+			if (textureID)
+				return textureID;
+		}
+	}
+
+	ImageData image;
+	if (!readBMP(imagepath, image))
+		return 0;
+
+	return createTexture(image);
+}
+
+bool readBMP(const char * imagepath, ImageData & image){
+
 	printf("Reading image %s\n", imagepath);
 
 	// Data read from the header of the BMP file
@@ -16,28 +43,28 @@ GLuint loadBMP_custom(const char * imagepath){
 	unsigned int dataPos;
 	unsigned int imageSize;
 	unsigned int width, height;
-	// Actual RGB data
-	unsigned char * data;
 
 	// Open the file
 	FILE * file = fopen(imagepath,"rb");
-	if (!file)							    {printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); getchar(); return 0;}
+	if (!file)							    {printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); return false;}
 
 	// Read the header, i.e. the 54 first bytes
 
 	// If less than 54 bytes are read, problem
 	if ( fread(header, 1, 54, file)!=54 ){ 
 		printf("Not a correct BMP file\n");
-		return 0;
+		fclose(file);
+		return false;
 	}
 	// A BMP files always begins with "BM"
 	if ( header[0]!='B' || header[1]!='M' ){
 		printf("Not a correct BMP file\n");
-		return 0;
+		fclose(file);
+		return false;
 	}
 	// Make sure this is a 24bpp file
-	if ( *(int*)&(header[0x1E])!=0  )         {printf("Not a correct BMP file\n");    return 0;}
-	if ( *(int*)&(header[0x1C])!=24 )         {printf("Not a correct BMP file\n");    return 0;}
+	if ( *(int*)&(header[0x1E])!=0  )         {printf("Not a correct BMP file\n");    fclose(file); return false;}
+	if ( *(int*)&(header[0x1C])!=24 )         {printf("Not a correct BMP file\n");    fclose(file); return false;}
 
 	// Read the information about the image
 	dataPos    = *(int*)&(header[0x0A]);
@@ -49,15 +76,98 @@ GLuint loadBMP_custom(const char * imagepath){
 	if (imageSize==0)    imageSize=width*height*3; // 3 : one byte for each Red, Green and Blue component
 	if (dataPos==0)      dataPos=54; // The BMP header is done that way
 
-	// Create a buffer
-	data = new unsigned char [imageSize];
-
 	// Read the actual data from the file into the buffer
-	fread(data,1,imageSize,file);
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(imageSize);
+	fseek(file, dataPos, SEEK_SET);
+	size_t read = fread(&image.pixels[0],1,imageSize,file);
 
 	// Everything is in memory now, the file wan be closed
 	fclose (file);
 
+	if (read != imageSize || imageSize < width*height*3){
+		printf("Not a correct BMP file\n");
+		return false;
+	}
+	return true;
+}
+
+bool mapBMP(const char * imagepath, MappedBMP & image, bool prefault){
+
+	if (!image.file.open(imagepath)){
+		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath);
+		return false;
+	}
+
+	const unsigned char * header = (const unsigned char *)image.file.data();
+	if ( image.file.size() < 54 || header[0]!='B' || header[1]!='M' ||
+		*(int*)&(header[0x1E])!=0 || *(short*)&(header[0x1C])!=24 ){
+		printf("Not a correct BMP file\n");
+		image.file.close();
+		return false;
+	}
+
+	unsigned int dataPos = *(unsigned int*)&(header[0x0A]);
+	if (dataPos==0) dataPos=54;
+	image.width    = *(unsigned int*)&(header[0x12]);
+	image.height   = *(unsigned int*)&(header[0x16]);
+	image.rowPitch = (image.width * 3 + 3) & ~3u;
+
+	if ( dataPos > image.file.size() ||
+		(unsigned long long)image.rowPitch * image.height > image.file.size() - dataPos ){
+		printf("Not a correct BMP file\n");
+		image.file.close();
+		return false;
+	}
+	image.pixels = header + dataPos;
+
+	// Touch one byte per page, the OS reads the file in while we are still on this thread
+	if (prefault){
+		volatile unsigned char sum = 0;
+		for (size_t offset = 0; offset < image.file.size(); offset += 4096)
+			sum += header[offset];
+	}
+	return true;
+}
+
+void buildMipmaps(MappedBMP & image){
+
+	image.mipmaps.clear();
+	image.mipmaps.reserve(32); // src points into the previous level
+
+	const unsigned char * src = image.pixels;
+	unsigned int srcWidth = image.width, srcHeight = image.height, srcPitch = image.rowPitch;
+	while (srcWidth > 1 || srcHeight > 1){
+
+		unsigned int width  = srcWidth  > 1 ? srcWidth  / 2 : 1;
+		unsigned int height = srcHeight > 1 ? srcHeight / 2 : 1;
+		unsigned int pitch  = (width * 3 + 3) & ~3u;
+		image.mipmaps.push_back(std::vector<unsigned char>((size_t)pitch * height));
+		unsigned char * dst = &image.mipmaps.back()[0];
+
+		// Average of 2x2 texels; a side of length 1 uses the same texel twice
+		for (unsigned int y = 0; y < height; y++){
+			const unsigned char * row0 = src + (size_t)(2 * y) * srcPitch;
+			const unsigned char * row1 = src + (size_t)(srcHeight > 1 ? 2 * y + 1 : 2 * y) * srcPitch;
+			unsigned char * out = dst + (size_t)y * pitch;
+			for (unsigned int x = 0; x < width; x++){
+				unsigned int x0 = 2 * x * 3;
+				unsigned int x1 = (srcWidth > 1 ? 2 * x + 1 : 2 * x) * 3;
+				for (int c = 0; c < 3; c++)
+					out[x * 3 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+			}
+		}
+
+		src = dst;
+		srcWidth = width;
+		srcHeight = height;
+		srcPitch = pitch;
+	}
+}
+
+GLuint createTexture(const ImageData & image){
+
 	// Create one OpenGL texture
 	GLuint textureID;
 	glGenTextures(1, &textureID);
@@ -66,10 +176,7 @@ GLuint loadBMP_custom(const char * imagepath){
 	glBindTexture(GL_TEXTURE_2D, textureID);
 
 	// Give the image to OpenGL
-	glTexImage2D(GL_TEXTURE_2D, 0,GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
-
-	// OpenGL has now copied the data. Free our own version
-	delete [] data;
+	glTexImage2D(GL_TEXTURE_2D, 0,GL_RGB, image.width, image.height, 0, GL_BGR, GL_UNSIGNED_BYTE, &image.pixels[0]);
 
 	// Poor filtering, or ...
 	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -118,61 +225,93 @@ GLuint loadTGA_glfw(const char * imagepath){
 
 GLuint loadDDS(const char * imagepath){
 
-	unsigned char header[124];
-
-	FILE *fp; 
- 
-	/* try to open the file */ 
-	fp = fopen(imagepath, "rb"); 
-	if (fp == NULL){
-		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath); getchar(); 
+	MappedDDS image;
+	if (!mapDDS(imagepath, image, false))
 		return 0;
+
+	return createTexture(image);
+}
+
+bool mapDDS(const char * imagepath, MappedDDS & image, bool prefault){
+
+	if (!image.file.open(imagepath)){
+		printf("%s could not be opened. Are you in the right directory ? Don't forget to read the FAQ !\n", imagepath);
+		return false;
 	}
-   
-	/* verify the type of file */ 
-	char filecode[4]; 
-	fread(filecode, 1, 4, fp); 
-	if (strncmp(filecode, "DDS ", 4) != 0) { 
-		fclose(fp); 
-		return 0; 
+
+	/* verify the type of file and get the surface desc */ 
+	const unsigned char * file = (const unsigned char *)image.file.data();
+	if (image.file.size() < 128 || strncmp((const char *)file, "DDS ", 4) != 0 || *(unsigned int*)&(file[4]) != 124){
+		printf("Not a correct DDS file\n");
+		image.file.close();
+		return false;
 	}
-	
-	/* get the surface desc */ 
-	fread(&header, 124, 1, fp); 
+	const unsigned char * header = file + 4;
 
-	unsigned int height      = *(unsigned int*)&(header[8 ]);
-	unsigned int width	     = *(unsigned int*)&(header[12]);
-	unsigned int linearSize	 = *(unsigned int*)&(header[16]);
-	unsigned int mipMapCount = *(unsigned int*)&(header[24]);
+	unsigned int flags       = *(unsigned int*)&(header[4 ]);
+	image.height             = *(unsigned int*)&(header[8 ]);
+	image.width              = *(unsigned int*)&(header[12]);
+	image.mipMapCount        = *(unsigned int*)&(header[24]);
+	unsigned int formatFlags = *(unsigned int*)&(header[76]);
 	unsigned int fourCC      = *(unsigned int*)&(header[80]);
 
- 
-	unsigned char * buffer;
-	unsigned int bufsize;
-	/* how big is it going to be including all mipmaps? */ 
-	bufsize = mipMapCount > 1 ? linearSize * 2 : linearSize; 
-	buffer = (unsigned char*)malloc(bufsize * sizeof(unsigned char)); 
-	fread(buffer, 1, bufsize, fp); 
-	/* close the file pointer */ 
-	fclose(fp);
-
-	unsigned int components  = (fourCC == FOURCC_DXT1) ? 3 : 4; 
-	unsigned int format;
-	switch(fourCC) 
+	switch(formatFlags & 0x4 ? fourCC : 0) // DDPF_FOURCC
 	{ 
 	case FOURCC_DXT1: 
-		format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; 
+		image.format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; 
 		break; 
 	case FOURCC_DXT3: 
-		format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; 
+		image.format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; 
 		break; 
 	case FOURCC_DXT5: 
-		format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; 
+		image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; 
 		break; 
 	default: 
-		free(buffer); 
-		return 0; 
+		printf("%s: only DXT1, DXT3 and DXT5 are supported\n", imagepath);
+		image.file.close();
+		return false; 
+	}
+	image.blockSize = (image.format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
+
+	// Without DDSD_MIPMAPCOUNT the field is undefined and there is only level 0
+	if (!(flags & 0x20000) || image.mipMapCount == 0) image.mipMapCount = 1;
+
+	unsigned int fullChain = 1;
+	while (fullChain < 32 && ((image.width >> fullChain) || (image.height >> fullChain))) fullChain++;
+	if (image.width == 0 || image.height == 0 || image.mipMapCount > fullChain){
+		printf("%s: %ux%u with %u mipmaps is not a valid DDS chain\n", imagepath, image.width, image.height, image.mipMapCount);
+		image.file.close();
+		return false;
+	}
+
+	/* how big is it going to be including all mipmaps? */ 
+	unsigned long long offset = 128;
+	unsigned int width = image.width, height = image.height;
+	for (unsigned int level = 0; level < image.mipMapCount; ++level){
+		unsigned long long size = (unsigned long long)((width+3)/4)*((height+3)/4)*image.blockSize;
+		if (size > image.file.size() - offset){
+			printf("%s is truncated: level %u needs %llu bytes, %llu left\n", imagepath, level, size,
+				(unsigned long long)(image.file.size() - offset));
+			image.file.close();
+			return false;
+		}
+		image.levels[level] = file + offset;
+		image.levelBytes[level] = (unsigned int)size;
+		offset += size;
+		width  = width  > 1 ? width  / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	// Touch one byte per page, like mapBMP
+	if (prefault){
+		volatile unsigned char sum = 0;
+		for (size_t page = 0; page < image.file.size(); page += 4096)
+			sum += file[page];
 	}
+	return true;
+}
+
+GLuint createTexture(const MappedDDS & image){
 
 	// Create one OpenGL texture
 	GLuint textureID;
@@ -180,19 +319,15 @@ GLuint loadDDS(const char * imagepath){
 
 	// "Bind" the newly created texture : all future texture functions will modify this texture
 	glBindTexture(GL_TEXTURE_2D, textureID);
-	glPixelStorei(GL_UNPACK_ALIGNMENT,1);	
 	
-	unsigned int blockSize = (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16; 
-	unsigned int offset = 0;
+	unsigned int width = image.width, height = image.height;
 
 	/* load the mipmaps */ 
-	for (unsigned int level = 0; level < mipMapCount && (width || height); ++level) 
+	for (unsigned int level = 0; level < image.mipMapCount; ++level) 
 	{ 
-		unsigned int size = ((width+3)/4)*((height+3)/4)*blockSize; 
-		glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height,  
-			0, size, buffer + offset); 
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, image.format, width, height,  
+			0, image.levelBytes[level], image.levels[level]); 
 	 
-		offset += size; 
 		width  /= 2; 
 		height /= 2; 
 
@@ -202,7 +337,12 @@ GLuint loadDDS(const char * imagepath){
 
 	} 
 
-	free(buffer); 
+	// Same filtering as the BMP path. A chain that stops early is still complete with MAX_LEVEL.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); 
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.mipMapCount - 1);
 
 	return textureID;
-}
\ No newline at end of file
+}
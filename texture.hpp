@@ -1,9 +1,49 @@
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 
-// Load a .BMP file using our custom loader
+#include <vector>
+
+#include "mappedfile.hpp"
+
+// Decoded 24 bit image, rows bottom-up in BGR order as stored in the BMP file
+struct ImageData
+{
+	unsigned int width;
+	unsigned int height;
+	std::vector<unsigned char> pixels;
+};
+
+// Load a .BMP file using our custom loader.
+// If the driver supports S3TC, the image is compressed once by the texture cooker and
+// the .DDS file next to it is loaded instead (see texturecooker.hpp).
 GLuint loadBMP_custom(const char * imagepath);
 
+// The two halves of loadBMP_custom. readBMP does not touch OpenGL and may run on
+// any thread, createTexture must be called on the thread that owns the context.
+bool readBMP(const char * imagepath, ImageData & image);
+GLuint createTexture(const ImageData & image);
+
+// 24 bit BMP whose pixel rows stay in the memory mapping (see TextureStreamer).
+// Rows are bottom-up in BGR order, each padded to rowPitch bytes (a multiple of 4).
+struct MappedBMP
+{
+	MappedFile file;
+	unsigned int width;
+	unsigned int height;
+	unsigned int rowPitch;
+	const unsigned char * pixels;
+
+	// Levels 1 and up from buildMipmaps, same row layout, each level half the size of the previous one
+	std::vector< std::vector<unsigned char> > mipmaps;
+};
+
+// Maps the file and checks the header. With prefault the pages are read once, so that
+// later copies out of the mapping do not wait for the disk (useful on a worker thread).
+bool mapBMP(const char * imagepath, MappedBMP & image, bool prefault);
+
+// Box-filters the whole mipmap chain on the CPU, so that glGenerateMipmap is not needed
+void buildMipmaps(MappedBMP & image);
+
 // Load a .TGA file using GLFW's own loader
 // Geht nicht mehr ab GLFW3
 //GLuint loadTGA_glfw(const char * imagepath);
@@ -11,5 +51,26 @@ GLuint loadBMP_custom(const char * imagepath);
 // Load a .DDS file using GLFW's own loader
 GLuint loadDDS(const char * imagepath);
 
+// DXT1/3/5 file whose mipmap chain stays in the memory mapping (see TextureStreamer).
+// Each level is a tightly packed run of 4x4 blocks, level 0 first.
+struct MappedDDS
+{
+	MappedFile file;
+	unsigned int width;
+	unsigned int height;
+	unsigned int mipMapCount;
+	GLenum format;
+	unsigned int blockSize; // 8 bytes per block for DXT1, 16 for DXT3/5
+	const unsigned char * levels[32];
+	unsigned int levelBytes[32];
+};
+
+// Maps the file and checks the header. The size of every level is computed from the
+// dimensions (linearSize is not trusted) and the whole chain must lie inside the file.
+bool mapDDS(const char * imagepath, MappedDDS & image, bool prefault);
+
+// Uploads all levels at once, the other half of loadDDS
+GLuint createTexture(const MappedDDS & image);
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,615 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+// Wie in frustum.cpp: SSE2 ist bei x64 immer und bei MSVC x86 mit /arch:SSE2 (Standard) da
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURECOOKER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <GL/glew.h>
+
+#include "texture.hpp"
+#include "texturecooker.hpp"
+#include "parallel.hpp"
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Mipmaps im linearen Farbraum
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Die Bilder sind sRGB-kodiert. Ein Mittelwert der kodierten Werte macht die kleinen
+// Level zu dunkel, deshalb wird vor dem Filtern linearisiert und danach wieder kodiert.
+struct GammaTables
+{
+	float toLinear[256];
+	unsigned char toSrgb[4096]; // Index = linearer Wert * 4095
+
+	GammaTables()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			toLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < 4096; i++)
+		{
+			float c = i / 4095.0f;
+			float s = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+			toSrgb[i] = (unsigned char)(s * 255.0f + 0.5f);
+		}
+	}
+};
+
+const GammaTables& gammaTables()
+{
+	static const GammaTables tables;
+	return tables;
+}
+
+size_t cookerThreads()
+{
+	unsigned int threads = std::thread::hardware_concurrency();
+	return threads ? threads : 1;
+}
+
+// 2x2-Mittelwert wie buildMipmaps, aber linear; eine Seite der Laenge 1 nimmt dasselbe Texel zweimal
+void downsample(const unsigned char* src, unsigned int srcWidth, unsigned int srcHeight,
+	std::vector<unsigned char>& dst, unsigned int width, unsigned int height)
+{
+	const GammaTables& gamma = gammaTables();
+	dst.resize((size_t)width * height * 4);
+
+	parallelFor(height, cookerThreads(), [&](size_t first, size_t last)
+	{
+		for (size_t y = first; y < last; y++)
+		{
+			const unsigned char* row0 = src + (size_t)(2 * y) * srcWidth * 4;
+			const unsigned char* row1 = src + (size_t)(srcHeight > 1 ? 2 * y + 1 : 2 * y) * srcWidth * 4;
+			unsigned char* out = &dst[y * width * 4];
+			for (unsigned int x = 0; x < width; x++)
+			{
+				unsigned int x0 = 2 * x * 4;
+				unsigned int x1 = (srcWidth > 1 ? 2 * x + 1 : 2 * x) * 4;
+				for (int c = 0; c < 3; c++)
+				{
+					float sum = gamma.toLinear[row0[x0 + c]] + gamma.toLinear[row0[x1 + c]]
+						+ gamma.toLinear[row1[x0 + c]] + gamma.toLinear[row1[x1 + c]];
+					int index = (int)(sum * (4095.0f / 4.0f) + 0.5f);
+					out[x * 4 + c] = gamma.toSrgb[index < 4095 ? index : 4095];
+				}
+				// Alpha ist eine Abdeckung und wird nicht gamma-kodiert
+				out[x * 4 + 3] = (unsigned char)((row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) / 4);
+			}
+		}
+	});
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    BC1/BC3-Blockkodierung
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Endpunkte ueber die Bounding-Box der 16 Farben (wie Waverens "Real-Time DXT Compression"),
+// die Diagonale wird ueber die Kovarianz zur Achse mit dem groessten Umfang gewaehlt.
+// Die Indizes kommen aus der Projektion auf die Strecke zwischen den Endpunkten.
+
+unsigned short pack565(const int color[3])
+{
+	int r = (color[0] * 31 + 127) / 255;
+	int g = (color[1] * 63 + 127) / 255;
+	int b = (color[2] * 31 + 127) / 255;
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+void unpack565(unsigned short packed, int color[3])
+{
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+void writeColorBlock(unsigned char* out, unsigned short c0, unsigned short c1, unsigned int indices)
+{
+	out[0] = (unsigned char)c0; out[1] = (unsigned char)(c0 >> 8);
+	out[2] = (unsigned char)c1; out[3] = (unsigned char)(c1 >> 8);
+	memcpy(out + 4, &indices, 4);
+}
+
+// Minimum und Maximum je Kanal (RGBA) der 16 Texel
+void blockBounds(const unsigned char* block, int minColor[4], int maxColor[4], bool simd)
+{
+#ifdef TEXTURECOOKER_SSE2
+	if (simd)
+	{
+		__m128i v0 = _mm_loadu_si128((const __m128i*)block);
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(block + 16));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(block + 32));
+		__m128i v3 = _mm_loadu_si128((const __m128i*)(block + 48));
+		__m128i mn = _mm_min_epu8(_mm_min_epu8(v0, v1), _mm_min_epu8(v2, v3));
+		__m128i mx = _mm_max_epu8(_mm_max_epu8(v0, v1), _mm_max_epu8(v2, v3));
+		mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(1, 0, 3, 2)));
+		mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(1, 0, 3, 2)));
+		mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(2, 3, 0, 1)));
+		mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(2, 3, 0, 1)));
+		unsigned int packedMin = (unsigned int)_mm_cvtsi128_si32(mn);
+		unsigned int packedMax = (unsigned int)_mm_cvtsi128_si32(mx);
+		for (int c = 0; c < 4; c++)
+		{
+			minColor[c] = (packedMin >> (8 * c)) & 255;
+			maxColor[c] = (packedMax >> (8 * c)) & 255;
+		}
+		return;
+	}
+#endif
+	for (int c = 0; c < 4; c++)
+	{
+		minColor[c] = 255;
+		maxColor[c] = 0;
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int value = block[i * 4 + c];
+			if (value < minColor[c]) minColor[c] = value;
+			if (value > maxColor[c]) maxColor[c] = value;
+		}
+	}
+}
+
+// Position jedes Texels auf der Strecke base -> base + axis, gerundet auf 0..3
+void projectColors(const unsigned char* block, const int base[3], const int axis[3], float scale, short steps[16], bool simd)
+{
+#ifdef TEXTURECOOKER_SSE2
+	if (simd)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i baseVector = _mm_setr_epi16((short)base[0], (short)base[1], (short)base[2], 0,
+			(short)base[0], (short)base[1], (short)base[2], 0);
+		const __m128i axisVector = _mm_setr_epi16((short)axis[0], (short)axis[1], (short)axis[2], 0,
+			(short)axis[0], (short)axis[1], (short)axis[2], 0);
+		const __m128 scaleVector = _mm_set1_ps(scale);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		__m128i quads[4];
+		for (int q = 0; q < 4; q++)
+		{
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(block + q * 16));
+			__m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(pixels, zero), baseVector);
+			__m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(pixels, zero), baseVector);
+
+			// madd liefert je Texel (r*ar + g*ag) und (b*ab + 0), die beiden Haelften noch addieren
+			__m128 productsLo = _mm_castsi128_ps(_mm_madd_epi16(lo, axisVector));
+			__m128 productsHi = _mm_castsi128_ps(_mm_madd_epi16(hi, axisVector));
+			__m128i even = _mm_castps_si128(_mm_shuffle_ps(productsLo, productsHi, _MM_SHUFFLE(2, 0, 2, 0)));
+			__m128i odd  = _mm_castps_si128(_mm_shuffle_ps(productsLo, productsHi, _MM_SHUFFLE(3, 1, 3, 1)));
+			__m128 dot = _mm_cvtepi32_ps(_mm_add_epi32(even, odd));
+			quads[q] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(dot, scaleVector), half));
+		}
+
+		const __m128i three = _mm_set1_epi16(3);
+		__m128i first  = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(quads[0], quads[1]), zero), three);
+		__m128i second = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(quads[2], quads[3]), zero), three);
+		_mm_storeu_si128((__m128i*)steps, first);
+		_mm_storeu_si128((__m128i*)(steps + 8), second);
+		return;
+	}
+#endif
+	for (int i = 0; i < 16; i++)
+	{
+		const unsigned char* pixel = block + i * 4;
+		int dot = (pixel[0] - base[0]) * axis[0] + (pixel[1] - base[1]) * axis[1] + (pixel[2] - base[2]) * axis[2];
+		int step = (int)((float)dot * scale + 0.5f);
+		steps[i] = (short)(step < 0 ? 0 : step > 3 ? 3 : step);
+	}
+}
+
+// 16 Texel RGBA -> 8 Bytes BC1, immer im 4-Farben-Modus (c0 > c1), also ohne Transparenz
+void encodeColorBlock(const unsigned char* block, unsigned char* out, bool simd)
+{
+	int minColor[4], maxColor[4];
+	blockBounds(block, minColor, maxColor, simd);
+
+	int dominant = 0;
+	for (int c = 1; c < 3; c++)
+		if (maxColor[c] - minColor[c] > maxColor[dominant] - minColor[dominant])
+			dominant = c;
+
+	// Faellt ein Kanal, waehrend der dominante steigt, liegt die Diagonale andersherum
+	int sum[3] = { 0, 0, 0 }, product[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			sum[c] += block[i * 4 + c];
+			product[c] += block[i * 4 + c] * block[i * 4 + dominant];
+		}
+	}
+
+	int end0[3], end1[3];
+	for (int c = 0; c < 3; c++)
+	{
+		end0[c] = maxColor[c];
+		end1[c] = minColor[c];
+		if (c != dominant && product[c] * 16 - sum[c] * sum[dominant] < 0)
+		{
+			end0[c] = minColor[c];
+			end1[c] = maxColor[c];
+		}
+
+		// Die Box etwas verkleinern, die Extremwerte liegen selten genau auf der Geraden
+		int inset = (end0[c] - end1[c]) / 16;
+		end0[c] -= inset;
+		end1[c] += inset;
+	}
+
+	unsigned short c0 = pack565(end0), c1 = pack565(end1);
+	if (c0 == c1)
+	{
+		writeColorBlock(out, c0, c1, 0);
+		return;
+	}
+	if (c0 < c1)
+	{
+		unsigned short swap = c0;
+		c0 = c1;
+		c1 = swap;
+	}
+
+	int palette0[3], palette1[3], axis[3];
+	unpack565(c0, palette0);
+	unpack565(c1, palette1);
+	int lengthSquared = 0;
+	for (int c = 0; c < 3; c++)
+	{
+		axis[c] = palette1[c] - palette0[c];
+		lengthSquared += axis[c] * axis[c];
+	}
+
+	short steps[16];
+	projectColors(block, palette0, axis, 3.0f / (float)lengthSquared, steps, simd);
+
+	// Schritt 0..3 von c0 nach c1 -> Palettenindex (0 = c0, 1 = c1, 2 = 2/3 c0, 3 = 1/3 c0)
+	static const unsigned int stepToIndex[4] = { 0, 2, 3, 1 };
+	unsigned int indices = 0;
+	for (int i = 0; i < 16; i++)
+		indices |= stepToIndex[steps[i]] << (2 * i);
+	writeColorBlock(out, c0, c1, indices);
+}
+
+// 16 Texel RGBA -> 8 Bytes BC3-Alpha, immer im 8-Stufen-Modus (a0 > a1)
+void encodeAlphaBlock(const unsigned char* block, unsigned char* out)
+{
+	int minAlpha = 255, maxAlpha = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int alpha = block[i * 4 + 3];
+		if (alpha < minAlpha) minAlpha = alpha;
+		if (alpha > maxAlpha) maxAlpha = alpha;
+	}
+
+	out[0] = (unsigned char)maxAlpha;
+	out[1] = (unsigned char)minAlpha;
+	unsigned long long indices = 0;
+	int range = maxAlpha - minAlpha;
+	if (range > 0)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			// Schritt 0..7 von a1 nach a0; Index 0 = a0, 1 = a1, k = 2..7 liegt bei Schritt 8 - k
+			int step = ((block[i * 4 + 3] - minAlpha) * 7 + range / 2) / range;
+			unsigned long long index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+			indices |= index << (3 * i);
+		}
+	}
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+void compressLevel(const unsigned char* rgba, unsigned int width, unsigned int height, bool alpha,
+	std::vector<unsigned char>& out, bool simd)
+{
+	unsigned int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	unsigned int blockSize = alpha ? 16 : 8;
+	out.resize((size_t)blocksX * blocksY * blockSize);
+
+	parallelFor(blocksY, cookerThreads(), [&](size_t first, size_t last)
+	{
+		unsigned char block[64];
+		for (size_t by = first; by < last; by++)
+		{
+			for (unsigned int bx = 0; bx < blocksX; bx++)
+			{
+				// Randbloecke mit dem letzten Texel auffuellen, die Luecke wird nie gesampelt
+				for (unsigned int y = 0; y < 4; y++)
+				{
+					unsigned int sy = (unsigned int)by * 4 + y;
+					if (sy >= height) sy = height - 1;
+					for (unsigned int x = 0; x < 4; x++)
+					{
+						unsigned int sx = bx * 4 + x;
+						if (sx >= width) sx = width - 1;
+						memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+					}
+				}
+
+				unsigned char* dst = &out[(by * blocksX + bx) * blockSize];
+				if (alpha)
+				{
+					encodeAlphaBlock(block, dst);
+					dst += 8;
+				}
+				encodeColorBlock(block, dst, simd);
+			}
+		}
+	});
+}
+
+// Farben eines BC1-Blocks (bzw. des Farbteils von BC3) zurueck nach RGB, fuer den PSNR
+void decodeColorBlock(const unsigned char* in, unsigned char rgb[16][3])
+{
+	unsigned short c0 = (unsigned short)(in[0] | (in[1] << 8));
+	unsigned short c1 = (unsigned short)(in[2] | (in[3] << 8));
+	unsigned int indices;
+	memcpy(&indices, in + 4, 4);
+
+	int palette[4][3];
+	unpack565(c0, palette[0]);
+	unpack565(c1, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		if (c0 > c1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			rgb[i][c] = (unsigned char)palette[(indices >> (2 * i)) & 3][c];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    DDS-Datei
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Steht in dwReserved1 des DDS-Headers, andere Programme ignorieren das Feld
+struct CookerStamp
+{
+	char magic[4];                 // "ANTC"
+	unsigned int version;          // TEXTURECOOKER_VERSION
+	unsigned long long sourceSize; // Stempel der Quelldatei, aus der die DDS-Datei erzeugt wurde
+	unsigned long long sourceTime;
+};
+
+const char cookerMagic[4] = { 'A', 'N', 'T', 'C' };
+const unsigned int ddsHeaderSize = 124;
+const unsigned int ddsStampOffset = 28;
+
+bool readStamp(const std::string& path, CookerStamp& stamp)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+
+	unsigned char header[4 + ddsHeaderSize];
+	bool ok = fread(header, sizeof(header), 1, file) == 1 && memcmp(header, "DDS ", 4) == 0;
+	fclose(file);
+
+	memcpy(&stamp, header + 4 + ddsStampOffset, sizeof(stamp));
+	return ok && memcmp(stamp.magic, cookerMagic, 4) == 0 && stamp.version == TEXTURECOOKER_VERSION;
+}
+
+bool writeDDS(const std::string& path, const CompressedImage& image, const CookerStamp& stamp)
+{
+	unsigned int header[ddsHeaderSize / 4];
+	memset(header, 0, sizeof(header));
+	header[0] = ddsHeaderSize;
+	header[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // CAPS, HEIGHT, WIDTH, PIXELFORMAT, MIPMAPCOUNT, LINEARSIZE
+	header[2] = image.height;
+	header[3] = image.width;
+	header[4] = (unsigned int)image.levels[0].size();
+	header[6] = (unsigned int)image.levels.size();
+	memcpy((char*)header + ddsStampOffset, &stamp, sizeof(stamp));
+	header[18] = 32;          // Groesse des Pixelformats
+	header[19] = 0x4;         // DDPF_FOURCC
+	memcpy(&header[20], image.alpha ? "DXT5" : "DXT1", 4);
+	header[26] = 0x1000 | 0x400000 | 0x8; // TEXTURE, MIPMAP, COMPLEX
+
+	// Erst in eine temporaere Datei schreiben, damit ein Abbruch keine halbe Textur hinterlaesst
+	std::string tempPath = path + ".tmp";
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (!file)
+	{
+		printf("Could not write %s\n", path.c_str());
+		return false;
+	}
+
+	bool ok = fwrite("DDS ", 4, 1, file) == 1 && fwrite(header, sizeof(header), 1, file) == 1;
+	for (size_t i = 0; ok && i < image.levels.size(); i++)
+		ok = fwrite(&image.levels[i][0], image.levels[i].size(), 1, file) == 1;
+	ok = fclose(file) == 0 && ok;
+
+	remove(path.c_str()); // rename ueberschreibt unter Windows nicht
+	if (!ok || rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		printf("Could not write %s\n", path.c_str());
+		remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+std::string cookedTexturePath(const char* imagepath)
+{
+	std::string path(imagepath);
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		path.erase(dot);
+	return path + ".dds";
+}
+
+bool cookedTextureFresh(const char* imagepath)
+{
+	CookerStamp stamp;
+	if (!readStamp(cookedTexturePath(imagepath), stamp))
+		return false;
+
+	// Ohne Quelldatei (nur die DDS-Datei ausgeliefert) wird sie ungeprueft verwendet
+	unsigned long long size, time;
+	return !getFileStamp(imagepath, size, time) || (size == stamp.sourceSize && time == stamp.sourceTime);
+}
+
+bool loadImageRGBA(const char* imagepath, std::vector<unsigned char>& rgba, unsigned int& width, unsigned int& height)
+{
+	MappedBMP bmp;
+	if (!mapBMP(imagepath, bmp, false))
+		return false;
+
+	width = bmp.width;
+	height = bmp.height;
+	rgba.resize((size_t)width * height * 4);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const unsigned char* in = bmp.pixels + (size_t)y * bmp.rowPitch;
+		unsigned char* out = &rgba[(size_t)y * width * 4];
+		for (unsigned int x = 0; x < width; x++)
+		{
+			out[x * 4 + 0] = in[x * 3 + 2];
+			out[x * 4 + 1] = in[x * 3 + 1];
+			out[x * 4 + 2] = in[x * 3 + 0];
+			out[x * 4 + 3] = 255;
+		}
+	}
+	return true;
+}
+
+void compressImage(const unsigned char* rgba, unsigned int width, unsigned int height, bool alpha,
+	CompressedImage& image, bool simd)
+{
+	image.width = width;
+	image.height = height;
+	image.alpha = alpha;
+	image.levels.clear();
+
+	std::vector<unsigned char> current, next;
+	const unsigned char* src = rgba;
+	for (;;)
+	{
+		image.levels.push_back(std::vector<unsigned char>());
+		compressLevel(src, width, height, alpha, image.levels.back(), simd);
+		if (width == 1 && height == 1)
+			break;
+
+		unsigned int nextWidth  = width  > 1 ? width  / 2 : 1;
+		unsigned int nextHeight = height > 1 ? height / 2 : 1;
+		downsample(src, width, height, next, nextWidth, nextHeight);
+		current.swap(next);
+		src = &current[0];
+		width = nextWidth;
+		height = nextHeight;
+	}
+}
+
+double computePSNR(const unsigned char* rgba, const CompressedImage& image)
+{
+	unsigned int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+	unsigned int blockSize = image.alpha ? 16 : 8;
+	const std::vector<unsigned char>& level = image.levels[0];
+
+	double squaredError = 0.0;
+	for (unsigned int by = 0; by < blocksY; by++)
+	{
+		for (unsigned int bx = 0; bx < blocksX; bx++)
+		{
+			unsigned char decoded[16][3];
+			decodeColorBlock(&level[(by * blocksX + bx) * blockSize + (image.alpha ? 8 : 0)], decoded);
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				unsigned int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+				if (x >= image.width || y >= image.height)
+					continue;
+				const unsigned char* original = rgba + ((size_t)y * image.width + x) * 4;
+				for (int c = 0; c < 3; c++)
+				{
+					int difference = decoded[i][c] - original[c];
+					squaredError += difference * difference;
+				}
+			}
+		}
+	}
+
+	double mse = squaredError / ((double)image.width * image.height * 3);
+	if (mse <= 0.0)
+		return 99.0; // verlustfrei, z. B. einfarbig
+	return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+bool cookTexture(const char* imagepath, CookStats* stats)
+{
+	CookerStamp stamp;
+	memcpy(stamp.magic, cookerMagic, 4);
+	stamp.version = TEXTURECOOKER_VERSION;
+	if (!getFileStamp(imagepath, stamp.sourceSize, stamp.sourceTime))
+		return false;
+
+	std::vector<unsigned char> rgba;
+	unsigned int width, height;
+	if (!loadImageRGBA(imagepath, rgba, width, height) || width == 0 || height == 0)
+		return false;
+
+	// Ein 24-Bit-BMP hat kein Alpha, also immer BC1
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	CompressedImage image;
+	compressImage(&rgba[0], width, height, false, image);
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	if (!writeDDS(cookedTexturePath(imagepath), image, stamp))
+		return false;
+
+	if (stats)
+	{
+		stats->width = width;
+		stats->height = height;
+		stats->levels = (unsigned int)image.levels.size();
+		stats->alpha = image.alpha;
+		stats->seconds = seconds;
+		stats->psnr = computePSNR(&rgba[0], image);
+		stats->uncompressedBytes = 0;
+		stats->compressedBytes = 0;
+		unsigned long long texels = 0;
+		for (unsigned int i = 0; i < stats->levels; i++)
+		{
+			unsigned long long levelWidth = width >> i ? width >> i : 1;
+			unsigned long long levelHeight = height >> i ? height >> i : 1;
+			texels += levelWidth * levelHeight;
+			stats->compressedBytes += image.levels[i].size();
+		}
+		stats->uncompressedBytes = texels * 4;
+		stats->megapixelsPerSecond = seconds > 0.0 ? texels / seconds / 1e6 : 0.0;
+	}
+	return true;
+}
+
+void printCookStats(const char* name, const CookStats& stats)
+{
+	printf("Cooked %s: %ux%u, %s, %u levels, %.1f ms (%.1f MPix/s), PSNR %.2f dB, VRAM %llu KB -> %llu KB\n",
+		name, stats.width, stats.height, stats.alpha ? "BC3" : "BC1", stats.levels,
+		stats.seconds * 1000.0, stats.megapixelsPerSecond, stats.psnr,
+		stats.uncompressedBytes / 1024, stats.compressedBytes / 1024);
+}
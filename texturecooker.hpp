@@ -0,0 +1,58 @@
+#ifndef TEXTURECOOKER_HPP
+#define TEXTURECOOKER_HPP
+
+#include <string>
+#include <vector>
+
+// Texture-Cooker: komprimiert Bilder nach BC1 (DXT1) bzw. mit Alpha nach BC3 (DXT5),
+// samt gammakorrekter Mipmap-Kette, und schreibt eine .dds-Datei, die loadDDS lesen kann.
+// Der Block-Encoder nutzt SSE2, jedes Level wird auf alle Kerne verteilt.
+// Die Zeilen bleiben in der Reihenfolge der Quelle (bei BMP von unten nach oben), damit
+// die komprimierte Textur genauso liegt wie die von loadBMP_custom.
+
+#define TEXTURECOOKER_VERSION 1
+
+// Komprimierte Mipmap-Kette, Level 0 zuerst
+struct CompressedImage
+{
+	unsigned int width;
+	unsigned int height;
+	bool alpha; // BC3 statt BC1
+	std::vector< std::vector<unsigned char> > levels;
+};
+
+struct CookStats
+{
+	unsigned int width;
+	unsigned int height;
+	unsigned int levels;
+	bool alpha;
+	double seconds;             // Mipmaps und Kompression, ohne Datei-I/O
+	double megapixelsPerSecond; // Texel aller Level pro Sekunde
+	double psnr;                // Level 0, RGB, in dB
+	unsigned long long uncompressedBytes; // 4 Bytes pro Texel (GL_RGB liegt als RGBA8 im Speicher), mit Mipmaps
+	unsigned long long compressedBytes;
+};
+
+// "mandrill.bmp" -> "mandrill.dds"
+std::string cookedTexturePath(const char* imagepath);
+
+// true, wenn die .dds-Datei zu genau dieser Quelldatei (Groesse und Aenderungszeit) gehoert
+bool cookedTextureFresh(const char* imagepath);
+
+// Komprimiert ein 24-Bit-BMP und schreibt cookedTexturePath(imagepath). stats darf NULL sein.
+bool cookTexture(const char* imagepath, CookStats* stats);
+
+// Liest ein 24-Bit-BMP als RGBA (Alpha 255), die Zeilen bleiben von unten nach oben
+bool loadImageRGBA(const char* imagepath, std::vector<unsigned char>& rgba, unsigned int& width, unsigned int& height);
+
+// rgba: width * height Texel mit je 4 Bytes. simd = false erzwingt den skalaren Encoder (zum Vergleich).
+void compressImage(const unsigned char* rgba, unsigned int width, unsigned int height, bool alpha,
+	CompressedImage& image, bool simd = true);
+
+// Dekomprimiert Level 0 und vergleicht es mit dem Original (nur RGB)
+double computePSNR(const unsigned char* rgba, const CompressedImage& image);
+
+void printCookStats(const char* name, const CookStats& stats);
+
+#endif
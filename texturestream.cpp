@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "texturestream.hpp"
+#include "texture.hpp"
+
+// DDS-Level bis zu dieser Kantenlaenge laedt stream() sofort, zusammen nur wenige KB
+static const unsigned int immediateLevelSize = 64;
+
+static unsigned int levelSize(unsigned int size, unsigned int level)
+{
+	size >>= level;
+	return size ? size : 1;
+}
+
+TextureStreamer::TextureStreamer()
+	: buffer(0), persistentData(NULL), slotSize(0), nextSlot(0), bytesUploaded(0), slicesUploaded(0), slotStalls(0)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// OpenGL-Objekte gibt destroy() frei, hier nur noch die Quellen
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		delete jobs[i].source;
+		delete jobs[i].compressed;
+	}
+}
+
+void TextureStreamer::create(size_t size, unsigned int slotCount)
+{
+	destroy();
+
+	slotSize = size;
+	fences.assign(slotCount, (GLsync)0);
+	nextSlot = 0;
+	bytesUploaded = 0;
+	slicesUploaded = 0;
+	slotStalls = 0;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	GLsizeiptr total = (GLsizeiptr)(slotSize * slotCount);
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+	{
+		// Einmal mappen und das Mapping behalten. Coherent: kein Flush noetig, die Fences reichen.
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, total, NULL, flags);
+		persistentData = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, total, flags);
+	}
+	else
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, total, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::destroy()
+{
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		if (!jobs[i].compressed) // DDS-Texturen gehoeren schon dem Aufrufer
+			glDeleteTextures(1, &jobs[i].texture);
+		delete jobs[i].source;
+		delete jobs[i].compressed;
+	}
+	jobs.clear();
+
+	for (size_t i = 0; i < fences.size(); i++)
+		if (fences[i])
+			glDeleteSync(fences[i]);
+	fences.clear();
+
+	if (buffer)
+	{
+		if (persistentData)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &buffer);
+	}
+	buffer = 0;
+	persistentData = NULL;
+}
+
+GLuint TextureStreamer::stream(MappedBMP* source)
+{
+	Job job;
+	job.source = source;
+	job.compressed = NULL;
+	job.level = 0;
+	job.nextRow = 0;
+
+	// Nur Speicher anlegen, der Inhalt kommt streifenweise. Alle Level auf einmal: ein spaeter
+	// hinzukommendes Level laesst manche Treiber die ganze Textur umkopieren.
+	GLsizei levels = (GLsizei)source->mipmaps.size() + 1;
+	glGenTextures(1, &job.texture);
+	glBindTexture(GL_TEXTURE_2D, job.texture);
+	if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGB8, source->width, source->height);
+	}
+	else
+	{
+		for (GLsizei level = 0; level < levels; level++)
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGB8, levelSize(source->width, level), levelSize(source->height, level),
+				0, GL_BGR, GL_UNSIGNED_BYTE, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0); // bis alle Level da sind
+
+	jobs.push_back(job);
+	return job.texture;
+}
+
+GLuint TextureStreamer::stream(MappedDDS* source)
+{
+	GLuint texture;
+	GLsizei levels = (GLsizei)source->mipMapCount;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levels, source->format, source->width, source->height);
+	}
+	else
+	{
+		for (GLsizei level = 0; level < levels; level++)
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, source->format, levelSize(source->width, level),
+				levelSize(source->height, level), 0, source->levelBytes[level], NULL);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+	// Die kleinen Level direkt aus dem Mapping (ausserhalb von update ist kein PBO gebunden),
+	// mindestens das kleinste, damit die Textur vollstaendig ist
+	GLsizei level = levels;
+	do
+	{
+		level--;
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelSize(source->width, level), levelSize(source->height, level),
+			source->format, source->levelBytes[level], source->levels[level]);
+		bytesUploaded += source->levelBytes[level];
+		slicesUploaded++;
+	} while (level > 0 && levelSize(source->width, level - 1) <= immediateLevelSize
+		&& levelSize(source->height, level - 1) <= immediateLevelSize);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+
+	if (level == 0)
+	{
+		delete source;
+		return texture;
+	}
+
+	Job job;
+	job.source = NULL;
+	job.compressed = source;
+	job.texture = texture;
+	job.level = level - 1;
+	job.nextRow = 0;
+	jobs.push_back(job);
+	return texture;
+}
+
+bool TextureStreamer::slotFree(size_t slot)
+{
+	if (!fences[slot])
+		return true;
+
+	GLenum state = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+		return false;
+
+	glDeleteSync(fences[slot]);
+	fences[slot] = 0;
+	return true;
+}
+
+void TextureStreamer::update(size_t byteBudget)
+{
+	if (jobs.empty() || fences.empty())
+		return;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4); // BMP-Zeilen sind auf 4 Bytes aufgefuellt
+
+	size_t uploaded = 0;
+	while (!jobs.empty() && uploaded < byteBudget)
+	{
+		Job& job = jobs.front();
+
+		if (!slotFree(nextSlot))
+		{
+			slotStalls++;
+			break;
+		}
+
+		// Aktuelles Level als Folge gleich langer Zeilen: Texelzeilen beim BMP (Level 0 liegt
+		// im Mapping, die anderen in source->mipmaps), Zeilen aus 4x4-Bloecken bei DDS
+		unsigned int width, height, rowCount;
+		size_t pitch;
+		const unsigned char* pixels;
+		if (job.compressed)
+		{
+			const MappedDDS& source = *job.compressed;
+			width = levelSize(source.width, job.level);
+			height = levelSize(source.height, job.level);
+			rowCount = (height + 3) / 4;
+			pitch = (size_t)((width + 3) / 4) * source.blockSize;
+			pixels = source.levels[job.level];
+		}
+		else
+		{
+			const MappedBMP& source = *job.source;
+			width = levelSize(source.width, job.level);
+			height = levelSize(source.height, job.level);
+			rowCount = height;
+			pitch = (width * 3 + 3) & ~3u;
+			pixels = job.level == 0 ? source.pixels : &source.mipmaps[job.level - 1][0];
+		}
+
+		// So viele ganze Zeilen, wie in den Platz und ins Budget passen, mindestens eine
+		size_t rowsPerSlot = slotSize / pitch;
+		size_t rowsInBudget = (byteBudget - uploaded) / pitch;
+		size_t rows = rowCount - job.nextRow;
+		if (rows > rowsPerSlot) rows = rowsPerSlot;
+		if (rows > rowsInBudget) rows = rowsInBudget;
+		if (rows == 0) rows = 1;
+
+		size_t bytes = rows * pitch;
+		const unsigned char* src = pixels + (size_t)job.nextRow * pitch;
+		glBindTexture(GL_TEXTURE_2D, job.texture);
+
+		// data ist ein Zeiger in den Speicher oder ein Offset in den gebundenen Buffer
+		auto upload = [&](const void* data)
+		{
+			if (job.compressed)
+			{
+				// Bei komprimierten Texturen muss der Streifen auf 4 Texel ausgerichtet sein oder am Rand enden
+				unsigned int y = job.nextRow * 4;
+				unsigned int rowsInTexels = (unsigned int)rows * 4;
+				if (rowsInTexels > height - y) rowsInTexels = height - y;
+				glCompressedTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, width, rowsInTexels, job.compressed->format,
+					(GLsizei)bytes, data);
+			}
+			else
+			{
+				glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, job.nextRow, width, (GLsizei)rows, GL_BGR, GL_UNSIGNED_BYTE, data);
+			}
+		};
+
+		if (bytes > slotSize)
+		{
+			// Eine Zeile groesser als ein Platz: direkt aus dem Speicher
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			upload(src);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		}
+		else
+		{
+			size_t offset = nextSlot * slotSize;
+			if (persistentData)
+			{
+				memcpy(persistentData + offset, src, bytes);
+			}
+			else
+			{
+				// Der Fence hat schon gesagt, dass der Platz frei ist, also nicht synchronisieren
+				void* data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes,
+					GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+				memcpy(data, src, bytes);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+
+			upload((void*)offset);
+			fences[nextSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			nextSlot = (nextSlot + 1) % fences.size();
+		}
+
+		job.nextRow += (unsigned int)rows;
+		uploaded += bytes;
+		bytesUploaded += bytes;
+		slicesUploaded++;
+
+		if (job.nextRow >= rowCount)
+		{
+			job.nextRow = 0;
+			if (!nextLevel(job))
+			{
+				finish(job);
+				jobs.pop_front();
+			}
+		}
+	}
+
+	// Sonst wuerden spaetere glTexImage2D-Aufrufe ihren Zeiger als Offset in den Buffer deuten
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool TextureStreamer::nextLevel(Job& job)
+{
+	if (!job.compressed)
+		return ++job.level <= job.source->mipmaps.size();
+
+	// Das gerade fertige Level ist jetzt das groesste benutzbare
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.level);
+	if (job.level == 0)
+		return false;
+	job.level--;
+	return true;
+}
+
+void TextureStreamer::finish(Job& job)
+{
+	if (job.compressed)
+	{
+		// Filter und Level-Grenzen hat stream() schon gesetzt
+		delete job.compressed;
+		job.compressed = NULL;
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, job.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	if (job.source->mipmaps.empty())
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	else
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)job.source->mipmaps.size());
+	}
+
+	delete job.source;
+	job.source = NULL;
+}
+
+bool TextureStreamer::isStreaming(GLuint texture) const
+{
+	for (size_t i = 0; i < jobs.size(); i++)
+		if (jobs[i].texture == texture)
+			return true;
+	return false;
+}
+
+void TextureStreamer::printStats() const
+{
+	printf("Texture streaming (%s): %.1f MB in %u slices, %u frames waited for a ring slot\n",
+		persistentData ? "persistent mapping" : "glMapBufferRange", bytesUploaded / (1024.0 * 1024.0), slicesUploaded,
+		slotStalls);
+}
@@ -0,0 +1,75 @@
+#ifndef TEXTURESTREAM_HPP
+#define TEXTURESTREAM_HPP
+
+#include <deque>
+#include <vector>
+
+struct MappedBMP;
+struct MappedDDS;
+
+// Laedt Texturen in Zeilenstreifen ueber mehrere Frames hoch, damit grosse Bilder keinen
+// Frame blockieren. Die Zeilen werden aus der gemappten Datei in einen Ring von
+// Pixel-Unpack-Buffern kopiert (mit GL 4.4 / ARB_buffer_storage dauerhaft gemappt,
+// sonst pro Streifen mit glMapBufferRange) und von dort mit glTexSubImage2D uebertragen.
+// Ein Fence pro Ringplatz sagt, wann die GPU mit dem Platz fertig ist.
+// DDS-Dateien laufen umgekehrt: die kleinen Level sofort, die grossen danach in Blockzeilen,
+// BASE_LEVEL zeigt dabei immer auf das groesste fertige Level. So ist die Textur sofort benutzbar.
+class TextureStreamer
+{
+	struct Job
+	{
+		MappedBMP* source;     // gehoert dem Job, NULL bei DDS
+		MappedDDS* compressed; // gehoert dem Job, NULL bei BMP
+		GLuint texture;
+		unsigned int level;   // BMP: 0 aus dem Mapping, ab 1 aus source->mipmaps, aufsteigend; DDS: absteigend
+		unsigned int nextRow; // bei DDS in Blockzeilen
+	};
+
+	GLuint buffer;
+	unsigned char* persistentData; // NULL ohne dauerhaftes Mapping
+	size_t slotSize;
+	std::vector<GLsync> fences; // einer pro Ringplatz, 0 wenn frei
+	size_t nextSlot;
+	std::deque<Job> jobs;
+
+	// Zaehler seit create()
+	unsigned long long bytesUploaded;
+	unsigned int slicesUploaded;
+	unsigned int slotStalls; // Frame beendet, weil der naechste Platz noch in Benutzung war
+
+	bool slotFree(size_t slot);
+	bool nextLevel(Job& job); // false, wenn das letzte Level fertig ist
+	void finish(Job& job);
+
+	TextureStreamer(const TextureStreamer&);            // nicht kopierbar
+	TextureStreamer& operator=(const TextureStreamer&);
+
+public:
+	TextureStreamer();
+	~TextureStreamer();
+
+	// slotCount Plaetze zu je slotSize Bytes, z. B. 3 x 1 MB
+	void create(size_t slotSize, unsigned int slotCount);
+	void destroy();
+
+	// Legt die Textur an (noch ohne Inhalt) und reiht das Hochladen ein.
+	// Der Streamer uebernimmt source und gibt es am Ende frei.
+	GLuint stream(MappedBMP* source);
+
+	// Laedt die Level bis 64x64 sofort und reiht die groesseren ein. Die Textur kann direkt
+	// benutzt werden und gehoert ab jetzt dem Aufrufer (destroy() loescht sie nicht).
+	GLuint stream(MappedDDS* source);
+
+	// Einmal pro Frame: laedt hoechstens byteBudget Bytes hoch. Hat ein BMP vorbereitete
+	// Mipmaps (buildMipmaps), werden sie genauso gestreamt, sonst erzeugt glGenerateMipmap
+	// sie nach dem letzten Streifen. Danach kann die Textur benutzt werden.
+	void update(size_t byteBudget);
+
+	bool isStreaming(GLuint texture) const;
+	bool idle() const { return jobs.empty(); }
+	bool persistent() const { return persistentData != NULL; }
+
+	void printStats() const;
+};
+
+#endif
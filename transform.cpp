@@ -0,0 +1,331 @@
+#include <math.h>
+
+#include "transform.hpp"
+
+// SSE2 gibt es auf jedem x86-Prozessor, den OpenGL 3.3 voraussetzt; MSVC setzt _M_IX86_FP bei /arch:SSE2 (Standard)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX wird zur Laufzeit gewaehlt. MSVC uebersetzt die Intrinsics auch ohne /arch:AVX,
+// GCC und Clang brauchen das target-Attribut an der Funktion.
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define TRANSFORM_HAS_AVX
+#define TRANSFORM_AVX_TARGET
+#include <intrin.h>
+#include <immintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#define TRANSFORM_HAS_AVX
+#define TRANSFORM_AVX_TARGET __attribute__((target("avx")))
+#include <immintrin.h>
+#endif
+
+static const float PI_F = 3.14159265f;
+static const float HALF_PI_F = 1.57079633f;
+static const float TWO_PI_F = 6.28318531f;
+static const float INV_TWO_PI_F = 0.159154943f;
+
+// Taylor bis a^11 auf [-pi/2, pi/2] wie in colony.cpp, Fehler unter 1e-7
+static const float SIN_C3 = -1.0f / 6.0f;
+static const float SIN_C5 = 1.0f / 120.0f;
+static const float SIN_C7 = -1.0f / 5040.0f;
+static const float SIN_C9 = 1.0f / 362880.0f;
+static const float SIN_C11 = -1.0f / 39916800.0f;
+
+// Was jeder Kernel braucht, einmal pro Aufruf vorbereitet. Ein Element (Zeile r, Spalte j) von
+// world ist P0[r] * k0j + P1[r] * k1j + P2[r] * k2j + P3[r] * B[j][3] (P = parent, B = local) mit
+//   k0j = s cos * B[j][0] - s sin * B[j][2] + x * B[j][3]
+//   k1j = s * B[j][1] + y * B[j][3]
+//   k2j = s sin * B[j][0] + s cos * B[j][2] + z * B[j][3]
+struct TransformSetup
+{
+	glm::mat4 parent[2]; // parent und viewProjection * parent
+	glm::mat4 local;
+	int outputs;         // 1 ohne, 2 mit MVP
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Skalarer Kernel
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// sin fuer a in [-pi, pi]: erst nach [-pi/2, pi/2] spiegeln, dann das Polynom
+static float sinReduced(float a)
+{
+	if (a > HALF_PI_F)
+		a = PI_F - a;
+	if (a < -HALF_PI_F)
+		a = -PI_F - a;
+	float a2 = a * a;
+	return a * (1.0f + a2 * (SIN_C3 + a2 * (SIN_C5 + a2 * (SIN_C7 + a2 * (SIN_C9 + a2 * SIN_C11)))));
+}
+
+// Beliebiger Winkel nach [-pi, pi], cos(a) = sin(a + pi/2)
+static void sinCos(float heading, float& s, float& c)
+{
+	float a = heading - floorf(heading * INV_TWO_PI_F + 0.5f) * TWO_PI_F;
+	s = sinReduced(a);
+	float b = a + HALF_PI_F;
+	c = sinReduced(b > PI_F ? b - TWO_PI_F : b);
+}
+
+static void transformScalar(const TransformSetup& setup, const TransformArrays& in, size_t first, size_t last,
+	glm::mat4* world, glm::mat4* mvp)
+{
+	const glm::mat4& B = setup.local;
+	for (size_t i = first; i < last; i++)
+	{
+		float s = in.scale ? in.scale[i] : 1.0f;
+		float y = in.y ? in.y[i] : 0.0f;
+		float sn, cs;
+		sinCos(in.heading[i], sn, cs);
+		float sc = s * cs, ss = s * sn;
+
+		glm::mat4* out[2] = { world + i, mvp ? mvp + i : NULL };
+		for (int o = 0; o < setup.outputs; o++)
+		{
+			const glm::mat4& P = setup.parent[o];
+			for (int j = 0; j < 4; j++)
+			{
+				float k0 = sc * B[j][0] - ss * B[j][2] + in.x[i] * B[j][3];
+				float k1 = s * B[j][1] + y * B[j][3];
+				float k2 = ss * B[j][0] + sc * B[j][2] + in.z[i] * B[j][3];
+				(*out[o])[j] = P[0] * k0 + P[1] * k1 + P[2] * k2 + P[3] * B[j][3];
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////    SSE2-Kernel, 4 Objekte pro Durchlauf
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef TRANSFORM_HAS_SSE2
+
+static inline __m128 sinReduced4(__m128 a)
+{
+	const __m128 pi = _mm_set1_ps(PI_F);
+	// Spiegeln wie im skalaren Kernel, ohne Verzweigung: min/max waehlen die richtige Seite
+	a = _mm_min_ps(a, _mm_sub_ps(pi, a));
+	a = _mm_max_ps(a, _mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), pi), a));
+	__m128 a2 = _mm_mul_ps(a, a);
+	__m128 p = _mm_add_ps(_mm_set1_ps(SIN_C9), _mm_mul_ps(a2, _mm_set1_ps(SIN_C11)));
+	p = _mm_add_ps(_mm_set1_ps(SIN_C7), _mm_mul_ps(a2, p));
+	p = _mm_add_ps(_mm_set1_ps(SIN_C5), _mm_mul_ps(a2, p));
+	p = _mm_add_ps(_mm_set1_ps(SIN_C3), _mm_mul_ps(a2, p));
+	p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(a2, p));
+	return _mm_mul_ps(a, p);
+}
+
+static size_t transformSSE2(const TransformSetup& setup, const TransformArrays& in, size_t first, size_t last,
+	glm::mat4* world, glm::mat4* mvp)
+{
+	const glm::mat4& B = setup.local;
+	const __m128 pi = _mm_set1_ps(PI_F);
+	const __m128 twoPi = _mm_set1_ps(TWO_PI_F);
+	const __m128 halfPi = _mm_set1_ps(HALF_PI_F);
+	const __m128 invTwoPi = _mm_set1_ps(INV_TWO_PI_F);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	size_t i = first;
+	for (; i + 4 <= last; i += 4)
+	{
+		__m128 s = in.scale ? _mm_loadu_ps(in.scale + i) : one;
+		__m128 x = _mm_loadu_ps(in.x + i);
+		__m128 y = in.y ? _mm_loadu_ps(in.y + i) : _mm_setzero_ps();
+		__m128 z = _mm_loadu_ps(in.z + i);
+
+		// Winkel nach [-pi, pi], cvtps rundet zur naechsten ganzen Umdrehung
+		__m128 h = _mm_loadu_ps(in.heading + i);
+		__m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(h, invTwoPi)));
+		__m128 a = _mm_sub_ps(h, _mm_mul_ps(turns, twoPi));
+		__m128 b = _mm_add_ps(a, halfPi);
+		b = _mm_sub_ps(b, _mm_and_ps(_mm_cmpgt_ps(b, pi), twoPi));
+		__m128 sc = _mm_mul_ps(s, sinReduced4(b));
+		__m128 ss = _mm_mul_ps(s, sinReduced4(a));
+
+		glm::mat4* out[2] = { world + i, mvp ? mvp + i : NULL };
+		for (int j = 0; j < 4; j++)
+		{
+			__m128 b0 = _mm_set1_ps(B[j][0]), b1 = _mm_set1_ps(B[j][1]);
+			__m128 b2 = _mm_set1_ps(B[j][2]), b3 = _mm_set1_ps(B[j][3]);
+			__m128 k0 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(sc, b0), _mm_mul_ps(ss, b2)), _mm_mul_ps(x, b3));
+			__m128 k1 = _mm_add_ps(_mm_mul_ps(s, b1), _mm_mul_ps(y, b3));
+			__m128 k2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ss, b0), _mm_mul_ps(sc, b2)), _mm_mul_ps(z, b3));
+
+			for (int o = 0; o < setup.outputs; o++)
+			{
+				const glm::mat4& P = setup.parent[o];
+				// Zeile r fuer alle vier Objekte ...
+				__m128 row[4];
+				for (int r = 0; r < 4; r++)
+				{
+					row[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(P[0][r]), k0), _mm_mul_ps(_mm_set1_ps(P[1][r]), k1)),
+						_mm_add_ps(_mm_mul_ps(_mm_set1_ps(P[2][r]), k2), _mm_set1_ps(P[3][r] * B[j][3])));
+				}
+				// ... wird Spalte j jedes Objekts
+				_MM_TRANSPOSE4_PS(row[0], row[1], row[2], row[3]);
+				for (int l = 0; l < 4; l++)
+					_mm_storeu_ps(&out[o][l][j][0], row[l]);
+			}
+		}
+	}
+	return i;
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////    AVX-Kernel, 8 Objekte pro Durchlauf
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef TRANSFORM_HAS_AVX
+
+TRANSFORM_AVX_TARGET static inline __m256 sinReduced8(__m256 a)
+{
+	const __m256 pi = _mm256_set1_ps(PI_F);
+	a = _mm256_min_ps(a, _mm256_sub_ps(pi, a));
+	a = _mm256_max_ps(a, _mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), pi), a));
+	__m256 a2 = _mm256_mul_ps(a, a);
+	__m256 p = _mm256_add_ps(_mm256_set1_ps(SIN_C9), _mm256_mul_ps(a2, _mm256_set1_ps(SIN_C11)));
+	p = _mm256_add_ps(_mm256_set1_ps(SIN_C7), _mm256_mul_ps(a2, p));
+	p = _mm256_add_ps(_mm256_set1_ps(SIN_C5), _mm256_mul_ps(a2, p));
+	p = _mm256_add_ps(_mm256_set1_ps(SIN_C3), _mm256_mul_ps(a2, p));
+	p = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(a2, p));
+	return _mm256_mul_ps(a, p);
+}
+
+TRANSFORM_AVX_TARGET static size_t transformAVX(const TransformSetup& setup, const TransformArrays& in,
+	size_t first, size_t last, glm::mat4* world, glm::mat4* mvp)
+{
+	const glm::mat4& B = setup.local;
+	const __m256 pi = _mm256_set1_ps(PI_F);
+	const __m256 twoPi = _mm256_set1_ps(TWO_PI_F);
+	const __m256 halfPi = _mm256_set1_ps(HALF_PI_F);
+	const __m256 invTwoPi = _mm256_set1_ps(INV_TWO_PI_F);
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	size_t i = first;
+	for (; i + 8 <= last; i += 8)
+	{
+		__m256 s = in.scale ? _mm256_loadu_ps(in.scale + i) : one;
+		__m256 x = _mm256_loadu_ps(in.x + i);
+		__m256 y = in.y ? _mm256_loadu_ps(in.y + i) : _mm256_setzero_ps();
+		__m256 z = _mm256_loadu_ps(in.z + i);
+
+		__m256 h = _mm256_loadu_ps(in.heading + i);
+		__m256 turns = _mm256_cvtepi32_ps(_mm256_cvtps_epi32(_mm256_mul_ps(h, invTwoPi)));
+		__m256 a = _mm256_sub_ps(h, _mm256_mul_ps(turns, twoPi));
+		__m256 b = _mm256_add_ps(a, halfPi);
+		b = _mm256_sub_ps(b, _mm256_and_ps(_mm256_cmp_ps(b, pi, _CMP_GT_OQ), twoPi));
+		__m256 sc = _mm256_mul_ps(s, sinReduced8(b));
+		__m256 ss = _mm256_mul_ps(s, sinReduced8(a));
+
+		glm::mat4* out[2] = { world + i, mvp ? mvp + i : NULL };
+		for (int j = 0; j < 4; j++)
+		{
+			__m256 b0 = _mm256_set1_ps(B[j][0]), b1 = _mm256_set1_ps(B[j][1]);
+			__m256 b2 = _mm256_set1_ps(B[j][2]), b3 = _mm256_set1_ps(B[j][3]);
+			__m256 k0 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(sc, b0), _mm256_mul_ps(ss, b2)), _mm256_mul_ps(x, b3));
+			__m256 k1 = _mm256_add_ps(_mm256_mul_ps(s, b1), _mm256_mul_ps(y, b3));
+			__m256 k2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ss, b0), _mm256_mul_ps(sc, b2)), _mm256_mul_ps(z, b3));
+
+			for (int o = 0; o < setup.outputs; o++)
+			{
+				const glm::mat4& P = setup.parent[o];
+				__m256 row[4];
+				for (int r = 0; r < 4; r++)
+				{
+					row[r] = _mm256_add_ps(
+						_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(P[0][r]), k0), _mm256_mul_ps(_mm256_set1_ps(P[1][r]), k1)),
+						_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(P[2][r]), k2), _mm256_set1_ps(P[3][r] * B[j][3])));
+				}
+				// 4 x 8 transponieren: jede 128-Bit-Haelfte ist danach Spalte j eines Objekts (l und l + 4)
+				__m256 t0 = _mm256_unpacklo_ps(row[0], row[1]);
+				__m256 t1 = _mm256_unpackhi_ps(row[0], row[1]);
+				__m256 t2 = _mm256_unpacklo_ps(row[2], row[3]);
+				__m256 t3 = _mm256_unpackhi_ps(row[2], row[3]);
+				__m256 column[4] = {
+					_mm256_shuffle_ps(t0, t2, 0x44), _mm256_shuffle_ps(t0, t2, 0xEE),
+					_mm256_shuffle_ps(t1, t3, 0x44), _mm256_shuffle_ps(t1, t3, 0xEE) };
+				for (int l = 0; l < 4; l++)
+				{
+					_mm_storeu_ps(&out[o][l][j][0], _mm256_castps256_ps128(column[l]));
+					_mm_storeu_ps(&out[o][l + 4][j][0], _mm256_extractf128_ps(column[l], 1));
+				}
+			}
+		}
+	}
+	return i;
+}
+
+#endif
+
+static bool hasAVX()
+{
+#if defined(TRANSFORM_HAS_AVX) && defined(_MSC_VER)
+	static int cached = -1;
+	if (cached < 0)
+	{
+		int info[4];
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		// Das Betriebssystem muss die YMM-Register beim Threadwechsel sichern
+		cached = osxsave && avx && (_xgetbv(0) & 6) == 6 ? 1 : 0;
+	}
+	return cached == 1;
+#elif defined(TRANSFORM_HAS_AVX)
+	return __builtin_cpu_supports("avx") != 0;
+#else
+	return false;
+#endif
+}
+
+bool transformKernelAvailable(TransformKernel kernel)
+{
+	switch (kernel)
+	{
+	case TRANSFORM_AVX:
+		return hasAVX();
+	case TRANSFORM_SSE2:
+#ifdef TRANSFORM_HAS_SSE2
+		return true;
+#else
+		return false;
+#endif
+	default:
+		return true;
+	}
+}
+
+void computeTransforms(const glm::mat4& parent, const glm::mat4& local, const TransformArrays& in, size_t count,
+	glm::mat4* world, const glm::mat4* viewProjection, glm::mat4* mvp, TransformKernel kernel)
+{
+	TransformSetup setup;
+	setup.parent[0] = parent;
+	setup.local = local;
+	setup.outputs = 1;
+	if (viewProjection && mvp)
+	{
+		setup.parent[1] = *viewProjection * parent;
+		setup.outputs = 2;
+	}
+	else
+		mvp = NULL;
+
+	if (kernel == TRANSFORM_AUTO)
+		kernel = hasAVX() ? TRANSFORM_AVX : TRANSFORM_SSE2;
+
+	// Der Rest, der nicht mehr fuer einen ganzen Durchlauf reicht, skalar
+	size_t first = 0;
+#ifdef TRANSFORM_HAS_AVX
+	if (kernel == TRANSFORM_AVX && hasAVX())
+		first = transformAVX(setup, in, first, count, world, mvp);
+#endif
+#ifdef TRANSFORM_HAS_SSE2
+	if (kernel == TRANSFORM_SSE2 || kernel == TRANSFORM_AVX)
+		first = transformSSE2(setup, in, first, count, world, mvp);
+#endif
+	transformScalar(setup, in, first, count, world, mvp);
+}
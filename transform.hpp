@@ -0,0 +1,43 @@
+#ifndef TRANSFORM_HPP
+#define TRANSFORM_HPP
+
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// Eingabe fuer computeTransforms, jedes Feld count Eintraege (struct of arrays)
+struct TransformArrays
+{
+	const float* x;
+	const float* y;       // NULL: alle auf dem Boden (0)
+	const float* z;
+	const float* heading; // Bogenmass, die lokale x-Achse zeigt nach (cos, 0, sin) wie bei der Kolonie
+	const float* scale;   // gleichmaessig, NULL: 1
+};
+
+enum TransformKernel
+{
+	TRANSFORM_AUTO,   // der schnellste, den CPU und Compiler koennen
+	TRANSFORM_SCALAR,
+	TRANSFORM_SSE2,   // 4 Objekte pro Durchlauf
+	TRANSFORM_AVX     // 8 Objekte pro Durchlauf, zur Laufzeit gewaehlt
+};
+
+// Weltmatrizen vieler Objekte auf einmal statt translate/rotate/scale pro Objekt:
+//   world[i] = parent * translate(x, y, z) * drehung(heading um y) * scale(s) * local
+// local ist fuer alle gleich (z. B. die Ausrichtung und Groesse des Meshes), parent die Szene.
+// Weil sich nur Position, Drehung und Groesse unterscheiden, ist world[i] eine Summe der Spalten
+// von parent mit 12 Faktoren pro Objekt; die rechnen die SIMD-Kernel fuer 4 bzw. 8 Objekte
+// zugleich (sin/cos als Polynom), transponieren und schreiben die Matrizen spaltenweise.
+// world kann direkt ein gemappter Instanz-Buffer sein (z. B. ein StreamRange), die Adressen
+// muessen nicht ausgerichtet sein. Mit viewProjection und mvp zusaetzlich
+// mvp[i] = viewProjection * world[i], sonst beide NULL.
+// Die Kernel rechnen dasselbe, aber mit anderer Rundung als glm (Abweichung ~1e-6 relativ).
+void computeTransforms(const glm::mat4& parent, const glm::mat4& local, const TransformArrays& in, size_t count,
+	glm::mat4* world, const glm::mat4* viewProjection = NULL, glm::mat4* mvp = NULL,
+	TransformKernel kernel = TRANSFORM_AUTO);
+
+// Kann dieser Kernel hier laufen? (AVX: CPU und Betriebssystem, SSE2: Compiler)
+bool transformKernelAvailable(TransformKernel kernel);
+
+#endif
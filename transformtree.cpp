@@ -0,0 +1,71 @@
+#include <string.h>
+
+#include "transformtree.hpp"
+
+TransformTree::TransformTree()
+	: firstDirty(0)
+{
+}
+
+int TransformTree::add(int parent, const glm::mat4& local)
+{
+	int node = (int)parents.size();
+	// Nur vorhandene Eltern, sonst stimmt die Reihenfolge fuer update() nicht
+	parents.push_back(parent >= 0 && parent < node ? parent : -1);
+	locals.push_back(local);
+	worlds.push_back(local);
+	dirty.push_back(1);
+	if ((size_t)node < firstDirty)
+		firstDirty = node;
+	return node;
+}
+
+void TransformTree::clear()
+{
+	parents.clear();
+	locals.clear();
+	worlds.clear();
+	dirty.clear();
+	firstDirty = 0;
+}
+
+void TransformTree::setLocal(int node, const glm::mat4& local)
+{
+	if (memcmp(&locals[node], &local, sizeof(glm::mat4)) == 0)
+		return;
+	locals[node] = local;
+	dirty[node] = 1;
+	if ((size_t)node < firstDirty)
+		firstDirty = node;
+}
+
+unsigned int TransformTree::update()
+{
+	size_t count = parents.size();
+	if (firstDirty >= count)
+		return 0;
+
+	// Eltern stehen vor den Kindern: ist ein Elternknoten geaendert, ist seine Weltmatrix schon neu,
+	// wenn das Kind drankommt, und das Kind wird selbst als geaendert markiert
+	unsigned int updated = 0;
+	for (size_t i = firstDirty; i < count; i++)
+	{
+		int parent = parents[i];
+		if (parent >= 0 && dirty[parent])
+			dirty[i] = 1;
+		if (!dirty[i])
+			continue;
+		worlds[i] = parent >= 0 ? worlds[parent] * locals[i] : locals[i];
+		updated++;
+	}
+	memset(&dirty[firstDirty], 0, count - firstDirty);
+	firstDirty = count;
+	return updated;
+}
+
+const glm::mat4& TransformTree::world(int node)
+{
+	if ((size_t)node >= firstDirty)
+		update();
+	return worlds[node];
+}
@@ -0,0 +1,48 @@
+#ifndef TRANSFORMTREE_HPP
+#define TRANSFORMTREE_HPP
+
+#include <stddef.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Eine Hierarchie von Transformationen statt "Save = Model; Model = ...; Model = Save":
+// jeder Knoten hat eine lokale Matrix relativ zu seinem Elternknoten, die Weltmatrix
+// (world = world(parent) * local) wird nur neu berechnet, wenn sich darueber etwas geaendert hat.
+// Die Knoten liegen flach in Arrays, ein Elternknoten immer vor seinen Kindern (add() nimmt nur
+// schon vorhandene Eltern). update() laeuft deshalb einmal der Reihe nach durch, ab dem ersten
+// geaenderten Knoten; geaendert ist ein Knoten, wenn setLocal einen anderen Wert setzt oder sein
+// Elternknoten geaendert wurde. Was sich nicht bewegt, kostet pro Frame keine Multiplikation.
+class TransformTree
+{
+	std::vector<int> parents;          // -1 fuer Wurzeln, sonst kleiner als der eigene Index
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<unsigned char> dirty;  // local geaendert, world noch alt
+	size_t firstDirty;                 // kleinster Index mit dirty, size() wenn alles aktuell
+
+	TransformTree(const TransformTree&);            // nicht kopierbar
+	TransformTree& operator=(const TransformTree&);
+
+public:
+	TransformTree();
+
+	// Neuer Knoten unter parent (-1: Wurzel), gibt seinen Index zurueck
+	int add(int parent, const glm::mat4& local = glm::mat4(1.0f));
+	void clear();
+
+	// Markiert den Knoten nur, wenn sich die Matrix wirklich aendert; ein Knoten, der jeden
+	// Frame denselben Wert bekommt, bleibt also aktuell.
+	void setLocal(int node, const glm::mat4& local);
+	const glm::mat4& local(int node) const { return locals[node]; }
+	int parent(int node) const { return parents[node]; }
+
+	// Rechnet alle geaenderten Knoten und ihre Unterbaeume neu, gibt deren Anzahl zurueck
+	unsigned int update();
+	// Ruft update() auf, falls der Knoten veraltet sein koennte
+	const glm::mat4& world(int node);
+
+	size_t size() const { return parents.size(); }
+};
+
+#endif
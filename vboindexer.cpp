@@ -0,0 +1,285 @@
+#include <vector>
+#include <unordered_map>
+#include <math.h>
+#include <string.h>
+
+#include <glm/glm.hpp>
+
+#include "vboindexer.hpp"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Doppelte Eckpunkte zusammenfassen
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct PackedVertex
+{
+	glm::vec3 position;
+	glm::vec2 uv;
+	glm::vec3 normal;
+
+	bool operator==(const PackedVertex& other) const
+	{
+		return memcmp(this, &other, sizeof(PackedVertex)) == 0;
+	}
+};
+
+struct PackedVertexHash
+{
+	size_t operator()(const PackedVertex& vertex) const
+	{
+		unsigned int words[8];
+		memcpy(words, &vertex, sizeof(words));
+
+		size_t hash = 0;
+		for (int i = 0; i < 8; i++)
+			hash = (hash ^ words[i]) * 0x9E3779B1u + (hash >> 15);
+		return hash;
+	}
+};
+
+} // namespace
+
+void indexVBO(
+	const std::vector<glm::vec3> & in_vertices,
+	const std::vector<glm::vec2> & in_uvs,
+	const std::vector<glm::vec3> & in_normals,
+
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	std::unordered_map<PackedVertex, unsigned int, PackedVertexHash> vertexToOutIndex;
+	vertexToOutIndex.reserve(in_vertices.size() / 2);
+	out_indices.reserve(out_indices.size() + in_vertices.size());
+
+	// For each input vertex
+	for (size_t i = 0; i < in_vertices.size(); i++)
+	{
+		PackedVertex packed;
+		packed.position = in_vertices[i];
+		packed.uv = in_uvs[i];
+		packed.normal = in_normals[i];
+
+		// Try to find a similar vertex in out_XXXX
+		std::pair<std::unordered_map<PackedVertex, unsigned int, PackedVertexHash>::iterator, bool> inserted =
+			vertexToOutIndex.insert(std::make_pair(packed, (unsigned int)out_vertices.size()));
+
+		if (inserted.second)
+		{
+			out_vertices.push_back(in_vertices[i]);
+			out_uvs     .push_back(in_uvs[i]);
+			out_normals .push_back(in_normals[i]);
+		}
+		out_indices.push_back(inserted.first->second);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////    Post-Transform-Cache-Optimierung (Forsyth)
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Die Werte stammen aus Forsyths Artikel, der simulierte Cache ist groesser als die
+// meisten echten, das schadet aber nicht.
+const int forsythCacheSize = 32;
+const float cacheDecayPower = 1.5f;
+const float lastTriangleScore = 0.75f;
+const float valenceBoostScale = 2.0f;
+const float valenceBoostPower = 0.5f;
+
+float vertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+	if (remainingTriangles == 0)
+		return -1.0f; // wird nicht mehr gebraucht
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// Die drei Eckpunkte des letzten Dreiecks bekommen einen festen Wert, damit
+		// nicht direkt wieder ein Dreieck mit derselben Kante gewaehlt wird
+		if (cachePosition < 3)
+			score = lastTriangleScore;
+		else
+			score = powf(1.0f - (cachePosition - 3) / float(forsythCacheSize - 3), cacheDecayPower);
+	}
+
+	// Eckpunkte mit wenigen offenen Dreiecken bevorzugen, damit keine Einzelteile uebrig bleiben
+	score += valenceBoostScale * powf((float)remainingTriangles, -valenceBoostPower);
+	return score;
+}
+
+} // namespace
+
+void optimizeVertexCache(
+	std::vector<unsigned int> & indices,
+	std::vector<glm::vec3> & vertices,
+	std::vector<glm::vec2> & uvs,
+	std::vector<glm::vec3> & normals
+){
+	const size_t triangleCount = indices.size() / 3;
+	const size_t vertexCount = vertices.size();
+	if (triangleCount == 0)
+		return;
+
+	// Dreiecke je Eckpunkt (CSR). Die noch offenen Dreiecke stehen jeweils vorne.
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		remaining[indices[i]]++;
+
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		score[v] = vertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<char> emitted(triangleCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+	std::vector<unsigned int> cache, newCache;
+	cache.reserve(forsythCacheSize + 3);
+	newCache.reserve(forsythCacheSize + 3);
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	long long best = -1;
+	size_t scanCursor = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		if (best < 0)
+		{
+			// Nichts Passendes im Cache: mit dem naechsten offenen Dreieck weitermachen
+			while (emitted[scanCursor])
+				scanCursor++;
+			best = (long long)scanCursor;
+		}
+
+		const unsigned int* triangle = &indices[(size_t)best * 3];
+		emitted[(size_t)best] = 1;
+		output.insert(output.end(), triangle, triangle + 3);
+
+		// Dreieck aus den Listen seiner Eckpunkte nehmen
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = triangle[k];
+			unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int i = 0; i < remaining[v]; i++)
+			{
+				if (list[i] == (unsigned int)best)
+				{
+					list[i] = list[remaining[v] - 1];
+					list[remaining[v] - 1] = (unsigned int)best;
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// Die Eckpunkte des Dreiecks kommen an den Anfang des LRU-Caches
+		newCache.assign(triangle, triangle + 3);
+		for (size_t i = 0; i < cache.size(); i++)
+			if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+				newCache.push_back(cache[i]);
+
+		// Herausgefallene Eckpunkte verlieren ihren Cache-Bonus
+		for (size_t i = forsythCacheSize; i < newCache.size(); i++)
+			cachePosition[newCache[i]] = -1;
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			unsigned int v = newCache[i];
+			if (i < (size_t)forsythCacheSize)
+				cachePosition[v] = (int)i;
+
+			float newScore = vertexScore(cachePosition[v], remaining[v]);
+			float delta = newScore - score[v];
+			score[v] = newScore;
+
+			const unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+				triangleScore[list[j]] += delta;
+		}
+		if (newCache.size() > (size_t)forsythCacheSize)
+			newCache.resize(forsythCacheSize);
+		cache.swap(newCache);
+
+		// Das beste Dreieck kann nur eines der Eckpunkte im Cache sein
+		best = -1;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			unsigned int v = cache[i];
+			const unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				if (triangleScore[list[j]] > bestScore)
+				{
+					bestScore = triangleScore[list[j]];
+					best = list[j];
+				}
+			}
+		}
+	}
+
+	// Eckpunkte in der Reihenfolge der ersten Verwendung neu nummerieren
+	std::vector<unsigned int> remap(vertexCount, (unsigned int)-1);
+	std::vector<glm::vec3> sortedVertices, sortedNormals;
+	std::vector<glm::vec2> sortedUvs;
+	sortedVertices.reserve(vertexCount);
+	sortedUvs.reserve(vertexCount);
+	sortedNormals.reserve(vertexCount);
+
+	for (size_t i = 0; i < output.size(); i++)
+	{
+		unsigned int v = output[i];
+		if (remap[v] == (unsigned int)-1)
+		{
+			remap[v] = (unsigned int)sortedVertices.size();
+			sortedVertices.push_back(vertices[v]);
+			sortedUvs     .push_back(uvs[v]);
+			sortedNormals .push_back(normals[v]);
+		}
+		output[i] = remap[v];
+	}
+
+	indices.swap(output);
+	vertices.swap(sortedVertices);
+	uvs.swap(sortedUvs);
+	normals.swap(sortedNormals);
+}
+
+float computeACMR(const std::vector<unsigned int> & indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	if (indices.size() < 3)
+		return 0.0f;
+
+	// FIFO-Cache: ein Eckpunkt ist noch drin, solange seit seinem Laden weniger als
+	// cacheSize andere Eckpunkte geladen wurden
+	std::vector<long long> loadedAt(vertexCount, -(long long)cacheSize - 1);
+	long long misses = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int v = indices[i];
+		if (misses - loadedAt[v] > (long long)cacheSize)
+		{
+			loadedAt[v] = misses;
+			misses++;
+		}
+	}
+	return (float)misses / (float)(indices.size() / 3);
+}
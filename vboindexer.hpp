@@ -0,0 +1,35 @@
+#ifndef VBOINDEXER_HPP
+#define VBOINDEXER_HPP
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Fasst gleiche Eckpunkte (Position, UV und Normale bitweise gleich) zu einem zusammen
+// und erzeugt dazu den Indexbuffer fuer glDrawElements.
+void indexVBO(
+	const std::vector<glm::vec3> & in_vertices,
+	const std::vector<glm::vec2> & in_uvs,
+	const std::vector<glm::vec3> & in_normals,
+
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+);
+
+// Sortiert die Dreiecke fuer den Post-Transform-Cache der GPU um (Tom Forsyth,
+// "Linear-Speed Vertex Cache Optimisation") und nummeriert danach die Eckpunkte in der
+// Reihenfolge ihrer ersten Verwendung, damit auch das Vertex-Fetching linear laeuft.
+void optimizeVertexCache(
+	std::vector<unsigned int> & indices,
+	std::vector<glm::vec3> & vertices,
+	std::vector<glm::vec2> & uvs,
+	std::vector<glm::vec3> & normals
+);
+
+// Average Cache Miss Ratio: Cache-Misses pro Dreieck bei einem FIFO-Cache der angegebenen Groesse.
+// 3.0 ist das Schlechteste (jeder Eckpunkt wird neu transformiert), ~0.5 das Erreichbare.
+float computeACMR(const std::vector<unsigned int> & indices, unsigned int vertexCount, unsigned int cacheSize = 32);
+
+#endif